@@ -0,0 +1,84 @@
+#include "BenchUtils.hpp"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+namespace Chip8Bench
+{
+    namespace
+    {
+        // The hot paths only trace at VLOG(1), but ROM errors such as stack
+        // overflows and bad reads still log at INFO. Benchmarks measure the
+        // emulation, so only warnings are written.
+        struct QuietLogging
+        {
+            QuietLogging()
+            {
+                FLAGS_minloglevel = google::GLOG_WARNING;
+                FLAGS_logtostderr = true;
+            }
+        };
+
+        QuietLogging quietLogging;
+    }
+
+    std::vector<std::string> romNames()
+    {
+        std::vector<std::string> names;
+        DIR *directory = opendir(CHIP8_ROM_DIR);
+        if(directory == NULL) {
+            return names;
+        }
+        for(dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory)) {
+            if(entry->d_name[0] != '.') {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(directory);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::string romPath(const std::string &name)
+    {
+        return std::string(CHIP8_ROM_DIR) + "/" + name;
+    }
+
+    std::unique_ptr<Chip8::Machine> boot(const std::vector<unsigned char> &rom, int cycles)
+    {
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        machine->reset(rom);
+        machine->setCyclesPerFrame(cycles);
+        machine->cpu().seed(0);
+        return machine;
+    }
+
+    std::vector<Uint16> inputScript(int frames)
+    {
+        // Each line is "FRAME MASK", the keypad is MASK from FRAME on.
+        std::vector<Uint16> keys(frames, 0);
+        std::ifstream file((std::string(CHIP8_BENCH_DIR) + "/input-script.txt").c_str());
+        std::string line;
+        while(std::getline(file, line)) {
+            if(line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            int frame = 0;
+            std::string mask;
+            if(!(fields >> frame >> mask) || frame < 0) {
+                continue;
+            }
+            Uint16 value = (Uint16) strtol(mask.c_str(), NULL, 16);
+            for(int f = frame; f < frames; f++) {
+                keys[f] = value;
+            }
+        }
+        return keys;
+    }
+}
@@ -0,0 +1,44 @@
+/**
+* @file BenchUtils.hpp
+* @brief Shared setup for the chip8-bench benchmarks.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_BENCHUTILS_HPP
+#define CHIP8_BENCHUTILS_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Chip8Bench
+{
+    /**
+    * @brief Gets the file names in roms/, sorted.
+    */
+    std::vector<std::string> romNames();
+
+    /**
+    * @brief Gets the path of a ROM in roms/.
+    */
+    std::string romPath(const std::string &name);
+
+    /**
+    * @brief Creates a machine reset with rom and given a fixed seed.
+    */
+    std::unique_ptr<Chip8::Machine> boot(const std::vector<unsigned char> &rom, int cycles);
+
+    /**
+    * @brief Expands bench/input-script.txt into one key mask per frame.
+    *
+    * @param frames The number of frames to expand.
+    */
+    std::vector<Uint16> inputScript(int frames);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "BenchUtils.hpp"
+
+#include <Machine.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    // The program fills memory from StartAddress to here, comfortably past
+    // where Steps instructions of 4 bytes end.
+    const unsigned int ProgramEnd = 0x2000;
+    const int Steps = 1024;
+
+    // Fills memory with opcode and steps through it, jumping back to the
+    // start every Steps instructions.
+    void BM_CpuStep(benchmark::State &state, unsigned int opcode)
+    {
+        std::unique_ptr<Chip8::Machine> machine = Chip8Bench::boot(std::vector<unsigned char>(), 1);
+        for(unsigned int address = Chip8::Memory::StartAddress; address < ProgramEnd; address += 2) {
+            machine->memory().write(address, opcode >> 8);
+            machine->memory().write(address + 1, opcode & 0xFF);
+        }
+        // Memory instructions work above the program, V1 makes 8XY4 carry.
+        machine->memory().setI(ProgramEnd);
+        machine->memory().setRegister(0x1, 0xF0);
+
+        Chip8::Machine::Scope scope(*machine);
+        Chip8::Cpu &cpu = machine->cpu();
+        int steps = 0;
+        for(auto _ : state) {
+            cpu.step();
+            if(++steps == Steps) {
+                steps = 0;
+                cpu.jump(Chip8::Memory::StartAddress);
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // 2NNN and 00EE need a return address to go back to, so they run as
+    // CALL 0x300, JP 0x200 with RET at 0x300.
+    void BM_CpuCallReturn(benchmark::State &state)
+    {
+        std::unique_ptr<Chip8::Machine> machine = Chip8Bench::boot(std::vector<unsigned char>(), 1);
+        const unsigned char program[] = { 0x23, 0x00, 0x12, 0x00 };
+        for(unsigned int i = 0; i < sizeof(program); i++) {
+            machine->memory().write(Chip8::Memory::StartAddress + i, program[i]);
+        }
+        machine->memory().write(0x300, 0x00);
+        machine->memory().write(0x301, 0xEE);
+
+        Chip8::Machine::Scope scope(*machine);
+        Chip8::Cpu &cpu = machine->cpu();
+        for(auto _ : state) {
+            cpu.step();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK_CAPTURE(BM_CpuStep, load_6XNN, 0x6012);
+BENCHMARK_CAPTURE(BM_CpuStep, add_7XNN, 0x7012);
+BENCHMARK_CAPTURE(BM_CpuStep, alu_8XY4, 0x8014);
+BENCHMARK_CAPTURE(BM_CpuStep, shift_8XY6, 0x8016);
+BENCHMARK_CAPTURE(BM_CpuStep, skip_3XNN_not_taken, 0x3001);
+BENCHMARK_CAPTURE(BM_CpuStep, skip_3XNN_taken, 0x3000);
+BENCHMARK_CAPTURE(BM_CpuStep, jump_1NNN, 0x1200);
+BENCHMARK_CAPTURE(BM_CpuStep, load_i_ANNN, 0xA300);
+BENCHMARK_CAPTURE(BM_CpuStep, random_CXNN, 0xC0FF);
+BENCHMARK_CAPTURE(BM_CpuStep, draw_DXY8, 0xD018);
+BENCHMARK_CAPTURE(BM_CpuStep, key_EX9E, 0xE09E);
+BENCHMARK_CAPTURE(BM_CpuStep, timer_FX15, 0xF015);
+BENCHMARK_CAPTURE(BM_CpuStep, bcd_FX33, 0xF033);
+BENCHMARK_CAPTURE(BM_CpuStep, store_FF55, 0xFF55);
+BENCHMARK_CAPTURE(BM_CpuStep, load_FF65, 0xFF65);
+BENCHMARK(BM_CpuCallReturn);
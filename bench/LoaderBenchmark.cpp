@@ -0,0 +1,70 @@
+#include "BenchUtils.hpp"
+
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    void BM_ReadRom(benchmark::State &state, const std::string &name)
+    {
+        std::string path = Chip8Bench::romPath(name);
+        size_t size = 0;
+        for(auto _ : state) {
+            std::vector<unsigned char> rom = Chip8::FileUtils::readRom(path);
+            size = rom.size();
+            benchmark::DoNotOptimize(rom.data());
+        }
+        state.SetBytesProcessed(state.iterations() * size);
+    }
+
+    void BM_LoadFonts(benchmark::State &state)
+    {
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        for(auto _ : state) {
+            machine->loadFonts();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_LoadRom(benchmark::State &state, const std::string &name)
+    {
+        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(Chip8Bench::romPath(name));
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        for(auto _ : state) {
+            machine->loadRom(rom);
+        }
+        state.SetBytesProcessed(state.iterations() * rom.size());
+    }
+
+    // Resets a machine that has run the ROM for a while, the way a batch
+    // runner starts each job.
+    void BM_Reset(benchmark::State &state, const std::string &name)
+    {
+        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(Chip8Bench::romPath(name));
+        std::unique_ptr<Chip8::Machine> machine = Chip8Bench::boot(rom, 10);
+        for(int frame = 0; frame < 600; frame++) {
+            machine->stepFrame();
+        }
+        for(auto _ : state) {
+            machine->reset(rom);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    int registerRoms()
+    {
+        std::vector<std::string> names = Chip8Bench::romNames();
+        for(size_t i = 0; i < names.size(); i++) {
+            benchmark::RegisterBenchmark(("BM_ReadRom/" + names[i]).c_str(), BM_ReadRom, names[i]);
+            benchmark::RegisterBenchmark(("BM_LoadRom/" + names[i]).c_str(), BM_LoadRom, names[i]);
+            benchmark::RegisterBenchmark(("BM_Reset/" + names[i]).c_str(), BM_Reset, names[i]);
+        }
+        return 0;
+    }
+
+    int registered = registerRoms();
+}
+
+BENCHMARK(BM_LoadFonts);
@@ -0,0 +1,45 @@
+#include "BenchUtils.hpp"
+
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    // Ten seconds of play at a speed most ROMs are tuned for.
+    const int Frames = 600;
+    const int Cycles = 10;
+
+    // Runs a ROM headless from power on for Frames frames, feeding it the
+    // input script. Every iteration restores the booted machine first.
+    void BM_RunRom(benchmark::State &state, const std::string &name)
+    {
+        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(Chip8Bench::romPath(name));
+        std::unique_ptr<Chip8::Machine> machine = Chip8Bench::boot(rom, Cycles);
+        std::unique_ptr<Chip8::Machine::State> booted(new Chip8::Machine::State());
+        machine->save(*booted);
+        std::vector<Uint16> keys = Chip8Bench::inputScript(Frames);
+
+        for(auto _ : state) {
+            machine->restore(*booted);
+            for(int frame = 0; frame < Frames; frame++) {
+                machine->setKeys(keys[frame]);
+                machine->stepFrame();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * Frames);
+        state.counters["fps"] = benchmark::Counter(state.iterations() * Frames, benchmark::Counter::kIsRate);
+    }
+
+    int registerRoms()
+    {
+        std::vector<std::string> names = Chip8Bench::romNames();
+        for(size_t i = 0; i < names.size(); i++) {
+            benchmark::RegisterBenchmark(("BM_RunRom/" + names[i]).c_str(), BM_RunRom, names[i])->Unit(benchmark::kMillisecond);
+        }
+        return 0;
+    }
+
+    int registered = registerRoms();
+}
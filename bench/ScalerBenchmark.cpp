@@ -0,0 +1,59 @@
+#include <Scaler.hpp>
+#include <Video.hpp>
+
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+    // Scales a random screen, changing one pixel every iteration so the
+    // unchanged frame check never skips the work.
+    void BM_Scale(benchmark::State &state)
+    {
+        Chip8::Scaler::Filter filter = (Chip8::Scaler::Filter) state.range(0);
+        int scale = (int) state.range(1);
+        Chip8::Scaler::Kernel kernel = (Chip8::Scaler::Kernel) state.range(2);
+        if(!Chip8::Scaler::supported(kernel)) {
+            state.SkipWithError("kernel not supported on this host");
+            return;
+        }
+
+        Chip8::Scaler scaler(filter, scale, kernel);
+        std::vector<Uint32> output(scaler.outputWidth() * scaler.outputHeight());
+        Uint32 palette[4] = { 0x000000FF, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF };
+        Uint64 planes[2][32];
+        srand(0);
+        for(int j = 0; j < 32; j++) {
+            planes[0][j] = ((Uint64) rand() << 32) ^ rand();
+            planes[1][j] = ((Uint64) rand() << 32) ^ rand();
+        }
+
+        for(auto _ : state) {
+            planes[0][0] ^= 0x1;
+            scaler.scale(planes[0], planes[1], palette, &output[0]);
+            benchmark::DoNotOptimize(&output[0]);
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * output.size() * sizeof(Uint32));
+        state.SetLabel(Chip8::Scaler::kernelName(kernel));
+    }
+
+    void ScalerArguments(benchmark::internal::Benchmark *b)
+    {
+        const int scales[] = { 1, 4, 8, 12, 24 };
+        for(int filter = Chip8::Scaler::Nearest; filter <= Chip8::Scaler::Smooth; filter++) {
+            for(int s = 0; s < 5; s++) {
+                for(int kernel = Chip8::Scaler::Scalar; kernel <= Chip8::Scaler::AVX2; kernel++) {
+                    if(filter == Chip8::Scaler::Smooth && scales[s] < 2) {
+                        continue;
+                    }
+                    b->Args({ filter, scales[s], kernel });
+                }
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_Scale)->Apply(ScalerArguments)->ArgNames({ "filter", "scale", "kernel" });
@@ -0,0 +1,54 @@
+#include "BenchUtils.hpp"
+
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    const int Frames = 600;
+    const int Cycles = 10;
+
+    // Saves the machine after every frame of a ROM's play, the way run ahead
+    // and netplay rollback do. With incremental false the snapshot is
+    // marked as foreign before each save, forcing a copy of all 64KB.
+    void BM_SnapshotEveryFrame(benchmark::State &state, const std::string &name, bool incremental)
+    {
+        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(Chip8Bench::romPath(name));
+        std::unique_ptr<Chip8::Machine> machine = Chip8Bench::boot(rom, Cycles);
+        std::unique_ptr<Chip8::Machine::State> booted(new Chip8::Machine::State());
+        std::unique_ptr<Chip8::Machine::State> snapshot(new Chip8::Machine::State());
+        machine->save(*booted);
+        std::vector<Uint16> keys = Chip8Bench::inputScript(Frames);
+
+        for(auto _ : state) {
+            state.PauseTiming();
+            machine->restore(*booted);
+            state.ResumeTiming();
+            for(int frame = 0; frame < Frames; frame++) {
+                machine->setKeys(keys[frame]);
+                machine->stepFrame();
+                if(!incremental) {
+                    snapshot->memory.lineage = 0;
+                }
+                machine->save(*snapshot);
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * Frames);
+    }
+
+    int registerRoms()
+    {
+        std::vector<std::string> names = Chip8Bench::romNames();
+        for(size_t i = 0; i < names.size(); i++) {
+            benchmark::RegisterBenchmark(("BM_SnapshotEveryFrame/" + names[i] + "/full").c_str(),
+                                         BM_SnapshotEveryFrame, names[i], false)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("BM_SnapshotEveryFrame/" + names[i] + "/incremental").c_str(),
+                                         BM_SnapshotEveryFrame, names[i], true)->Unit(benchmark::kMillisecond);
+        }
+        return 0;
+    }
+
+    int registered = registerRoms();
+}
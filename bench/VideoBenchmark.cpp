@@ -0,0 +1,74 @@
+#include <Machine.hpp>
+#include <Video.hpp>
+
+#include <SDL.h>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <stdlib.h>
+
+namespace
+{
+    // Draws a solid sprite of state.range(0) rows at (range(1), range(2)).
+    // Drawing twice restores the screen, so every iteration does the same work.
+    void BM_DrawSprite(benchmark::State &state)
+    {
+        int height = (int) state.range(0);
+        int x = (int) state.range(1);
+        int y = (int) state.range(2);
+        unsigned char sprite[32];
+        for(int i = 0; i < 32; i++) {
+            sprite[i] = 0xFF;
+        }
+
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        Chip8::Machine::Scope scope(*machine);
+        Chip8::Video &video = machine->video();
+        for(auto _ : state) {
+            video.drawSprite(x, y, sprite, height);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void DrawArguments(benchmark::internal::Benchmark *b)
+    {
+        // Aligned, unaligned, wrapping right and wrapping bottom.
+        const int positions[4][2] = { { 8, 8 }, { 3, 8 }, { 60, 8 }, { 8, 28 } };
+        const int heights[] = { 1, 5, 8, 15 };
+        for(int h = 0; h < 4; h++) {
+            for(int p = 0; p < 4; p++) {
+                b->Args({ heights[h], positions[p][0], positions[p][1] });
+            }
+        }
+    }
+
+    // Converts a random screen to pixels. Each iteration flips one pixel so
+    // the frame is dirty and getPixels runs copyDataToPixels.
+    void BM_CopyDataToPixels(benchmark::State &state)
+    {
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        Chip8::Machine::Scope scope(*machine);
+        Chip8::Video &video = machine->video();
+        SDL_PixelFormat *format = SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888);
+        video.setPixelFormat(format);
+
+        srand(0);
+        for(int y = 0; y < Chip8::Video::Height; y++) {
+            for(int x = 0; x < Chip8::Video::Width; x += 8) {
+                unsigned char row = rand() & 0xFF;
+                video.drawSprite(x, y, &row, 1);
+            }
+        }
+
+        const unsigned char pixel = 0x80;
+        for(auto _ : state) {
+            video.drawSprite(0, 0, &pixel, 1);
+            benchmark::DoNotOptimize(video.getPixels());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * Chip8::Video::Width * Chip8::Video::Height * sizeof(Uint32));
+        SDL_FreeFormat(format);
+    }
+}
+
+BENCHMARK(BM_DrawSprite)->Apply(DrawArguments)->ArgNames({ "height", "x", "y" });
+BENCHMARK(BM_CopyDataToPixels);
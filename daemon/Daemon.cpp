@@ -0,0 +1,516 @@
+#include "Daemon.hpp"
+
+#include <FrameCodec.hpp>
+#include <Memory.hpp>
+
+#include <glog/logging.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+    const std::string Daemon::_Tag = "Daemon:";
+
+    namespace
+    {
+        enum MessageType
+        {
+            Start = 0x01,
+            Keys = 0x02,
+            Ack = 0x03,
+            Started = 0x81,
+            Frame = 0x82,
+            Error = 0x83
+        };
+
+        const size_t HeaderSize = 5;
+        const size_t StartSize = 6;
+        const size_t FrameSize = 9;
+        const Uint8 BuzzerFlag = 0x1;
+
+        // Enough for any machine at full speed, and small enough that a
+        // handful of clients can't take a worker's whole time.
+        const unsigned int MaxCycles = 1000;
+
+        // A client with this much output waiting gets no new frames until
+        // it reads some.
+        const size_t MaxQueued = 0x10000;
+
+        const int MaxEvents = 64;
+
+        void put32(Uint8 *data, Uint32 value)
+        {
+            data[0] = value & 0xFF;
+            data[1] = (value >> 8) & 0xFF;
+            data[2] = (value >> 16) & 0xFF;
+            data[3] = (value >> 24) & 0xFF;
+        }
+
+        Uint16 get16(const Uint8 *data)
+        {
+            return (Uint16) (data[0] | (data[1] << 8));
+        }
+
+        Uint32 get32(const Uint8 *data)
+        {
+            return data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32) data[3] << 24);
+        }
+    }
+
+    Daemon::Daemon(unsigned int workers)
+        : _scheduler(workers, 60.0),
+          _listener(-1),
+          _epoll(-1),
+          _wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+        _scheduler.setFrameCallback(std::bind(&Daemon::sendFrame, this, std::placeholders::_1));
+    }
+
+    Daemon::~Daemon()
+    {
+        // The frame callback uses the session map, so the workers must stop
+        // before it goes.
+        _scheduler.stop();
+        if(_listener >= 0) {
+            close(_listener);
+        }
+        if(_epoll >= 0) {
+            close(_epoll);
+        }
+        if(_wake >= 0) {
+            close(_wake);
+        }
+    }
+
+    bool Daemon::open(const std::string &path)
+    {
+        if(_listener >= 0) {
+            LOG(INFO) << _Tag << "Already listening on " << _path;
+            return false;
+        }
+        sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        if(path.empty() || path.size() >= sizeof(local.sun_path)) {
+            LOG(INFO) << _Tag << "Invalid socket path " << path;
+            return false;
+        }
+        strncpy(local.sun_path, path.c_str(), sizeof(local.sun_path) - 1);
+
+        _listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(_listener < 0) {
+            LOG(INFO) << _Tag << "Failed to create socket - " << strerror(errno);
+            return false;
+        }
+
+        // A socket left behind by a daemon that died is removed, one that
+        // still accepts connections is not.
+        struct stat status;
+        if(lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, (const sockaddr *) &local, sizeof(local)) == 0;
+            if(probe >= 0) {
+                close(probe);
+            }
+            if(!live) {
+                unlink(path.c_str());
+            }
+        }
+
+        if(bind(_listener, (const sockaddr *) &local, sizeof(local)) < 0 || listen(_listener, SOMAXCONN) < 0) {
+            LOG(INFO) << _Tag << "Failed to listen on " << path << " - " << strerror(errno);
+            close(_listener);
+            _listener = -1;
+            return false;
+        }
+        _path = path;
+
+        _epoll = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = _listener;
+        bool watching = _epoll >= 0 && _wake >= 0 && epoll_ctl(_epoll, EPOLL_CTL_ADD, _listener, &event) == 0;
+        event.data.fd = _wake;
+        watching = watching && epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake, &event) == 0;
+        if(!watching) {
+            LOG(INFO) << _Tag << "Failed to set up epoll - " << strerror(errno);
+            close(_listener);
+            _listener = -1;
+            unlink(_path.c_str());
+            return false;
+        }
+        LOG(INFO) << _Tag << "Listening on " << path;
+        return true;
+    }
+
+    void Daemon::run()
+    {
+        if(_listener < 0) {
+            return;
+        }
+        _scheduler.start();
+        epoll_event events[MaxEvents];
+        bool running = true;
+        while(running) {
+            int count = epoll_wait(_epoll, events, MaxEvents, -1);
+            if(count < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                LOG(INFO) << _Tag << "Failed to wait for sockets - " << strerror(errno);
+                break;
+            }
+            for(int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if(fd == _wake) {
+                    Uint64 value;
+                    ssize_t got = read(_wake, &value, sizeof(value));
+                    (void) got;
+                    running = false;
+                    continue;
+                }
+                if(fd == _listener) {
+                    accept();
+                    continue;
+                }
+
+                // The client may have been dropped by an earlier event.
+                std::unordered_map<int, std::shared_ptr<Connection> >::iterator found = _connections.find(fd);
+                if(found == _connections.end()) {
+                    continue;
+                }
+                std::shared_ptr<Connection> connection = found->second;
+                if(events[i].events & EPOLLIN) {
+                    receive(connection);
+                }
+                if(connection->fd < 0) {
+                    continue;
+                }
+                if(events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    drop(connection);
+                } else if(events[i].events & EPOLLOUT) {
+                    std::lock_guard<std::mutex> lock(connection->mutex);
+                    flush(*connection);
+                }
+            }
+        }
+
+        _scheduler.stop();
+        while(!_connections.empty()) {
+            std::shared_ptr<Connection> connection = _connections.begin()->second;
+            drop(connection);
+        }
+        close(_epoll);
+        _epoll = -1;
+        close(_listener);
+        _listener = -1;
+        unlink(_path.c_str());
+        LOG(INFO) << _Tag << "Stopped";
+    }
+
+    void Daemon::stop()
+    {
+        // Only write, which is safe in a signal handler.
+        Uint64 one = 1;
+        ssize_t written = write(_wake, &one, sizeof(one));
+        (void) written;
+    }
+
+    void Daemon::accept()
+    {
+        while(true) {
+            int fd = accept4(_listener, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(fd < 0) {
+                if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG(INFO) << _Tag << "Failed to accept a client - " << strerror(errno);
+                }
+                return;
+            }
+
+            std::shared_ptr<Connection> connection(new Connection());
+            connection->fd = fd;
+            connection->writing = false;
+            connection->fresh = true;
+            connection->frame = 0;
+            connection->acked = 0;
+            connection->sentHash = 0;
+            connection->sentFlags = 0;
+
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if(epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+                LOG(INFO) << _Tag << "Failed to watch a client - " << strerror(errno);
+                close(fd);
+                continue;
+            }
+            _connections[fd] = connection;
+            LOG(INFO) << _Tag << "Client " << fd << " connected, " << _connections.size() << " connected";
+        }
+    }
+
+    void Daemon::receive(const std::shared_ptr<Connection> &connection)
+    {
+        Connection &c = *connection;
+        Uint8 buffer[0x1000];
+        while(true) {
+            ssize_t got = recv(c.fd, buffer, sizeof(buffer), 0);
+            if(got == 0) {
+                drop(connection);
+                return;
+            }
+            if(got < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG(INFO) << _Tag << "Failed to read from client " << c.fd << " - " << strerror(errno);
+                    drop(connection);
+                }
+                return;
+            }
+            c.input.insert(c.input.end(), buffer, buffer + got);
+
+            // Handled as they arrive, so a client can't make the input grow
+            // past one message.
+            size_t at = 0;
+            while(c.input.size() - at >= HeaderSize) {
+                Uint8 type = c.input[at];
+                Uint32 size = get32(&c.input[at + 1]);
+                if(size > StartSize + Memory::MaxAddress - Memory::StartAddress) {
+                    fail(connection, "Message too large");
+                    return;
+                }
+                if(c.input.size() - at - HeaderSize < size) {
+                    break;
+                }
+                if(!handle(connection, type, &c.input[at + HeaderSize], size)) {
+                    return;
+                }
+                at += HeaderSize + size;
+            }
+            c.input.erase(c.input.begin(), c.input.begin() + at);
+        }
+    }
+
+    bool Daemon::handle(const std::shared_ptr<Connection> &connection, Uint8 type, const Uint8 *payload, Uint32 size)
+    {
+        Connection &c = *connection;
+        switch(type) {
+            case Start:
+                return start(connection, payload, size);
+            case Keys:
+                if(size != 2) {
+                    fail(connection, "Keys takes 2 bytes");
+                    return false;
+                }
+                if(!c.session) {
+                    fail(connection, "No ROM started");
+                    return false;
+                }
+                _scheduler.setKeys(c.session, get16(payload));
+                return true;
+            case Ack:
+                if(size != 4) {
+                    fail(connection, "Ack takes 4 bytes");
+                    return false;
+                } else {
+                    // Acks of frames not sent yet, or too old to be a base,
+                    // are ignored.
+                    Uint32 frame = get32(payload);
+                    std::lock_guard<std::mutex> lock(c.mutex);
+                    if(frame > c.acked && frame <= c.frame && c.frame - frame < HistorySize) {
+                        c.acked = frame;
+                    }
+                }
+                return true;
+            default:
+                fail(connection, "Unknown message type");
+                return false;
+        }
+    }
+
+    bool Daemon::start(const std::shared_ptr<Connection> &connection, const Uint8 *payload, Uint32 size)
+    {
+        Connection &c = *connection;
+        if(size <= StartSize) {
+            fail(connection, "Start takes cycles, a seed and a ROM");
+            return false;
+        }
+        unsigned int cycles = get16(payload);
+        if(cycles < 1 || cycles > MaxCycles) {
+            fail(connection, "Cycles must be 1 to 1000");
+            return false;
+        }
+        std::vector<unsigned char> rom(payload + StartSize, payload + size);
+        std::unique_ptr<Machine> machine(new Machine());
+        if(!machine->reset(rom)) {
+            fail(connection, "ROM doesn't fit in memory");
+            return false;
+        }
+        machine->setCyclesPerFrame((int) cycles);
+        machine->cpu().seed(get32(payload + 2));
+
+        if(c.session) {
+            {
+                std::lock_guard<std::mutex> lock(_sessionsMutex);
+                _sessions.erase(c.session->id());
+            }
+            _scheduler.remove(c.session);
+        }
+        {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            c.fresh = true;
+        }
+
+        // The map is locked until the session is in it, so its first frame
+        // can't run before the callback can find the connection.
+        {
+            std::lock_guard<std::mutex> lock(_sessionsMutex);
+            c.session = _scheduler.add(std::move(machine));
+            _sessions[c.session->id()] = connection;
+        }
+        LOG(INFO) << _Tag << "Client " << c.fd << " started session " << c.session->id() << " with a " << rom.size()
+                  << " byte ROM at " << cycles << " cycles per frame";
+
+        Uint8 started[4];
+        put32(started, c.session->id());
+        std::lock_guard<std::mutex> lock(c.mutex);
+        send(c, Started, started, sizeof(started));
+        return true;
+    }
+
+    void Daemon::sendFrame(Scheduler::Session &session)
+    {
+        std::shared_ptr<Connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(_sessionsMutex);
+            std::unordered_map<unsigned int, std::shared_ptr<Connection> >::iterator found = _sessions.find(session.id());
+            if(found == _sessions.end()) {
+                return;
+            }
+            connection = found->second;
+        }
+
+        Machine &machine = session.machine();
+        Uint64 hash = machine.video().frameHash();
+        Uint8 flags = machine.timers().getSoundTimer() > 0 ? BuzzerFlag : 0;
+
+        Connection &c = *connection;
+        std::lock_guard<std::mutex> lock(c.mutex);
+        if(c.fd < 0 || (!c.fresh && hash == c.sentHash && flags == c.sentFlags)) {
+            return;
+        }
+        if(c.output.size() > MaxQueued) {
+            return;
+        }
+
+        // The screen is kept until it is too old to be a base, and only
+        // frames that new are used as one.
+        Uint32 number = c.frame + 1;
+        Uint64 (*screen)[32] = c.history[number % HistorySize];
+        for(int p = 0; p < 2; p++) {
+            memcpy(screen[p], machine.video().getPlane(p), sizeof(screen[p]));
+        }
+        Uint32 base = c.acked != 0 && number - c.acked < HistorySize ? c.acked : 0;
+
+        size_t start = c.output.size();
+        c.output.resize(start + HeaderSize + FrameSize);
+        Uint8 *header = &c.output[start];
+        header[0] = Frame;
+        put32(header + HeaderSize, number);
+        put32(header + HeaderSize + 4, base);
+        header[HeaderSize + 8] = flags;
+        FrameCodec::encode(screen, base != 0 ? c.history[base % HistorySize] : 0, c.output);
+        put32(&c.output[start + 1], (Uint32) (c.output.size() - start - HeaderSize));
+
+        c.frame = number;
+        c.sentHash = hash;
+        c.sentFlags = flags;
+        c.fresh = false;
+        flush(c);
+    }
+
+    void Daemon::send(Connection &connection, Uint8 type, const Uint8 *payload, size_t size)
+    {
+        Uint8 header[HeaderSize];
+        header[0] = type;
+        put32(header + 1, (Uint32) size);
+        connection.output.insert(connection.output.end(), header, header + HeaderSize);
+        connection.output.insert(connection.output.end(), payload, payload + size);
+        flush(connection);
+    }
+
+    void Daemon::flush(Connection &connection)
+    {
+        if(connection.fd < 0) {
+            return;
+        }
+        size_t sent = 0;
+        while(sent < connection.output.size()) {
+            ssize_t wrote = ::send(connection.fd, &connection.output[sent], connection.output.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(wrote > 0) {
+                sent += wrote;
+            } else if(wrote < 0 && errno == EINTR) {
+                continue;
+            } else {
+                // Full, or broken, which epoll reports to the epoll thread.
+                break;
+            }
+        }
+        connection.output.erase(connection.output.begin(), connection.output.begin() + sent);
+
+        bool pending = !connection.output.empty();
+        if(pending != connection.writing) {
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN | (pending ? EPOLLOUT : 0);
+            event.data.fd = connection.fd;
+            epoll_ctl(_epoll, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.writing = pending;
+        }
+    }
+
+    void Daemon::fail(const std::shared_ptr<Connection> &connection, const std::string &message)
+    {
+        LOG(INFO) << _Tag << "Dropping client " << connection->fd << " - " << message;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            send(*connection, Error, (const Uint8 *) message.data(), message.size());
+        }
+        drop(connection);
+    }
+
+    void Daemon::drop(const std::shared_ptr<Connection> &connection)
+    {
+        Connection &c = *connection;
+        if(c.session) {
+            {
+                std::lock_guard<std::mutex> lock(_sessionsMutex);
+                _sessions.erase(c.session->id());
+            }
+            _scheduler.remove(c.session);
+            c.session.reset();
+        }
+
+        // Closed under the lock, so a worker holding the connection can't
+        // write to a socket number that has been reused.
+        int fd = c.fd;
+        {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            close(c.fd);
+            c.fd = -1;
+        }
+        _connections.erase(fd);
+        LOG(INFO) << _Tag << "Client " << fd << " disconnected, " << _connections.size() << " connected";
+    }
+}
@@ -0,0 +1,161 @@
+/**
+* @file Daemon.hpp
+* @brief Serves emulator sessions to clients on a Unix domain socket.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_DAEMON_HPP
+#define CHIP8_DAEMON_HPP
+
+#include <Scheduler.hpp>
+
+#include <SDL_stdinc.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Hosts one session per client connection. The sockets are served
+    *        by a single epoll thread and the machines run on a Scheduler.
+    *
+    *        Every message is a type byte, a 4 byte payload length and the
+    *        payload. Numbers are little endian. A client sends:
+    *
+    *        - Start (1): cycles per frame (2 bytes), random seed (4 bytes)
+    *          and the ROM. Starts the ROM, replacing any session already
+    *          running, and is answered with Started.
+    *        - Keys (2): the 16 key mask (2 bytes) held from the next frame.
+    *        - Ack (3): the number (4 bytes) of a frame the client decoded.
+    *
+    *        The daemon sends:
+    *
+    *        - Started (0x81): the session id (4 bytes).
+    *        - Frame (0x82): the frame number (4 bytes), the number of the
+    *          base frame it is encoded against (4 bytes, 0 for a blank
+    *          screen), flags (1 byte, bit 0 set while the buzzer sounds) and
+    *          the screen encoded by FrameCodec.
+    *        - Error (0x83): a message, after which the connection is closed.
+    *
+    *        A frame is only sent when the screen or the buzzer changed, and
+    *        is numbered from 1 per connection. Its base is the newest frame
+    *        the client acknowledged, or blank once that is HistorySize or
+    *        more frames old, so a client that keeps its last HistorySize
+    *        frames can always decode. A client that stops reading has frames
+    *        dropped rather than queued; the next one sent still decodes.
+    */
+    class Daemon
+    {
+        public:
+
+            /**
+            * @brief The number of sent frames the daemon can still use as
+            *        bases.
+            */
+            static const unsigned int HistorySize = 32;
+
+            /**
+            * @brief Creates a daemon that runs its sessions on workers
+            *        threads.
+            */
+            explicit Daemon(unsigned int workers);
+
+            ~Daemon();
+
+            /**
+            * @brief Listens on the socket at path, replacing a stale one.
+            *
+            * @return False if the socket couldn't be opened.
+            */
+            bool open(const std::string &path);
+
+            /**
+            * @brief Serves clients until stop is called, then drops them and
+            *        closes the socket.
+            */
+            void run();
+
+            /**
+            * @brief Makes run return. Safe to call from any thread or a
+            *        signal handler.
+            */
+            void stop();
+
+        private:
+            Daemon(const Daemon &other);
+            Daemon & operator=(const Daemon &other);
+
+            struct Connection
+            {
+                // Guards everything below that a worker thread touches:
+                // the fd while it is closed, the output and the frames.
+                std::mutex mutex;
+                int fd;
+                bool writing;
+                // Set when the next frame must be sent even if unchanged.
+                bool fresh;
+                std::vector<Uint8> output;
+                Uint32 frame;
+                Uint32 acked;
+                Uint64 sentHash;
+                Uint8 sentFlags;
+                Uint64 history[HistorySize][2][32];
+
+                // Only the epoll thread touches these.
+                std::vector<Uint8> input;
+                std::shared_ptr<Scheduler::Session> session;
+            };
+
+            // Accepts every waiting client.
+            void accept();
+
+            // Reads what a client sent and handles each whole message.
+            void receive(const std::shared_ptr<Connection> &connection);
+
+            // Handles one message, false if the client must be dropped.
+            bool handle(const std::shared_ptr<Connection> &connection, Uint8 type, const Uint8 *payload, Uint32 size);
+
+            // Starts a client's ROM.
+            bool start(const std::shared_ptr<Connection> &connection, const Uint8 *payload, Uint32 size);
+
+            // Encodes and queues a session's screen, on a worker thread.
+            void sendFrame(Scheduler::Session &session);
+
+            // Queues a message and writes what the socket takes. The
+            // connection's mutex must be held.
+            void send(Connection &connection, Uint8 type, const Uint8 *payload, size_t size);
+
+            // Writes queued output, watching for the socket to take more if
+            // some is left. The connection's mutex must be held.
+            void flush(Connection &connection);
+
+            // Sends an error and drops the client.
+            void fail(const std::shared_ptr<Connection> &connection, const std::string &message);
+
+            // Stops the client's session and closes its socket.
+            void drop(const std::shared_ptr<Connection> &connection);
+
+            Scheduler _scheduler;
+            std::string _path;
+            int _listener;
+            int _epoll;
+            int _wake;
+
+            // Connections by socket, for the epoll thread.
+            std::unordered_map<int, std::shared_ptr<Connection> > _connections;
+
+            // Connections by session id, for the frame callback.
+            std::mutex _sessionsMutex;
+            std::unordered_map<unsigned int, std::shared_ptr<Connection> > _sessions;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
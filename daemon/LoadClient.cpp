@@ -0,0 +1,269 @@
+// Connects many clients to chip8d, starts a ROM on each, presses random keys
+// and decodes every frame, reporting what the frames cost on the wire.
+//
+// chip8d-load [--socket=PATH] [--clients=N] [--seconds=N] [--cycles=N]
+//             [--presses=N] romfile
+//
+// Every second --presses random clients change their keys. Each report line
+// gives the frames and bytes received and the bytes per frame. A frame whose
+// base the client doesn't have, or that doesn't decode, is an error, and the
+// program exits with 1 if there were any.
+
+#include "Daemon.hpp"
+
+#include <FileUtils.hpp>
+#include <FrameCodec.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <errno.h>
+#include <iostream>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const unsigned int HistorySize = Chip8::Daemon::HistorySize;
+    const size_t HeaderSize = 5;
+
+    struct Client
+    {
+        int fd;
+        std::vector<Uint8> input;
+        Uint32 numbers[HistorySize];
+        Uint64 screens[HistorySize][2][32];
+    };
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result > 0;
+    }
+
+    unsigned int nextRandom(unsigned int &random)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    void put32(Uint8 *data, Uint32 value)
+    {
+        for(int i = 0; i < 4; i++) {
+            data[i] = (value >> (i * 8)) & 0xFF;
+        }
+    }
+
+    Uint32 get32(const Uint8 *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32) data[3] << 24);
+    }
+
+    // Writes a whole message, blocking, false if the daemon went away.
+    bool sendMessage(int fd, Uint8 type, const Uint8 *payload, size_t size)
+    {
+        std::vector<Uint8> message(HeaderSize + size);
+        message[0] = type;
+        put32(&message[1], (Uint32) size);
+        if(size > 0) {
+            memcpy(&message[HeaderSize], payload, size);
+        }
+        size_t sent = 0;
+        while(sent < message.size()) {
+            ssize_t wrote = send(fd, &message[sent], message.size() - sent, MSG_NOSIGNAL);
+            if(wrote < 0 && errno == EINTR) {
+                continue;
+            }
+            if(wrote <= 0) {
+                return false;
+            }
+            sent += wrote;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::string romName;
+    std::string path = "/tmp/chip8d.sock";
+    long clients = 100;
+    long seconds = 10;
+    long cycles = 10;
+    long presses = 10;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            valid = romName.empty();
+            romName = arg;
+        } else if(name == "--socket") {
+            path = value;
+            valid = !path.empty();
+        } else if(name == "--clients") {
+            valid = parseNumber(value, clients);
+        } else if(name == "--seconds") {
+            valid = parseNumber(value, seconds);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles) && cycles <= 1000;
+        } else if(name == "--presses") {
+            valid = parseNumber(value, presses);
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || romName.empty()) {
+        std::cout << "Usage: chip8d-load [--socket=PATH] [--clients=N] [--seconds=N] [--cycles=N]" << std::endl
+                  << "                   [--presses=N] romfile" << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
+    if(rom.empty()) {
+        std::cout << "Failed to read " << romName << std::endl;
+        return 1;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    std::vector<Client> all(clients);
+    std::vector<pollfd> polls(clients);
+    for(long i = 0; i < clients; i++) {
+        Client &client = all[i];
+        memset(client.numbers, 0, sizeof(client.numbers));
+        client.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(client.fd < 0 || connect(client.fd, (const sockaddr *) &address, sizeof(address)) < 0) {
+            std::cout << "Failed to connect to " << path << " - " << strerror(errno) << std::endl;
+            return 1;
+        }
+        std::vector<Uint8> start(6);
+        start[0] = cycles & 0xFF;
+        start[1] = (cycles >> 8) & 0xFF;
+        put32(&start[2], (Uint32) i);
+        start.insert(start.end(), rom.begin(), rom.end());
+        if(!sendMessage(client.fd, 0x01, &start[0], start.size())) {
+            std::cout << "Failed to start client " << i << std::endl;
+            return 1;
+        }
+        polls[i].fd = client.fd;
+        polls[i].events = POLLIN;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    unsigned int random = 1;
+    Uint64 frames = 0;
+    Uint64 bytes = 0;
+    Uint64 keyframes = 0;
+    Uint64 errors = 0;
+    Uint64 totalFrames = 0;
+    Uint64 totalBytes = 0;
+    Clock::time_point end = Clock::now() + std::chrono::seconds(seconds);
+    Clock::time_point report = Clock::now() + std::chrono::seconds(1);
+    while(Clock::now() < end) {
+        int ready = poll(&polls[0], polls.size(), 100);
+        if(ready < 0 && errno != EINTR) {
+            std::cout << "Failed to poll - " << strerror(errno) << std::endl;
+            return 1;
+        }
+        for(long i = 0; i < clients && ready > 0; i++) {
+            if(polls[i].revents == 0) {
+                continue;
+            }
+            Client &client = all[i];
+            Uint8 buffer[0x1000];
+            ssize_t got = recv(client.fd, buffer, sizeof(buffer), 0);
+            if(got <= 0) {
+                std::cout << "Client " << i << " was disconnected" << std::endl;
+                return 1;
+            }
+            client.input.insert(client.input.end(), buffer, buffer + got);
+
+            size_t at = 0;
+            while(client.input.size() - at >= HeaderSize) {
+                Uint8 type = client.input[at];
+                Uint32 size = get32(&client.input[at + 1]);
+                if(client.input.size() - at - HeaderSize < size) {
+                    break;
+                }
+                const Uint8 *payload = &client.input[at + HeaderSize];
+                at += HeaderSize + size;
+                if(type == 0x83) {
+                    std::cout << "Client " << i << " failed - " << std::string((const char *) payload, size) << std::endl;
+                    return 1;
+                }
+                if(type != 0x82 || size < 9) {
+                    continue;
+                }
+
+                Uint32 number = get32(payload);
+                Uint32 base = get32(payload + 4);
+                const Uint64 (*baseScreen)[32] = 0;
+                if(base != 0) {
+                    if(client.numbers[base % HistorySize] != base) {
+                        errors++;
+                        continue;
+                    }
+                    baseScreen = client.screens[base % HistorySize];
+                } else {
+                    keyframes++;
+                }
+                if(!Chip8::FrameCodec::decode(payload + 9, size - 9, baseScreen, client.screens[number % HistorySize])) {
+                    errors++;
+                    client.numbers[number % HistorySize] = 0;
+                    continue;
+                }
+                client.numbers[number % HistorySize] = number;
+                frames++;
+                bytes += HeaderSize + size;
+
+                Uint8 ack[4];
+                put32(ack, number);
+                sendMessage(client.fd, 0x03, ack, sizeof(ack));
+            }
+            client.input.erase(client.input.begin(), client.input.begin() + at);
+        }
+
+        if(Clock::now() >= report) {
+            for(long p = 0; p < presses; p++) {
+                Client &client = all[nextRandom(random) % all.size()];
+                Uint16 keys = nextRandom(random) % 2 == 0 ? (Uint16) (1 << (nextRandom(random) & 0xF)) : 0;
+                Uint8 payload[2] = { (Uint8) (keys & 0xFF), (Uint8) (keys >> 8) };
+                sendMessage(client.fd, 0x02, payload, sizeof(payload));
+            }
+            std::cout << "frames " << frames << " bytes " << bytes << " bytes/frame "
+                      << (frames > 0 ? (double) bytes / frames : 0.0) << " keyframes " << keyframes
+                      << " errors " << errors << std::endl;
+            totalFrames += frames;
+            totalBytes += bytes;
+            frames = 0;
+            bytes = 0;
+            keyframes = 0;
+            report += std::chrono::seconds(1);
+        }
+    }
+
+    std::cout << "total frames " << totalFrames << " bytes/frame "
+              << (totalFrames > 0 ? (double) totalBytes / totalFrames : 0.0) << " errors " << errors << std::endl;
+    for(long i = 0; i < clients; i++) {
+        close(all[i].fd);
+    }
+    return errors == 0 ? 0 : 1;
+}
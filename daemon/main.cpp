@@ -0,0 +1,82 @@
+// chip8d, a daemon that runs emulator sessions for clients on a Unix domain
+// socket, see Daemon.hpp for the protocol.
+//
+// chip8d [--socket=PATH] [--workers=N]
+//
+// Runs until SIGINT or SIGTERM, then drops its clients and removes the
+// socket.
+
+#include "Daemon.hpp"
+
+#include <glog/logging.h>
+
+#include <iostream>
+#include <signal.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+namespace
+{
+    Chip8::Daemon *running = 0;
+
+    void onSignal(int)
+    {
+        if(running != 0) {
+            running->stop();
+        }
+    }
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result > 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    std::string path = "/tmp/chip8d.sock";
+    long workers = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(name == "--socket") {
+            path = value;
+            valid = !path.empty();
+        } else if(name == "--workers") {
+            valid = parseNumber(value, workers);
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid) {
+        std::cout << "Usage: chip8d [--socket=PATH] [--workers=N]" << std::endl;
+        return 2;
+    }
+
+    Chip8::Daemon daemon((unsigned int) workers);
+    if(!daemon.open(path)) {
+        std::cout << "Failed to listen on " << path << std::endl;
+        return 1;
+    }
+    running = &daemon;
+    struct sigaction action;
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    daemon.run();
+    running = 0;
+    return 0;
+}
@@ -0,0 +1,72 @@
+// libFuzzer target for the interpreter core. Each input boots a headless
+// machine and runs it for a bounded number of frames, so ASan and UBSan see
+// every opcode the fuzzer can reach.
+//
+// Input layout:
+//     byte 0             Instructions per frame, 1 to MaxCycles.
+//     byte 1             Frames to run, 1 to MaxFrames.
+//     2 bytes per frame  Key mask held during that frame, little endian.
+//     the rest           The ROM, loaded at Memory::StartAddress.
+//
+// A short input uses what it has for the keys and runs an empty ROM.
+
+#include <Machine.hpp>
+#include <Memory.hpp>
+
+#include <glog/logging.h>
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace
+{
+    // Bounds the work per input, so slow units are real hangs.
+    const size_t MaxCycles = 32;
+    const size_t MaxFrames = 64;
+
+    Chip8::Machine *machine = 0;
+}
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    google::InitGoogleLogging((*argv)[0]);
+    // Every instruction logs at INFO, which would drown the fuzzer.
+    FLAGS_minloglevel = google::GLOG_FATAL;
+
+    // Resetting one machine per input keeps runs independent without
+    // constructing a machine each time.
+    machine = new Chip8::Machine();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if(size < 2) {
+        return 0;
+    }
+    size_t cycles = 1 + data[0] % MaxCycles;
+    size_t frames = 1 + data[1] % MaxFrames;
+    data += 2;
+    size -= 2;
+
+    size_t keyBytes = frames * 2 < size ? frames * 2 : size;
+    const uint8_t *keys = data;
+    std::vector<unsigned char> rom(data + keyBytes, data + size);
+
+    if(!machine->reset(rom)) {
+        return 0;
+    }
+    machine->setCyclesPerFrame((int) cycles);
+    machine->cpu().seed(0);
+    for(size_t frame = 0; frame < frames; frame++) {
+        Uint16 mask = 0;
+        if(frame * 2 + 1 < keyBytes) {
+            mask = (Uint16) (keys[frame * 2] | (keys[frame * 2 + 1] << 8));
+        }
+        machine->setKeys(mask);
+        machine->stepFrame();
+    }
+    return 0;
+}
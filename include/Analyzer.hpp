@@ -0,0 +1,167 @@
+/**
+* @file Analyzer.hpp
+* @brief Static analysis of a ROM into basic blocks and a code/data map.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_ANALYZER_HPP
+#define CHIP8_ANALYZER_HPP
+
+#include <SDL_stdinc.h>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Decodes a ROM from Memory::StartAddress without running it. Jumps,
+    *        calls and skips are followed recursively to find the code and split
+    *        it into basic blocks. Where the I register holds a known address at
+    *        a DXYN the sprite bytes are marked, and likewise the bytes FX33,
+    *        FX55, FX65, 5XY2 and 5XY3 touch are marked as data.
+    *
+    *        Results are cached by a hash of the ROM, so anything that wants the
+    *        blocks of the running ROM can ask for them again cheaply.
+    */
+    class Analyzer
+    {
+        public:
+
+            /**
+            * @brief What a ROM byte was found to be, as bit flags. A byte can be
+            *        more than one, for example code that is also drawn.
+            */
+            enum Flag
+            {
+                Code = 0x1,
+                Sprite = 0x2,
+                Data = 0x4
+            };
+
+            /**
+            * @brief How control leaves a basic block.
+            */
+            enum Exit
+            {
+                // Falls into the next block, which is a jump target.
+                FallThrough,
+                // 1NNN.
+                Jump,
+                // 2NNN, the successors are the subroutine and the return site.
+                Call,
+                // 00EE.
+                Return,
+                // A skip, the successors are the next and the skipped-to instruction.
+                Skip,
+                // BNNN, the target depends on V0.
+                IndirectJump,
+                // A jump to itself, which is how most ROMs stop.
+                Halt,
+                // The next two bytes aren't an instruction the Cpu knows.
+                Invalid,
+                // Runs past the end of the ROM.
+                End
+            };
+
+            /**
+            * @brief A straight run of instructions entered only at the top.
+            */
+            struct Block
+            {
+                // First address and one past the last byte of the block.
+                unsigned int start;
+                unsigned int end;
+                Exit exit;
+                // Addresses control can continue at, in the ROM or not.
+                std::vector<unsigned int> successors;
+                // True if some 2NNN calls start.
+                bool subroutine;
+            };
+
+            /**
+            * @brief The result of analyzing one ROM.
+            */
+            struct Analysis
+            {
+                Uint64 hash;
+                std::vector<unsigned char> rom;
+                // Flags of each ROM byte, map[i] is address StartAddress + i.
+                std::vector<unsigned char> map;
+                // Sorted by start address.
+                std::vector<Block> blocks;
+
+                /**
+                * @brief Gets the flags of address, 0 outside the ROM.
+                */
+                unsigned char flags(unsigned int address) const;
+
+                /**
+                * @brief Gets the block starting at address.
+                *
+                * @return The block, or NULL if no block starts there.
+                */
+                const Block * findBlock(unsigned int address) const;
+            };
+
+            /**
+            * @brief Analyzes rom, or returns the cached analysis of an identical ROM.
+            *
+            * @param rom The ROM as loaded at Memory::StartAddress.
+            *
+            * @return The analysis, shared with the cache.
+            */
+            static std::shared_ptr<const Analysis> analyze(const std::vector<unsigned char> &rom);
+
+            /**
+            * @brief Drops every cached analysis.
+            */
+            static void clearCache();
+
+            /**
+            * @brief Hashes rom with 64 bit FNV-1a.
+            */
+            static Uint64 hash(const std::vector<unsigned char> &rom);
+
+            /**
+            * @brief Gets the length in bytes of the instruction starting with
+            *        upper and lower, 4 for F000 NNNN and 2 for the rest.
+            */
+            static unsigned int instructionLength(unsigned char upper, unsigned char lower);
+
+            /**
+            * @brief Disassembles one instruction.
+            *
+            * @param opcode The first two bytes of the instruction.
+            * @param operand The next two bytes, used by F000 NNNN.
+            *
+            * @return The instruction in Cowgod's mnemonics, or DW for bytes
+            *         the Cpu does not execute.
+            */
+            static std::string disassemble(unsigned int opcode, unsigned int operand);
+
+            /**
+            * @brief Writes a listing with block labels, instructions and data.
+            */
+            static void writeDisassembly(const Analysis &analysis, std::ostream &out);
+
+            /**
+            * @brief Writes the blocks and their edges as a Graphviz digraph.
+            */
+            static void writeCfg(const Analysis &analysis, std::ostream &out);
+
+            /**
+            * @brief Writes the code/data map as address ranges.
+            */
+            static void writeMap(const Analysis &analysis, std::ostream &out);
+
+        private:
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+* @file Audio.hpp
+* @brief Plays the Chip8 buzzer.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_AUDIO_HPP
+#define CHIP8_AUDIO_HPP
+
+#include <RingBuffer.hpp>
+
+#include <SDL.h>
+#include <atomic>
+#include <string>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Plays a square wave buzzer while the Sound Timer is > 0.
+    *
+    *        Every 60Hz timer step queues the buzzer state for that step into a
+    *        small lock-free ring. The SDL audio callback consumes one state per
+    *        1/60th of a second of samples and synthesizes the square wave from
+    *        it, so buzzes have exactly the length the ROM asked for. The
+    *        callback never locks or allocates.
+    *
+    *        Playback starts once two steps are queued, and that is the
+    *        latency: steps queued beyond it are dropped, and after the
+    *        emulator falls behind playback waits for two steps again.
+    *
+    *        On a headless box run with SDL_AUDIODRIVER=dummy, or
+    *        SDL_AUDIODRIVER=disk and SDL_DISKAUDIOFILE=out.raw to capture the
+    *        samples.
+    */
+    class Audio
+    {
+        public:
+
+            /**
+            * @brief Gets the singleton instance of the Audio module.
+            *
+            * @return Singleton instance of the Audio module.
+            */
+            static Audio & instance();
+
+            /**
+            * @brief Initializes the SDL audio subsystem and starts playback.
+            *
+            * @return True if an audio device was opened.
+            */
+            bool open();
+
+            /**
+            * @brief Stops playback and closes the audio device.
+            */
+            void close();
+
+            /**
+            * @brief Queues the buzzer state for one timer step. Call this once
+            *        after every Timers::step.
+            *
+            * @param soundTimer The value of ST after the step.
+            */
+            void tick(unsigned int soundTimer);
+
+            /**
+            * @brief Gets the number of times the callback needed a timer step
+            *        that had not been queued yet while the buzzer was on.
+            */
+            Uint64 underruns() const;
+
+            /**
+            * @brief Gets the number of timer steps dropped because the ring was full.
+            */
+            Uint64 overruns() const;
+
+            /**
+            * @brief Sample rate of the output.
+            */
+            static const int SampleRate;
+
+            /**
+            * @brief Frequency of the buzzer in Hz.
+            */
+            static const int BuzzerFrequency;
+
+        private:
+            // For a correct singleton implementation it is necessary to make
+            // the constructor, copy constructor and assignment operators private,
+            // so that there isn't any accidental copying.
+            Audio();
+            Audio(const Audio &other);
+            Audio & operator=(const Audio &other);
+
+            // SDL audio callback, forwards to fill.
+            static void callback(void *userdata, Uint8 *stream, int length);
+
+            // Synthesizes count samples into samples. Runs on the audio thread.
+            void fill(Sint16 *samples, int count);
+
+            // One buzzer state per timer step.
+            RingBuffer<unsigned char> _ticks;
+            SDL_AudioDeviceID _device;
+            int _samplesPerTick;
+
+            // Audio thread only.
+            bool _started;
+            bool _buzzing;
+            int _tickSamplesLeft;
+            Uint32 _phase;
+            Uint32 _phaseStep;
+
+            std::atomic<Uint64> _underruns;
+            std::atomic<Uint64> _overruns;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
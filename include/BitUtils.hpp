@@ -9,6 +9,7 @@
 #ifndef CHIP8_BITUTILS_HPP
 #define CHIP8_BITUTILS_HPP
 
+#include <SDL_stdinc.h>
 #include <string>
 
 namespace Chip8
@@ -61,6 +62,27 @@ namespace Chip8
             */
             static unsigned int combine(unsigned char data1, unsigned char data2);
 
+            /**
+            * @brief Rotates a 64 bit word right, bits shifted out of the least
+            *        significant end come back in at the most significant end.
+            *
+            * @param data The word to rotate.
+            * @param count The number of bits to rotate by (0-63).
+            *
+            * @return data rotated right by count bits.
+            */
+            static Uint64 rotateRight(Uint64 data, unsigned int count);
+
+            /**
+            * @brief Scrambles a 64 bit word so every input bit affects every
+            *        output bit (the SplitMix64 finalizer).
+            *
+            * @param data The word to scramble.
+            *
+            * @return The scrambled word, 0 only for 0.
+            */
+            static Uint64 mix(Uint64 data);
+
         private:
 
             static const std::string _Tag;
@@ -0,0 +1,146 @@
+/**
+* @file Capture.hpp
+* @brief Records presented frames to a file or pipe.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_CAPTURE_HPP
+#define CHIP8_CAPTURE_HPP
+
+#include <RingBuffer.hpp>
+
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Chip8
+{
+    class Video;
+
+    /**
+    * @brief Streams presented frames as Y4M or raw RGBA to a file or stdout
+    *        (for piping into ffmpeg). Frames are queued in their packed 1 bit
+    *        per plane form and expanded on a background writer thread, so the
+    *        emulator never waits on disk I/O. When the queue is full frames are
+    *        dropped and the previous frame is repeated in their place, which
+    *        keeps the recording in time.
+    */
+    class Capture
+    {
+        public:
+
+            /**
+            * @brief Output formats.
+            */
+            enum Format
+            {
+                // YUV4MPEG2, 4:4:4, 60 fps.
+                Y4M,
+                // Raw RGBA, 4 bytes per pixel, no header.
+                RGBA
+            };
+
+            Capture();
+            ~Capture();
+
+            /**
+            * @brief Opens the output and starts the writer thread.
+            *
+            * @param path The file to write to, "-" writes to stdout.
+            * @param format The format to write.
+            *
+            * @return True if the output was opened.
+            */
+            bool open(const std::string &path, Format format);
+
+            /**
+            * @brief Writes out everything still queued, then stops the writer
+            *        thread and closes the output.
+            */
+            void close();
+
+            /**
+            * @brief Checks if a capture is running.
+            */
+            bool isOpen() const;
+
+            /**
+            * @brief Queues the current contents of video. Never blocks. A frame
+            *        that is identical to the previous one only queues a repeat
+            *        marker.
+            *
+            * @param video The video to capture.
+            */
+            void pushFrame(const Video &video);
+
+            /**
+            * @brief Gets the number of frames dropped because the queue was full.
+            */
+            Uint64 droppedFrames() const;
+
+            /**
+            * @brief Gets the number of frames written, including repeats.
+            */
+            Uint64 writtenFrames() const;
+
+            /**
+            * @brief Parses a format name (y4m, rgba).
+            *
+            * @param name The name to parse.
+            * @param format The parsed format is stored here.
+            *
+            * @return True if name was a valid format.
+            */
+            static bool parseFormat(const std::string &name, Format &format);
+
+        private:
+            Capture(const Capture &other);
+            Capture & operator=(const Capture &other);
+
+            // A queue entry, either a packed frame or a repeat of the previous one.
+            struct Entry
+            {
+                // Number of times to repeat the previous frame, 0 for a new frame.
+                Uint32 repeats;
+                Uint64 planes[2][32];
+                Uint8 colors[4][3];
+            };
+
+            // Queues the pending repeats, returns false if the queue was full.
+            bool flushRepeats();
+
+            // Writer thread main loop.
+            void run();
+
+            // Expands entry into _expanded in the output format.
+            void expand(const Entry &entry);
+
+            // Writes _expanded to the output.
+            void write();
+
+            RingBuffer<Entry> _queue;
+            std::thread _writer;
+            std::atomic<bool> _stopping;
+            FILE *_file;
+            Format _format;
+
+            // Producer side.
+            Entry _last;
+            bool _hasLast;
+            Uint32 _pendingRepeats;
+            std::atomic<Uint64> _dropped;
+
+            // Writer side.
+            std::vector<Uint8> _expanded;
+            std::atomic<Uint64> _written;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -0,0 +1,158 @@
+/**
+* @file Checkpoint.hpp
+* @brief Saves the machines of a long batch run to a file they can resume from.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_CHECKPOINT_HPP
+#define CHIP8_CHECKPOINT_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <string>
+
+namespace Chip8
+{
+
+    /**
+    * @brief A file holding the state of every machine in a batch run, so a
+    *        run that is killed picks up where its last checkpoint left off
+    *        instead of starting again.
+    *
+    *        The file is a Header followed by one Job per machine, in host
+    *        byte order. It is written through a memory map into path.tmp,
+    *        flushed to disk and only then renamed over path, so path always
+    *        holds either the previous checkpoint or the new one, complete,
+    *        whenever the process or the machine dies.
+    *
+    *        To write one, call begin, fill in every Job it returns and call
+    *        commit. To resume, call load and restore each Job.
+    */
+    class Checkpoint
+    {
+        public:
+
+            /**
+            * @brief One machine of the run.
+            */
+            struct Job
+            {
+                // RAM, registers, PC, stack, timers, screen, keypad and
+                // random number generator.
+                Machine::State machine;
+                // Frames the machine has run.
+                Uint64 frame;
+                // Where the job's input is up to, for the caller to
+                // interpret.
+                Uint64 input[2];
+                // Identifies the rom, so a job isn't resumed on another.
+                Uint64 romHash;
+            };
+
+            /**
+            * @brief The start of the file.
+            */
+            struct Header
+            {
+                Uint32 magic;
+                Uint32 version;
+                // sizeof(Job), which changes with Machine::State.
+                Uint32 jobSize;
+                Uint32 count;
+                // The caller's identity for the run, as a hash of its
+                // settings, so a checkpoint of another run isn't resumed.
+                Uint64 run;
+                // Checkpoints committed by the run so far, this one included.
+                Uint64 sequence;
+                // Of the jobs, to catch a file damaged after it was written.
+                Uint64 checksum;
+                Uint32 reserved[6];
+            };
+
+            /**
+            * @brief "C8CK" read as a little endian word.
+            */
+            static const Uint32 Magic;
+
+            /**
+            * @brief Changes when Header or Job do.
+            */
+            static const Uint32 Version;
+
+            /**
+            * @brief Creates a checkpoint with nothing mapped.
+            */
+            Checkpoint();
+
+            /**
+            * @brief Unmaps the file, abandoning a checkpoint not committed.
+            */
+            ~Checkpoint();
+
+            /**
+            * @brief Maps a new checkpoint of count jobs for writing, in
+            *        path.tmp until commit.
+            *
+            * @param path The checkpoint file.
+            * @param count The number of jobs.
+            * @param run The caller's identity for the run.
+            * @param sequence The checkpoint's number in the run.
+            *
+            * @return The zeroed jobs to fill in, or null if the file
+            *         couldn't be created.
+            */
+            Job * begin(const std::string &path, size_t count, Uint64 run, Uint64 sequence);
+
+            /**
+            * @brief Writes the jobs to disk and replaces path with them.
+            *
+            * @return False if they couldn't be written, leaving path as it was.
+            */
+            bool commit();
+
+            /**
+            * @brief Maps the checkpoint in path for reading.
+            *
+            * @param path The checkpoint file.
+            * @param run The identity the checkpoint must have been begun with.
+            *
+            * @return The jobs, or null if path doesn't exist or isn't a
+            *         complete checkpoint of run.
+            */
+            const Job * load(const std::string &path, Uint64 run);
+
+            /**
+            * @brief Gets the number of jobs mapped.
+            */
+            size_t count() const;
+
+            /**
+            * @brief Gets the sequence the mapped checkpoint was begun with.
+            */
+            Uint64 sequence() const;
+
+            /**
+            * @brief Unmaps the file, abandoning a checkpoint not committed.
+            */
+            void close();
+
+        private:
+            Checkpoint(const Checkpoint &other);
+            Checkpoint & operator=(const Checkpoint &other);
+
+            // Hashes the jobs that follow header.
+            static Uint64 checksum(const Header &header);
+
+            void *_memory;
+            size_t _size;
+            bool _writing;
+            std::string _path;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
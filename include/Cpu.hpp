@@ -5,7 +5,8 @@
 
 namespace Chip8
 {
-    
+    class Machine;
+
     /**
     * @brief Emulates the Chip8 CPU, which has an 8 bit architecture with 35 opcodes.
     */
@@ -14,12 +15,45 @@ namespace Chip8
         public:
 
             /**
-            * @brief Gets the singleton instance of the Cpu module.
+            * @brief Plain copy of the Cpu registers, used for snapshots.
+            */
+            struct State
+            {
+                int pc;
+                int sp;
+                unsigned int stack[16];
+                unsigned int random;
+            };
+
+            /**
+            * @brief Gets the Cpu module of the Machine bound to the calling thread.
             *
-            * @return Singleton instance of the Cpu module.
+            * @return Cpu module of the current Machine.
             */
             static Cpu & instance();
 
+            /**
+            * @brief Copies the registers into state.
+            *
+            * @param state The state to write to.
+            */
+            void saveState(State &state) const;
+
+            /**
+            * @brief Replaces the registers with state.
+            *
+            * @param state The state to read from.
+            */
+            void loadState(const State &state);
+
+            /**
+            * @brief Seeds the random number generator. Two machines with the
+            *        same seed, ROM and input run identically.
+            *
+            * @param seed The seed, 0 is replaced by a fixed non zero value.
+            */
+            void seed(unsigned int seed);
+
             /**
             * @brief Fetches the next byte from the ROM. Increases
             *        the PC by 1.
@@ -40,6 +74,11 @@ namespace Chip8
             */
             void jump(unsigned int address);
 
+            /**
+            * @brief Gets the address of the next instruction.
+            */
+            unsigned int getPc() const;
+
             /**
             * @brief Calls the subroutine at address.
             *
@@ -82,7 +121,7 @@ namespace Chip8
             *
             * @return A number between 0 - 255
             */
-            unsigned char randomByte() const;
+            unsigned char randomByte();
 
             /**
              * @brief Flag telling the CPU to wait for a key press before continuing
@@ -90,9 +129,10 @@ namespace Chip8
             static bool IsWaitingForKeyPress;
 
         private:
-            // For a correct singleton implementation it is necessary to make
-            // the constructor, copy constructor and assignment operators private,
-            // so that there isn't any accidental copying.
+            // Only a Machine creates modules. The copy constructor and
+            // assignment operators are private so that there isn't any
+            // accidental copying, use State for that.
+            friend class Machine;
             Cpu();
             Cpu(const Cpu &other);
             Cpu & operator=(const Cpu &other);
@@ -106,6 +146,9 @@ namespace Chip8
 
             unsigned int _stack[16];
 
+            // xorshift32 state, kept here so snapshots restore it.
+            unsigned int _random;
+
             static const std::string _Tag;
     };
 }
@@ -0,0 +1,98 @@
+/**
+* @file DedupStore.hpp
+* @brief A set of visited machine state hashes.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_DEDUPSTORE_HPP
+#define CHIP8_DEDUPSTORE_HPP
+
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Remembers which Machine::stateHash values a search has already
+    *        visited, so it can skip states it has seen. The table is a fixed
+    *        size open addressed array of atomic words, so any number of
+    *        threads can insert and query at once without locking. It can be
+    *        saved and loaded to carry what was visited over to the next run.
+    */
+    class DedupStore
+    {
+        public:
+
+            /**
+            * @brief Creates an empty store.
+            *
+            * @param capacity The number of hashes the store holds. The table
+            *                 is at least twice this, so probes stay short.
+            */
+            explicit DedupStore(size_t capacity);
+
+            /**
+            * @brief Adds hash. Once the store holds capacity hashes nothing
+            *        more is added, and hashes that aren't in it stay new.
+            *
+            * @return True if hash wasn't in the store.
+            */
+            bool insert(Uint64 hash);
+
+            /**
+            * @brief Checks if hash is in the store.
+            */
+            bool contains(Uint64 hash) const;
+
+            /**
+            * @brief Gets the number of hashes in the store.
+            */
+            size_t size() const;
+
+            /**
+            * @brief Gets the number of hashes the store can hold.
+            */
+            size_t capacity() const;
+
+            /**
+            * @brief Removes every hash. Not safe to call while other threads
+            *        insert.
+            */
+            void clear();
+
+            /**
+            * @brief Writes every hash to path.
+            *
+            * @return False if the file couldn't be written.
+            */
+            bool save(const std::string &path) const;
+
+            /**
+            * @brief Inserts every hash saved in path.
+            *
+            * @return False if the file is missing or not a store.
+            */
+            bool load(const std::string &path);
+
+        private:
+            DedupStore(const DedupStore &other);
+            DedupStore & operator=(const DedupStore &other);
+
+            // 0 marks an empty slot, so hash 0 is stored as another value.
+            static Uint64 key(Uint64 hash);
+
+            std::unique_ptr<std::atomic<Uint64>[]> _slots;
+            size_t _mask;
+            size_t _capacity;
+            std::atomic<size_t> _size;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
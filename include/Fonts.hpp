@@ -34,33 +34,24 @@ namespace Chip8
             /**
             * @brief Gets the full list of font sprites.
             *
-            * @return Vector of font sprites.
+            * @return Vector of font sprites, built on first use.
             */
-            static std::vector<const unsigned char *> getFonts();
+            static const std::vector<const unsigned char *> & getFonts();
 
-            // Spite declaratins for each single digit hex number.
-            static const unsigned char Zero[];
-            static const unsigned char One[];
-            static const unsigned char Two[];
-            static const unsigned char Three[];
-            static const unsigned char Four[];
-            static const unsigned char Five[];
-            static const unsigned char Six[];
-            static const unsigned char Seven[];
-            static const unsigned char Eight[];
-            static const unsigned char Nine[];
-            static const unsigned char A[];
-            static const unsigned char B[];
-            static const unsigned char C[];
-            static const unsigned char D[];
-            static const unsigned char E[];
-            static const unsigned char F[];
+            /**
+            * @brief The 0-F sprites back to back, SpriteHeight bytes each, laid
+            *        out the way they sit in memory. It is constant data, so
+            *        loading the fonts is one copy.
+            */
+            static const unsigned char Sprites[];
+
+            /**
+            * @brief The size of Sprites in bytes.
+            */
+            static const unsigned int SpritesSize;
 
             // The number of rows he Font sprites contain. Each row is 8 bits.
             static const unsigned char SpriteHeight;
-
-        private:
-            static std::vector<const unsigned char *> _fonts;
     };
 }
 #endif
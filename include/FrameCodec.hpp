@@ -0,0 +1,72 @@
+/**
+* @file FrameCodec.hpp
+* @brief Compresses a screen as the run length encoded XOR against another.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_FRAMECODEC_HPP
+#define CHIP8_FRAMECODEC_HPP
+
+#include <SDL_stdinc.h>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Encodes a screen (both bit planes, as Video keeps them) as the
+    *        difference from a base screen the other side already has.
+    *
+    *        The screen is XORed with the base row by row and the result is
+    *        laid out as plane 0 then plane 1, 32 rows each, 8 bytes a row
+    *        with the leftmost pixel in the high bit of the first byte. That
+    *        is FrameBytes bytes, mostly zero when little changed, which are
+    *        run length encoded as tokens:
+    *
+    *        - 0x00-0x7F: token + 1 zero bytes.
+    *        - 0x80-0xFF: token - 0x7F literal bytes follow.
+    *
+    *        Zeros after the last token are implied, so an unchanged screen
+    *        encodes to nothing and a moved sprite to a few bytes.
+    */
+    class FrameCodec
+    {
+        public:
+
+            /**
+            * @brief The size of a screen laid out as bytes.
+            */
+            static const unsigned int FrameBytes;
+
+            /**
+            * @brief Appends the encoding of screen against base to out.
+            *
+            * @param screen The screen to send.
+            * @param base The screen the receiver has, null for a blank one.
+            */
+            static void encode(const Uint64 screen[2][32], const Uint64 base[2][32], std::vector<Uint8> &out);
+
+            /**
+            * @brief Rebuilds a screen from its encoding and the same base.
+            *
+            * @param data The encoding.
+            * @param size The size of the encoding in bytes.
+            * @param base The base it was encoded against, null for a blank
+            *             one. May be screen.
+            * @param screen Receives the screen.
+            *
+            * @return False if the encoding is malformed, leaving screen
+            *         undefined.
+            */
+            static bool decode(const Uint8 *data, size_t size, const Uint64 base[2][32], Uint64 screen[2][32]);
+
+        private:
+            FrameCodec();
+            FrameCodec(const FrameCodec &other);
+            FrameCodec & operator=(const FrameCodec &other);
+    };
+}
+
+#endif
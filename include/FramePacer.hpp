@@ -0,0 +1,119 @@
+/**
+* @file FramePacer.hpp
+* @brief Keeps the main loop running at a fixed frame rate.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_FRAMEPACER_HPP
+#define CHIP8_FRAMEPACER_HPP
+
+#include <SDL_stdinc.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Paces frames against absolute deadlines on the steady clock. Every
+    *        frame's deadline is the previous deadline plus one period, so time
+    *        spent emulating and sleeping never accumulates as drift. Waiting
+    *        sleeps until shortly before the deadline and spins for the rest,
+    *        because OS sleeps overshoot by up to a millisecond or more.
+    */
+    class FramePacer
+    {
+        public:
+
+            /**
+            * @brief Frame timing statistics over the recent frames.
+            */
+            struct Stats
+            {
+                // Number of frames the statistics cover.
+                Uint64 frames;
+                // Mean time between frames in milliseconds.
+                double meanMs;
+                // 99th percentile time between frames in milliseconds.
+                double p99Ms;
+                // Largest amount a frame started after its deadline, in milliseconds.
+                double maxOverrunMs;
+                // Number of frames that started more than a period late.
+                Uint64 late;
+            };
+
+            /**
+            * @brief Creates a pacer.
+            *
+            * @param hz The frame rate to pace at.
+            */
+            explicit FramePacer(double hz);
+
+            /**
+            * @brief Restarts the schedule, the next deadline is one period from now.
+            */
+            void reset();
+
+            /**
+            * @brief Blocks until the current frame's deadline, then schedules
+            *        the next one. If the loop fell far behind, the schedule
+            *        restarts from now instead of rushing to catch up.
+            */
+            void wait();
+
+            /**
+            * @brief Gets the number of frames since the last resetStats.
+            */
+            Uint64 frames() const;
+
+            /**
+            * @brief Gets the time between the last two frames in milliseconds.
+            */
+            double lastFrameMs() const;
+
+            /**
+            * @brief Gets if the last frame started more than a period late.
+            */
+            bool lastFrameLate() const;
+
+            /**
+            * @brief Gets the statistics for the frames since the last resetStats.
+            */
+            Stats stats() const;
+
+            /**
+            * @brief Clears the statistics.
+            */
+            void resetStats();
+
+            /**
+            * @brief Time left before the deadline that is spun instead of slept.
+            */
+            static const std::chrono::microseconds SpinMargin;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            Clock::duration _period;
+            Clock::time_point _deadline;
+            Clock::time_point _lastFrame;
+            double _lastFrameMs;
+            bool _lastFrameLate;
+            bool _started;
+
+            // Recent frame times in milliseconds, used as a ring.
+            std::vector<double> _frameTimes;
+            // Scratch space for the percentile, so stats() doesn't allocate.
+            mutable std::vector<double> _sorted;
+            Uint64 _frames;
+            double _maxOverrunMs;
+            Uint64 _late;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
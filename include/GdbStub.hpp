@@ -0,0 +1,122 @@
+/**
+* @file GdbStub.hpp
+* @brief Lets a debugger attach over the GDB remote serial protocol.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_GDBSTUB_HPP
+#define CHIP8_GDBSTUB_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief A GDB remote serial protocol server on a loopback TCP port.
+    *
+    *        It is polled from the main loop and never blocks it, so the
+    *        window keeps drawing while the machine is halted. A debugger can
+    *        read and write memory and registers, set breakpoints (Z0, Z1) and
+    *        write watchpoints (Z2), single step, continue and interrupt.
+    *
+    *        The registers, in the order g and G use, are V0-VF (1 byte each),
+    *        I and PC (2 bytes), SP (1 byte, 0xFF when the stack is empty) and
+    *        the 16 stack entries (2 bytes), all little endian. The same
+    *        layout is served as target.xml.
+    */
+    class GdbStub
+    {
+        public:
+            GdbStub();
+            ~GdbStub();
+
+            /**
+            * @brief Listens for a debugger on 127.0.0.1.
+            *
+            * @return False if the port couldn't be opened.
+            */
+            bool open(int port);
+
+            /**
+            * @brief Closes the connection and stops listening.
+            */
+            void close();
+
+            /**
+            * @brief Checks if the stub is listening.
+            */
+            bool isOpen() const;
+
+            /**
+            * @brief Accepts a debugger and answers its packets. Call once per
+            *        frame before running the frame.
+            *
+            * @return True if the machine may run, false while it is halted.
+            */
+            bool poll(Machine &machine);
+
+            /**
+            * @brief Halts and tells the debugger if the frame just run stopped
+            *        on a trap. Call after running the frame.
+            */
+            void check(Machine &machine);
+
+        private:
+            GdbStub(const GdbStub &other);
+            GdbStub & operator=(const GdbStub &other);
+
+            // Reads what the debugger sent and answers each whole packet.
+            void receive(Machine &machine);
+
+            // Answers one packet payload.
+            void handle(Machine &machine, const std::string &packet);
+
+            // Sends payload framed as $payload#checksum.
+            void send(const std::string &payload);
+
+            // Halts and sends a stop reply for signal.
+            void stop(Machine &machine, int signal);
+
+            // The stop reply for the current halt.
+            std::string stopReply(Machine &machine) const;
+
+            std::string readRegisters(Machine &machine) const;
+            bool writeRegisters(Machine &machine, const std::string &hex);
+            std::string readRegister(Machine &machine, unsigned int reg) const;
+            bool writeRegister(Machine &machine, unsigned int reg, const std::string &hex);
+            std::string readMemory(Machine &machine, const std::string &args) const;
+            bool writeMemory(Machine &machine, const std::string &args);
+
+            // Sets or clears a Z packet's trap, false if the type isn't supported.
+            bool setTrap(const std::string &args, bool insert);
+
+            // Points the machine at the bitmaps, or at nothing while empty.
+            void arm(Machine &machine);
+
+            // Drops the debugger, clearing its traps and resuming.
+            void disconnect(Machine &machine);
+
+            int _listener;
+            int _connection;
+            std::string _input;
+            bool _halted;
+            int _signal;
+
+            // One bit per address, in the layout Machine::setBreakpoints takes.
+            std::vector<Uint8> _breakpoints;
+            std::vector<Uint8> _watchpoints;
+            int _breakpointCount;
+            int _watchpointCount;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -7,24 +7,88 @@
 */
 
 #ifndef CHIP8_INPUT_HPP
-#define CHIP9_INPUT_HPP
+#define CHIP8_INPUT_HPP
 
 #include <SDL_scancode.h>
+#include <SDL_stdinc.h>
 #include <string>
 
 namespace Chip8
 {
+    class Machine;
 
     /**
     * @brief Manages input events from the user, and offers a few conenience
-    *        functions to make things easier.
+    *        functions to make things easier. The Chip8 sees the keypad as a
+    *        16 bit mask (bit N is hex key N), which the host fills in once per
+    *        frame from the keyboard, the network or a script.
     */
     class InputManager
     {
         public:
 
+            /**
+            * @brief Plain copy of the keypad state, used for snapshots.
+            */
+            struct State
+            {
+                Uint16 keys;
+                bool isWaitingForKeyPress;
+                unsigned char keyPressRegister;
+            };
+
+            /**
+            * @brief Gets the InputManager of the Machine bound to the calling thread.
+            *
+            * @return InputManager of the current Machine.
+            */
             static InputManager & instance();
 
+            /**
+            * @brief Copies the keypad state into state.
+            *
+            * @param state The state to write to.
+            */
+            void saveState(State &state) const;
+
+            /**
+            * @brief Replaces the keypad state with state.
+            *
+            * @param state The state to read from.
+            */
+            void loadState(const State &state);
+
+            /**
+            * @brief Sets which hex keys are down. Use Machine::setKeys, which
+            *        also completes a pending FX0A wait.
+            *
+            * @param keys Mask where bit N is hex key N.
+            */
+            void setKeys(Uint16 keys);
+
+            /**
+            * @brief Gets which hex keys are down.
+            *
+            * @return Mask where bit N is hex key N.
+            */
+            Uint16 getKeys() const;
+
+            /**
+            * @brief Checks if a hex key is down.
+            *
+            * @param hex The hex key (0-F).
+            *
+            * @return True if the key is down, false otherwise.
+            */
+            bool isHexKeyDown(unsigned char hex) const;
+
+            /**
+            * @brief Reads the host keyboard into a key mask.
+            *
+            * @return Mask where bit N is set if the key mapped to hex key N is down.
+            */
+            static Uint16 readKeyboard();
+
             /**
             * @brief Checks if a key is down.
             *
@@ -81,18 +145,21 @@ namespace Chip8
             /**
              * @brief Flag telling the CPU to wait for a key press before continuing
              */
-            static bool IsWaitingForKeyPress;
+            bool IsWaitingForKeyPress;
 
             /**
              * @brief Holds the register that the keypress should be stored in
              */
-            static unsigned char KeyPressRegister;
+            unsigned char KeyPressRegister;
 
         private:
+            friend class Machine;
             InputManager();
             InputManager(const InputManager &other);
             InputManager & operator=(const InputManager &other);
 
+            Uint16 _keys;
+
             static const std::string _Tag;
     };
 }
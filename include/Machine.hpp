@@ -0,0 +1,279 @@
+/**
+* @file Machine.hpp
+* @brief A complete emulated Chip8.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_MACHINE_HPP
+#define CHIP8_MACHINE_HPP
+
+#include <Cpu.hpp>
+#include <Input.hpp>
+#include <Memory.hpp>
+#include <Timers.hpp>
+#include <Video.hpp>
+
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Owns one of each module (Memory, Cpu, Timers, Video, InputManager).
+    *
+    *        The modules find each other through their instance() functions,
+    *        which return the modules of the Machine bound to the calling thread.
+    *        A thread that never binds a Machine gets the default Machine, so a
+    *        program that runs a single Chip8 never has to know about this class.
+    *        Code that runs several machines binds each one with a Scope while
+    *        it is stepped.
+    */
+    class Machine
+    {
+        public:
+
+            /**
+            * @brief Plain copy of the whole machine. It is trivially copyable and
+            *        has no pointers, so it can be memcpy'd, written to disk or
+            *        kept in a ring of snapshots.
+            */
+            struct State
+            {
+                Memory::State memory;
+                Cpu::State cpu;
+                Timers::State timers;
+                Video::State video;
+                InputManager::State input;
+            };
+
+            /**
+            * @brief Why the last stepFrame or stepInstruction stopped early.
+            */
+            enum Trap
+            {
+                NoTrap,
+                // The PC reached a breakpoint, the instruction there hasn't run.
+                Breakpoint,
+                // The last instruction wrote to a watched address.
+                Watchpoint
+            };
+
+            /**
+            * @brief Binds a Machine to the calling thread for the lifetime of
+            *        the Scope. Scopes nest.
+            */
+            class Scope
+            {
+                public:
+                    explicit Scope(Machine &machine);
+                    ~Scope();
+
+                private:
+                    Scope(const Scope &other);
+                    Scope & operator=(const Scope &other);
+
+                    Machine *_previous;
+            };
+
+            /**
+            * @brief Creates a powered off machine with zeroed memory.
+            */
+            Machine();
+
+            /**
+            * @brief Gets the Machine bound to the calling thread.
+            *
+            * @return The bound Machine, or the default Machine if none is bound.
+            */
+            static Machine & current();
+
+            /**
+            * @brief Gets the default Machine.
+            */
+            static Machine & defaultMachine();
+
+            Memory & memory();
+            Cpu & cpu();
+            Timers & timers();
+            Video & video();
+            InputManager & input();
+
+            /**
+            * @brief Writes the 0-F font sprites to their addresses in memory.
+            */
+            void loadFonts();
+
+            /**
+            * @brief Writes rom to memory at Memory::StartAddress.
+            *
+            * @param rom The ROM file contents.
+            *
+            * @return False if rom doesn't fit in memory.
+            */
+            bool loadRom(const std::vector<unsigned char> &rom);
+
+            /**
+            * @brief Powers the machine back on with rom loaded: memory holds
+            *        only the fonts and rom, the Cpu is at
+            *        Memory::StartAddress with an empty stack, and the timers,
+            *        screen and keypad are cleared. The random state is kept,
+            *        see Cpu::seed. Only the memory pages the last run wrote are
+            *        cleared, so resetting costs about as much as copying rom.
+            *
+            *        There is no 4 KB boot image to copy: it would hold the 80
+            *        bytes of Fonts::Sprites and zeros, and copying it would
+            *        write all of memory on every reset, where clearing the
+            *        written pages touches only what the last run used.
+            *
+            * @param rom The ROM file contents.
+            *
+            * @return False, changing nothing, if rom doesn't fit in memory.
+            */
+            bool reset(const std::vector<unsigned char> &rom);
+
+            /**
+            * @brief Swaps rom in for the running one without a reset: it is
+            *        copied over Memory::StartAddress in one block, zero padded
+            *        to cover the largest rom this machine has loaded, so no
+            *        code of an older rom survives even after restoring a state
+            *        saved under it. The registers, stack, timers, screen and
+            *        keypad are kept. A later reset boots rom.
+            *
+            * @param rom The new ROM file contents.
+            *
+            * @return False, changing nothing, if rom doesn't fit in memory.
+            */
+            bool reloadRom(const std::vector<unsigned char> &rom);
+
+            /**
+            * @brief Runs one 60Hz frame: cyclesPerFrame instructions followed
+            *        by one timer step. While the Cpu waits for a key press only
+            *        the timers run. Presentation is left to the caller, so
+            *        frames that are never shown cost no pixel conversion.
+            *
+            *        If a trap stops the frame, the next call finishes it
+            *        instead of starting a new one.
+            */
+            void stepFrame();
+
+            /**
+            * @brief Runs a single instruction, as the next instruction of the
+            *        current frame, and the timer step if it ends the frame.
+            */
+            void stepInstruction();
+
+            /**
+            * @brief Checks if the Cpu is waiting for a key press (FX0A), when
+            *        nothing but the timers changes until setKeys presses one.
+            */
+            bool isWaitingForKey() const;
+
+            /**
+            * @brief Runs frames frames in one go while the Cpu waits for a key
+            *        press, the same as calling stepFrame frames times. Does
+            *        nothing if it isn't waiting.
+            */
+            void idle(unsigned int frames);
+
+            /**
+            * @brief Arms breakpoints. stepFrame only checks for traps between
+            *        instructions while breakpoints or watchpoints are armed,
+            *        so they cost nothing otherwise.
+            *
+            * @param bitmap One bit per address, Memory::MaxAddress bits, bit
+            *               N & 7 of byte N >> 3 for address N. It must stay
+            *               valid while armed. NULL disarms.
+            */
+            void setBreakpoints(const Uint8 *bitmap);
+
+            /**
+            * @brief Arms write watchpoints, see Memory::setWriteWatch.
+            */
+            void setWatchpoints(const Uint8 *bitmap);
+
+            /**
+            * @brief Gets why the last stepFrame or stepInstruction stopped.
+            */
+            Trap lastTrap() const;
+
+            /**
+            * @brief Gets the address the last trap was for.
+            */
+            unsigned int trapAddress() const;
+
+            /**
+            * @brief Sets the keypad for the next frame. A newly pressed key
+            *        completes a pending FX0A wait.
+            *
+            * @param keys Mask where bit N is hex key N.
+            */
+            void setKeys(Uint16 keys);
+
+            /**
+            * @brief Sets the number of instructions executed per frame.
+            *
+            * @param cycles Instructions per frame, at least 1.
+            */
+            void setCyclesPerFrame(int cycles);
+
+            /**
+            * @brief Gets the number of instructions executed per frame.
+            */
+            int getCyclesPerFrame() const;
+
+            /**
+            * @brief Copies the whole machine into state.
+            *
+            * @param state The state to write to.
+            */
+            void save(State &state) const;
+
+            /**
+            * @brief Replaces the whole machine with state. A frame a trap
+            *        stopped is abandoned.
+            *
+            * @param state The state to read from.
+            */
+            void restore(const State &state);
+
+            /**
+            * @brief Gets a 64 bit hash of everything that decides how the
+            *        machine runs from here: the screen, memory, registers,
+            *        stack, timers, random state and keypad. Video and Memory
+            *        keep their hashes up to date as they change, so this costs
+            *        about a hundred word mixes instead of hashing 64KB.
+            *
+            * @return The hash, equal for equal machines.
+            */
+            Uint64 stateHash();
+
+        private:
+            Machine(const Machine &other);
+            Machine & operator=(const Machine &other);
+
+            Memory _memory;
+            Cpu _cpu;
+            Timers _timers;
+            Video _video;
+            InputManager _input;
+            int _cyclesPerFrame;
+
+            // Instructions already run in the current frame.
+            int _cycle;
+            const Uint8 *_breakpoints;
+
+            // The rom reset last loaded and its share of the memory hash.
+            std::vector<unsigned char> _bootRom;
+            Uint64 _bootHash;
+            // The most bytes any rom has taken at Memory::StartAddress.
+            size_t _romSpan;
+            Trap _trap;
+            unsigned int _trapAddress;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
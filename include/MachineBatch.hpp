@@ -0,0 +1,130 @@
+/**
+* @file MachineBatch.hpp
+* @brief Steps many machines in lockstep on a pool of threads.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_MACHINEBATCH_HPP
+#define CHIP8_MACHINEBATCH_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief A fixed number of machines stepped together, as a vectorised
+    *        environment steps its copies of a game. Unlike the Scheduler
+    *        nothing is paced: step runs the given frames on every machine as
+    *        fast as the threads allow and returns when all are done.
+    *
+    *        After each step the screens are gathered into one contiguous
+    *        array, so a caller can hand out a single view of every
+    *        observation.
+    */
+    class MachineBatch
+    {
+        public:
+
+            /**
+            * @brief Creates size powered off machines.
+            *
+            * @param size The number of machines, at least 1.
+            * @param threads The threads to step them on, counting the caller.
+            * @param expand True to also gather each screen one byte per pixel.
+            */
+            MachineBatch(size_t size, unsigned int threads, bool expand);
+
+            /**
+            * @brief Stops the threads.
+            */
+            ~MachineBatch();
+
+            /**
+            * @brief Gets the number of machines.
+            */
+            size_t size() const;
+
+            /**
+            * @brief Gets machine index. Only use it between steps.
+            */
+            Machine & machine(size_t index);
+
+            /**
+            * @brief Boots every machine with rom and seeds machine i with
+            *        seed + i.
+            *
+            * @return False if the rom doesn't fit in memory.
+            */
+            bool reset(const std::vector<unsigned char> &rom, unsigned int seed);
+
+            /**
+            * @brief Runs frames frames on every machine, holding keys[i] on
+            *        machine i, then gathers the screens.
+            */
+            void step(const Uint16 *keys, unsigned int frames);
+
+            /**
+            * @brief Gets the gathered bit planes, size x 2 x 32 rows with the
+            *        leftmost pixel in bit 63, as of the last step or reset.
+            */
+            const Uint64 * planes() const;
+
+            /**
+            * @brief Gets the gathered pixels, size x 32 x 64 bytes each holding
+            *        plane 0 in bit 0 and plane 1 in bit 1, or null if the batch
+            *        doesn't expand.
+            */
+            const Uint8 * pixels() const;
+
+            /**
+            * @brief Gets one byte per machine, non-zero while its buzzer
+            *        sounds, as of the last step or reset.
+            */
+            const Uint8 * sounds() const;
+
+            /**
+            * @brief Gathers machine index's screen again, after it was
+            *        changed between steps, as by Machine::restore.
+            */
+            void refresh(size_t index);
+
+        private:
+            MachineBatch(const MachineBatch &other);
+            MachineBatch & operator=(const MachineBatch &other);
+
+            // Worker thread main loop, index 0 is the caller.
+            void run(unsigned int index);
+
+            // Steps and gathers the machines the thread index owns.
+            void stepSlice(unsigned int index);
+
+            std::vector<std::unique_ptr<Machine> > _machines;
+            std::vector<std::thread> _threads;
+            std::vector<Uint64> _planes;
+            std::vector<Uint8> _pixels;
+            std::vector<Uint8> _sounds;
+            bool _expand;
+
+            // Guards the fields below, which hand a step to the threads.
+            std::mutex _mutex;
+            std::condition_variable _start;
+            std::condition_variable _done;
+            Uint64 _generation;
+            unsigned int _pending;
+            bool _stopping;
+            const Uint16 *_keys;
+            unsigned int _frames;
+    };
+}
+
+#endif
@@ -9,24 +9,65 @@
 #ifndef CHIP8_MEMORY_HPP
 #define CHIP8_MEMORY_HPP
 
+#include <SDL_stdinc.h>
+
 namespace Chip8
 {
-    
+    class Machine;
+
     /**
     * @brief Emulates the Chip8 memory architecture. Chip8 has 4096 bytes of memory
-    *        where the first 0x200 bytes are reserved for the interpreter.
+    *        where the first 0x200 bytes are reserved for the interpreter. XO-CHIP
+    *        extends this to a full 16 bit (64KB) address space, which is what is
+    *        emulated here so both kinds of ROMs can run.
     */
     class Memory
     {
         public:
 
             /**
-            * @brief Gets the singleton instance of the Memory module.
+            * @brief Plain copy of everything in memory, used for snapshots.
+            */
+            struct State
+            {
+                unsigned char memory[0x10000];
+                unsigned char registers[0x10];
+                unsigned int addressRegister;
+                // The hash of memory, kept so restoring doesn't rehash 64KB.
+                Uint64 hash;
+                // The Memory these pages were saved from and the version of
+                // each page, so saving over or restoring from a state of the
+                // same Memory only copies the pages that differ. 0 is never
+                // a Memory's lineage, so a zeroed state gets a full copy.
+                Uint64 lineage;
+                Uint64 pageVersions[0x100];
+            };
+
+            /**
+            * @brief Gets the Memory module of the Machine bound to the calling thread.
             *
-            * @return Singleton instance of the Memory module.
+            * @return Memory module of the current Machine.
             */
             static Memory & instance();
 
+            /**
+            * @brief Copies the memory into state. If state was last saved
+            *        from or loaded into this Memory, only the pages written
+            *        since then are copied, so state must not be changed
+            *        other than by saving.
+            *
+            * @param state The state to write to.
+            */
+            void saveState(State &state) const;
+
+            /**
+            * @brief Replaces the memory with state. If state came from this
+            *        Memory, only the pages that differ from it are copied.
+            *
+            * @param state The state to read from.
+            */
+            void loadState(const State &state);
+
             /**
             * @brief Reads an address in memory.
             *
@@ -37,6 +78,20 @@ namespace Chip8
             */
             bool read(unsigned int address, unsigned char &byte) const;
 
+            /**
+            * @brief Gets a block of memory in place, without copying it.
+            *        The caller already knows the size it asked for, so only
+            *        the start comes back, and NULL marks the one block that
+            *        can't be read in place.
+            *
+            * @param address The address of the first byte.
+            * @param size The number of bytes.
+            *
+            * @return The bytes, valid until memory is next written, or NULL if
+            *         the block runs past the end of memory.
+            */
+            const unsigned char * span(unsigned int address, unsigned int size) const;
+
             /**
             * @brief Writes a value to an address in memory. 
             *
@@ -47,6 +102,39 @@ namespace Chip8
             */
             bool write(unsigned int address, unsigned char byte);
 
+            /**
+            * @brief Copies a block into memory, like writing it byte by byte
+            *        but without triggering write watches.
+            *
+            * @param address The address of the first byte.
+            * @param data The bytes to copy.
+            * @param size The number of bytes.
+            *
+            * @return False, copying nothing, if the block doesn't fit.
+            */
+            bool load(unsigned int address, const unsigned char *data, unsigned int size);
+
+            /**
+            * @brief Like load, but for a block going where memory is all zero
+            *        and whose share of the hash is already known, so nothing
+            *        is hashed.
+            *
+            * @param hash The block's hashBlock.
+            */
+            bool load(unsigned int address, const unsigned char *data, unsigned int size, Uint64 hash);
+
+            /**
+            * @brief Gets what a block loaded into zeroed memory adds to hash.
+            */
+            static Uint64 hashBlock(unsigned int address, const unsigned char *data, unsigned int size);
+
+            /**
+            * @brief Zeroes memory, the registers and I. Only pages written
+            *        since the last clear are touched, so this is cheap when a
+            *        ROM only used a little of the address space.
+            */
+            void clear();
+
             /**
             * @brief Sets the register defined by reg.
             *
@@ -89,11 +177,45 @@ namespace Chip8
             */
             unsigned int getFontAddress(unsigned char hex) const;
 
+            /**
+            * @brief Gets a 64 bit hash of the whole address space, registers
+            *        excluded. Every byte contributes independently by XOR, so
+            *        a write updates the hash in constant time.
+            *
+            * @return The hash, equal for equal memory, 0 when it is all 0.
+            */
+            Uint64 hash() const;
+
+            /**
+            * @brief Watches writes to the addresses set in bitmap, one bit per
+            *        address like Machine::setBreakpoints. NULL stops watching.
+            */
+            void setWriteWatch(const Uint8 *bitmap);
+
+            /**
+            * @brief Checks if any write watch is set.
+            */
+            bool isWatching() const;
+
+            /**
+            * @brief Checks for and clears a write to a watched address.
+            *
+            * @param address Set to the last watched address written.
+            *
+            * @return True if a watched address was written since the last call.
+            */
+            bool takeWatchHit(unsigned int &address);
+
             /**
             * @brief The maximum number of memory addresses.
             */
             static const unsigned int MaxAddress;
 
+            /**
+            * @brief The number of bytes snapshots track writes by.
+            */
+            static const unsigned int PageSize;
+
             /**
             * @brief The address the interpreter starts executing at.
             */
@@ -110,9 +232,10 @@ namespace Chip8
             static const unsigned char LastRegisterAddress;
 
         private:
-            // For a correct singleton implementation it is necessary to make
-            // the constructor, copy constructor and assignment operators private,
-            // so that there isn't any accidental copying.
+            // Only a Machine creates modules. The copy constructor and
+            // assignment operators are private so that there isn't any
+            // accidental copying, use State for that.
+            friend class Machine;
             Memory();
             Memory(const Memory &other);
             Memory & operator=(const Memory &other);
@@ -120,9 +243,23 @@ namespace Chip8
             bool validAddress(unsigned int address) const;
             bool validRegisterAddress(unsigned char reg) const;
 
-            unsigned char _memory[4096];
-            unsigned char _registers[0xF];
+            // 64KB XO-CHIP address space.
+            unsigned char _memory[0x10000];
+            unsigned char _registers[0x10];
             unsigned int _addressRegister;
+            Uint64 _hash;
+
+            // Every write stamps its page with the current epoch, and every
+            // save or load starts a new one, so a page whose version matches
+            // a state's hasn't been written since that state was taken.
+            // Version 0 is kept for pages that are all zero.
+            Uint64 _lineage;
+            Uint64 _pageVersions[0x100];
+            mutable Uint64 _epoch;
+
+            const Uint8 *_writeWatch;
+            bool _watchHit;
+            unsigned int _watchAddress;
     };
 }
 
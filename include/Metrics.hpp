@@ -0,0 +1,252 @@
+/**
+* @file Metrics.hpp
+* @brief Process wide performance counters and their Prometheus export.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_METRICS_HPP
+#define CHIP8_METRICS_HPP
+
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/**
+* Hooks into the emulator go through these macros, which compile to nothing,
+* arguments included, unless the build defines CHIP8_ENABLE_METRICS.
+*/
+#ifdef CHIP8_ENABLE_METRICS
+#define CHIP8_METRIC_ADD(counter, n) ::Chip8::Metrics::instance().counter.add(n)
+#define CHIP8_METRIC_OBSERVE(histogram, value) ::Chip8::Metrics::instance().histogram.observe(value)
+#define CHIP8_METRIC_SET(gauge, value) ::Chip8::Metrics::instance().gauge.set(value)
+#else
+#define CHIP8_METRIC_ADD(counter, n) ((void) 0)
+#define CHIP8_METRIC_OBSERVE(histogram, value) ((void) 0)
+#define CHIP8_METRIC_SET(gauge, value) ((void) 0)
+#endif
+
+namespace Chip8
+{
+
+    /**
+    * @brief A monotonically increasing count. Adding is a relaxed atomic add,
+    *        so any thread may add without locking.
+    */
+    class Counter
+    {
+        public:
+            Counter(const char *name, const char *help);
+
+            void add(Uint64 n)
+            {
+                _value.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            Uint64 value() const;
+
+            /**
+            * @brief Writes the counter in Prometheus text format.
+            */
+            void write(std::ostream &out) const;
+
+        private:
+            Counter(const Counter &other);
+            Counter & operator=(const Counter &other);
+
+            const char *_name;
+            const char *_help;
+            std::atomic<Uint64> _value;
+    };
+
+    /**
+    * @brief A value that goes up and down, the last one set. Setting is a
+    *        relaxed atomic store, so any thread may set without locking.
+    */
+    class Gauge
+    {
+        public:
+
+            /**
+            * @brief Creates a gauge.
+            *
+            * @param unit Multiplies the value on export, for example 1e-6 to
+            *             set microseconds and export seconds.
+            */
+            Gauge(const char *name, const char *help, double unit);
+
+            void set(Uint64 value)
+            {
+                _value.store(value, std::memory_order_relaxed);
+            }
+
+            Uint64 value() const;
+
+            /**
+            * @brief Writes the gauge in Prometheus text format.
+            */
+            void write(std::ostream &out) const;
+
+        private:
+            Gauge(const Gauge &other);
+            Gauge & operator=(const Gauge &other);
+
+            const char *_name;
+            const char *_help;
+            double _unit;
+            std::atomic<Uint64> _value;
+    };
+
+    /**
+    * @brief Counts observations into fixed buckets. Every bucket and the sum
+    *        are separate relaxed atomics, so a scrape racing an observation
+    *        can be off by that one observation.
+    */
+    class Histogram
+    {
+        public:
+
+            /**
+            * @brief Most buckets a histogram can have, besides +Inf.
+            */
+            static const int MaxBuckets = 16;
+
+            /**
+            * @brief Creates a histogram.
+            *
+            * @param bounds Ascending upper bounds of the buckets, in the
+            *               units observe is called with.
+            * @param count Number of bounds, at most MaxBuckets.
+            * @param unit Multiplies bounds and the sum on export, for example
+            *             1e-6 to observe microseconds and export seconds.
+            */
+            Histogram(const char *name, const char *help, const Uint64 *bounds, int count, double unit);
+
+            void observe(Uint64 value);
+
+            /**
+            * @brief Writes the histogram in Prometheus text format.
+            */
+            void write(std::ostream &out) const;
+
+        private:
+            Histogram(const Histogram &other);
+            Histogram & operator=(const Histogram &other);
+
+            const char *_name;
+            const char *_help;
+            const Uint64 *_bounds;
+            int _count;
+            double _unit;
+            // Observations per bucket, not cumulative. The last one is +Inf.
+            std::atomic<Uint64> _buckets[MaxBuckets + 1];
+            std::atomic<Uint64> _sum;
+    };
+
+    /**
+    * @brief The registry of every metric the emulator keeps. It is process
+    *        wide rather than per Machine, so speculative run ahead and
+    *        netplay resimulation count as the work they are.
+    */
+    class Metrics
+    {
+        public:
+
+            /**
+            * @brief Gets the singleton instance of the registry.
+            */
+            static Metrics & instance();
+
+            /**
+            * @brief True if this build was compiled with CHIP8_ENABLE_METRICS,
+            *        otherwise every metric stays at 0.
+            */
+            static const bool Enabled;
+
+            Counter instructions;
+            Counter draws;
+            Counter collisions;
+            Counter framesPresented;
+            Counter framesSkipped;
+            Counter timerTicks;
+            Counter inputEvents;
+            Counter lateFrames;
+            // Time between frames in microseconds.
+            Histogram frameTime;
+            // Largest overrun of the last FramePacer stats window, in
+            // microseconds.
+            Gauge maxFrameOverrun;
+
+            /**
+            * @brief Writes every metric in Prometheus text format.
+            */
+            void write(std::ostream &out) const;
+
+        private:
+            Metrics();
+            Metrics(const Metrics &other);
+            Metrics & operator=(const Metrics &other);
+
+            static const std::string _Tag;
+    };
+
+    /**
+    * @brief Publishes the registry from a background thread. It can rewrite a
+    *        file every interval, replacing it atomically so a node exporter
+    *        textfile collector never reads half a file, and can serve the
+    *        metrics over HTTP on a loopback port.
+    */
+    class MetricsExporter
+    {
+        public:
+            MetricsExporter();
+            ~MetricsExporter();
+
+            /**
+            * @brief Starts exporting.
+            *
+            * @param path The file to write, empty to not write one.
+            * @param port The loopback port to serve on, 0 to not serve.
+            * @param intervalSeconds Seconds between file writes.
+            *
+            * @return False if the port couldn't be opened.
+            */
+            bool start(const std::string &path, int port, int intervalSeconds);
+
+            /**
+            * @brief Writes the file one last time and stops the thread.
+            */
+            void stop();
+
+            /**
+            * @brief Checks if the exporter is running.
+            */
+            bool isRunning() const;
+
+        private:
+            MetricsExporter(const MetricsExporter &other);
+            MetricsExporter & operator=(const MetricsExporter &other);
+
+            // Exporter thread main loop.
+            void run();
+
+            // Replaces the file with the current metrics.
+            void writeFile();
+
+            // Answers one HTTP request on the accepted connection.
+            void serve(int connection);
+
+            std::thread _thread;
+            std::atomic<bool> _stopping;
+            std::string _path;
+            int _socket;
+            int _intervalSeconds;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
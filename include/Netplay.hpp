@@ -0,0 +1,245 @@
+/**
+* @file Netplay.hpp
+* @brief Two player rollback netplay over UDP.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_NETPLAY_HPP
+#define CHIP8_NETPLAY_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <chrono>
+#include <deque>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Delays and drops outgoing packets, so bad networks can be tested
+    *        over loopback. Disabled unless configured.
+    */
+    class LinkSimulator
+    {
+        public:
+            LinkSimulator();
+
+            /**
+            * @brief Configures the simulated link.
+            *
+            * @param latencyMs Delay added to every packet.
+            * @param jitterMs Up to this much extra random delay per packet.
+            * @param lossPercent Percentage of packets dropped (0-100).
+            * @param seed Seed for the loss and jitter, so runs repeat.
+            */
+            void configure(int latencyMs, int jitterMs, int lossPercent, unsigned int seed);
+
+            /**
+            * @brief Sends a packet now, or queues it until its delay has passed.
+            */
+            void send(int socket, const sockaddr_in &to, const Uint8 *data, size_t size);
+
+            /**
+            * @brief Sends the queued packets whose delay has passed.
+            */
+            void pump(int socket);
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            struct Packet
+            {
+                Clock::time_point due;
+                sockaddr_in to;
+                std::vector<Uint8> data;
+            };
+
+            // Returns a random number in 0 - range-1.
+            unsigned int random(unsigned int range);
+
+            int _latencyMs;
+            int _jitterMs;
+            int _lossPercent;
+            unsigned int _random;
+            std::deque<Packet> _queue;
+    };
+
+    /**
+    * @brief Rollback netplay for two players sharing one keypad, as in PONG2
+    *        or TANK. Every frame each side sends its recent 16 key masks to
+    *        the other. A frame whose remote input has not arrived yet runs with
+    *        a prediction (the last input that did arrive). When the real input
+    *        turns out to differ, the machine is restored to the snapshot taken
+    *        before that frame and every frame since is run again. Local input
+    *        is delayed by a few frames, which hides most of the round trip.
+    *
+    *        Both sides must load the same ROM with the same random seed.
+    */
+    class Netplay
+    {
+        public:
+
+            /**
+            * @brief Connection and tuning settings.
+            */
+            struct Config
+            {
+                Config();
+
+                // UDP port to listen on.
+                int localPort;
+                // Address and port of the other player.
+                std::string remoteHost;
+                int remotePort;
+                // Frames between reading local input and running it.
+                int inputDelay;
+                // Most frames that can be resimulated, also how far this side
+                // may run ahead of the last confirmed remote input.
+                int maxRollback;
+                // Simulated link, see LinkSimulator.
+                int latencyMs;
+                int jitterMs;
+                int lossPercent;
+                unsigned int simulatorSeed;
+            };
+
+            Netplay();
+            ~Netplay();
+
+            /**
+            * @brief Opens the socket and resets the session to frame 0.
+            *
+            * @param config The settings.
+            *
+            * @return True if the socket could be opened.
+            */
+            bool open(const Config &config);
+
+            /**
+            * @brief Closes the socket.
+            */
+            void close();
+
+            /**
+            * @brief Checks if a session is running.
+            */
+            bool isOpen() const;
+
+            /**
+            * @brief Runs the next frame on machine with local input, after
+            *        correcting any mispredicted frames.
+            *
+            * @param machine The machine being played, it must only be
+            *                stepped through this object.
+            * @param localKeys The local player's keypad.
+            *
+            * @return False if the frame was not run because this side is
+            *         maxRollback frames ahead of the remote side.
+            */
+            bool advance(Machine &machine, Uint16 localKeys);
+
+            /**
+            * @brief Receives input, corrects mispredicted frames and resends
+            *        local input, without running a new frame.
+            *
+            * @param machine The machine being played.
+            */
+            void poll(Machine &machine);
+
+            /**
+            * @brief Gets the settings in use, with out of range values clamped.
+            */
+            const Config & config() const;
+
+            /**
+            * @brief Gets the next frame to run.
+            */
+            Uint32 frame() const;
+
+            /**
+            * @brief Gets the number of frames whose remote input is known.
+            *        Frames before this have run with the real input.
+            */
+            Uint32 confirmedFrame() const;
+
+            /**
+            * @brief Gets the number of rollbacks done.
+            */
+            Uint64 rollbacks() const;
+
+            /**
+            * @brief Gets the largest number of frames resimulated by one rollback.
+            */
+            Uint32 maxResimulatedFrames() const;
+
+            /**
+            * @brief Gets the longest time one rollback took, in microseconds.
+            */
+            double maxRollbackMicroseconds() const;
+
+            /**
+            * @brief Parses LOCALPORT:HOST:REMOTEPORT into config.
+            *
+            * @param value The text to parse.
+            * @param config The ports and host are stored here.
+            *
+            * @return True if value was valid.
+            */
+            static bool parseAddress(const std::string &value, Config &config);
+
+        private:
+            Netplay(const Netplay &other);
+            Netplay & operator=(const Netplay &other);
+
+            // Reads every waiting packet.
+            void receive();
+
+            // Handles one packet.
+            void handlePacket(const Uint8 *data, size_t size);
+
+            // Resimulates from _rollbackFrom if a prediction was wrong.
+            void rollback(Machine &machine);
+
+            // Saves the state before frame and runs it.
+            void runFrame(Machine &machine, Uint32 frame);
+
+            // Gets the remote input for frame, real or predicted.
+            Uint16 remoteInput(Uint32 frame) const;
+
+            // Sends the local inputs the remote side hasn't acknowledged.
+            void sendInputs();
+
+            int _socket;
+            sockaddr_in _remote;
+            Config _config;
+            LinkSimulator _simulator;
+
+            // Input histories, indexed by frame % HistorySize.
+            std::vector<Uint16> _localInputs;
+            std::vector<Uint16> _remoteInputs;
+            std::vector<Uint16> _usedRemoteInputs;
+
+            // Snapshots taken before each frame, indexed by frame % size.
+            std::vector<Machine::State> _states;
+
+            Uint32 _frame;
+            Uint32 _localEnd;
+            Uint32 _remoteEnd;
+            Uint32 _remoteAck;
+            Uint32 _rollbackFrom;
+
+            Uint64 _rollbacks;
+            Uint32 _maxResimulated;
+            double _maxRollbackMicroseconds;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -0,0 +1,174 @@
+/**
+* @file Options.hpp
+* @brief Command line options for the emulator.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_OPTIONS_HPP
+#define CHIP8_OPTIONS_HPP
+
+#include <Capture.hpp>
+#include <Netplay.hpp>
+#include <Scaler.hpp>
+
+#include <string>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Parses the command line. Options are given as --name=value or
+    *        --name, followed by the ROM file.
+    */
+    class Options
+    {
+        public:
+
+            /**
+            * @brief Creates the default options.
+            */
+            Options();
+
+            /**
+            * @brief Parses the command line into this object.
+            *
+            * @param argc Argument count from main.
+            * @param argv Arguments from main.
+            *
+            * @return True if the command line was valid, false otherwise.
+            */
+            bool parse(int argc, char *argv[]);
+
+            /**
+            * @brief Prints the usage message.
+            */
+            static void printUsage();
+
+            /**
+            * @brief The path to the ROM file.
+            */
+            std::string romName;
+
+            /**
+            * @brief The CPU scaler filter, None leaves scaling to SDL.
+            */
+            Scaler::Filter scaler;
+
+            /**
+            * @brief The kernel the CPU scaler uses.
+            */
+            Scaler::Kernel scalerKernel;
+
+            /**
+            * @brief The integer window scale, 1 to 64.
+            */
+            int scale;
+
+            /**
+            * @brief Where to record presented frames, empty to not record and
+            *        "-" for stdout.
+            */
+            std::string capturePath;
+
+            /**
+            * @brief The format recorded frames are written in.
+            */
+            Capture::Format captureFormat;
+
+            /**
+            * @brief True to not open an audio device.
+            */
+            bool mute;
+
+            /**
+            * @brief Instructions executed per 60Hz frame.
+            */
+            int cycles;
+
+            /**
+            * @brief Number of frames to run ahead of the presented frame, 0 to
+            *        not run ahead.
+            */
+            int runAhead;
+
+            /**
+            * @brief True to run frames as fast as the host allows instead of
+            *        at 60Hz.
+            */
+            bool turbo;
+
+            /**
+            * @brief In turbo mode, present every Nth emulated frame. 0 presents
+            *        at the display refresh rate instead.
+            */
+            int presentEvery;
+
+            /**
+            * @brief Seed for the random number generator, negative to seed
+            *        from the clock.
+            */
+            int seed;
+
+            /**
+            * @brief True to play with another player over the network.
+            */
+            bool netplayEnabled;
+
+            /**
+            * @brief The netplay connection and tuning settings.
+            */
+            Netplay::Config netplay;
+
+            /**
+            * @brief Loopback port a GDB remote protocol debugger can attach
+            *        on, 0 for none.
+            */
+            int gdbPort;
+
+            /**
+            * @brief Where to write Prometheus metrics, empty to not write them.
+            */
+            std::string metricsPath;
+
+            /**
+            * @brief Loopback port to serve Prometheus metrics on, 0 to not serve.
+            */
+            int metricsPort;
+
+            /**
+            * @brief Seconds between metrics file writes.
+            */
+            int metricsInterval;
+
+            /**
+            * @brief The POSIX shared memory name to export frames and take
+            *        keys through, empty to not export.
+            */
+            std::string sharedName;
+
+            /**
+            * @brief True to export the expanded RGBA screen as well as the
+            *        bit planes.
+            */
+            bool sharedRgba;
+
+            /**
+            * @brief True to reload the ROM into the running machine whenever
+            *        the file changes.
+            */
+            bool watch;
+
+        private:
+            // Splits --name=value into name and value, value is empty for --name.
+            static bool split(const std::string &arg, std::string &name, std::string &value);
+
+            // Parses an integer that is at least minimum.
+            static bool toInt(const std::string &value, int &result, int minimum = 1);
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -0,0 +1,156 @@
+/**
+* @file RingBuffer.hpp
+* @brief Bounded lock-free single producer, single consumer queue.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_RINGBUFFER_HPP
+#define CHIP8_RINGBUFFER_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Bounded queue for passing data from exactly one producer thread
+    *        to exactly one consumer thread without locks. All storage is
+    *        allocated up front, so neither side ever allocates or blocks.
+    *        Slots can be filled and drained in place with acquire/commit and
+    *        front/release, which avoids copying large elements twice.
+    */
+    template <typename T>
+    class RingBuffer
+    {
+        public:
+
+            /**
+            * @brief Creates a ring buffer.
+            *
+            * @param capacity The minimum number of elements the buffer holds,
+            *                 rounded up to a power of two.
+            */
+            explicit RingBuffer(size_t capacity)
+                : _head(0),
+                  _tail(0)
+            {
+                size_t size = 1;
+                while(size < capacity) {
+                    size <<= 1;
+                }
+                _slots.resize(size);
+                _mask = size - 1;
+            }
+
+            /**
+            * @brief Producer only. Gets the next free slot to write into.
+            *
+            * @return The slot, or 0 if the buffer is full.
+            */
+            T * acquire()
+            {
+                size_t head = _head.load(std::memory_order_relaxed);
+                if(head - _tail.load(std::memory_order_acquire) > _mask) {
+                    return 0;
+                }
+                return &_slots[head & _mask];
+            }
+
+            /**
+            * @brief Producer only. Publishes the slot returned by acquire.
+            */
+            void commit()
+            {
+                _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+            * @brief Consumer only. Gets the oldest element.
+            *
+            * @return The element, or 0 if the buffer is empty.
+            */
+            T * front()
+            {
+                size_t tail = _tail.load(std::memory_order_relaxed);
+                if(tail == _head.load(std::memory_order_acquire)) {
+                    return 0;
+                }
+                return &_slots[tail & _mask];
+            }
+
+            /**
+            * @brief Consumer only. Frees the slot returned by front.
+            */
+            void release()
+            {
+                _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+            * @brief Producer only. Copies value into the buffer.
+            *
+            * @return False if the buffer is full.
+            */
+            bool push(const T &value)
+            {
+                T *slot = acquire();
+                if(slot == 0) {
+                    return false;
+                }
+                *slot = value;
+                commit();
+                return true;
+            }
+
+            /**
+            * @brief Consumer only. Copies the oldest element out of the buffer.
+            *
+            * @return False if the buffer is empty.
+            */
+            bool pop(T &value)
+            {
+                T *slot = front();
+                if(slot == 0) {
+                    return false;
+                }
+                value = *slot;
+                release();
+                return true;
+            }
+
+            /**
+            * @brief Gets the number of queued elements. Only exact when called
+            *        from the producer or consumer while the other side is idle.
+            */
+            size_t size() const
+            {
+                return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+            }
+
+            /**
+            * @brief Gets the number of elements the buffer can hold.
+            */
+            size_t capacity() const
+            {
+                return _mask + 1;
+            }
+
+        private:
+            RingBuffer(const RingBuffer &other);
+            RingBuffer & operator=(const RingBuffer &other);
+
+            std::vector<T> _slots;
+            size_t _mask;
+
+            // Keep the indices on separate cache lines so the producer and
+            // consumer don't fight over one line.
+            alignas(64) std::atomic<size_t> _head;
+            alignas(64) std::atomic<size_t> _tail;
+    };
+}
+
+#endif
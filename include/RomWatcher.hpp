@@ -0,0 +1,92 @@
+/**
+* @file RomWatcher.hpp
+* @brief Notices when the ROM file is rewritten.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_ROMWATCHER_HPP
+#define CHIP8_ROMWATCHER_HPP
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Watches a ROM file with inotify, so the emulator can reload it
+    *        the moment a build writes it.
+    *
+    *        The file's directory is watched rather than the file, because
+    *        most tools replace a file by renaming a new one over it, which
+    *        a watch on the old file would never see. A change is a write to
+    *        the file being closed or a file being renamed to its name.
+    *
+    *        A thread waits for the changes, so a caller that blocks, as the
+    *        emulator does while the ROM waits for a key, can be woken by the
+    *        callback. Only Linux has inotify; elsewhere open fails.
+    */
+    class RomWatcher
+    {
+        public:
+
+            /**
+            * @brief Creates a watcher watching nothing.
+            */
+            RomWatcher();
+
+            /**
+            * @brief Stops watching.
+            */
+            ~RomWatcher();
+
+            /**
+            * @brief Starts watching path.
+            *
+            * @param path The ROM file.
+            * @param onChange Called on the watcher's thread after each
+            *        change, may be empty.
+            *
+            * @return False if the directory can't be watched.
+            */
+            bool open(const std::string &path, const std::function<void()> &onChange);
+
+            /**
+            * @brief Stops watching.
+            */
+            void close();
+
+            /**
+            * @brief Gets if the file is being watched.
+            */
+            bool isOpen() const;
+
+            /**
+            * @brief Gets if the file changed since the last call. Any number
+            *        of changes between calls count once.
+            */
+            bool changed();
+
+        private:
+            RomWatcher(const RomWatcher &other);
+            RomWatcher & operator=(const RomWatcher &other);
+
+            // Thread main loop, reads events until close wakes it.
+            void run();
+
+            std::string _name;
+            std::function<void()> _onChange;
+            int _inotify;
+            int _wake;
+            std::thread _thread;
+            std::atomic<bool> _changed;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
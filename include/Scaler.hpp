@@ -0,0 +1,153 @@
+/**
+* @file Scaler.hpp
+* @brief CPU side upscaling of the Chip8 display.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_SCALER_HPP
+#define CHIP8_SCALER_HPP
+
+#include <SDL_stdinc.h>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Upscales the packed Video bit planes straight into 32 bit output
+    *        pixels, so the renderer only has to copy a texture 1:1. This keeps
+    *        software renderers (headless, VNC) off SDL's slow scaling path.
+    */
+    class Scaler
+    {
+        public:
+
+            /**
+            * @brief The filter applied while scaling.
+            */
+            enum Filter
+            {
+                // No CPU scaling, SDL scales the 64x32 texture.
+                None,
+                // Integer nearest neighbor.
+                Nearest,
+                // Scale2x (EPX) smoothing followed by nearest neighbor.
+                Smooth
+            };
+
+            /**
+            * @brief The instruction set used by the scaling kernels.
+            */
+            enum Kernel
+            {
+                // Pick the best kernel the host supports.
+                Auto,
+                Scalar,
+                SSE2,
+                AVX2
+            };
+
+            /**
+            * @brief Creates a scaler.
+            *
+            * @param filter The filter to apply.
+            * @param scale The integer scale factor. Smooth needs an even factor
+            *              and rounds odd factors down.
+            * @param kernel The kernel to use, falls back to the best supported
+            *               kernel if the host does not support it.
+            */
+            Scaler(Filter filter, int scale, Kernel kernel);
+
+            /**
+            * @brief Scales the given bit planes into output.
+            *
+            * @param plane0 Video::Height rows of plane 0.
+            * @param plane1 Video::Height rows of plane 1.
+            * @param palette The 4 entry palette the plane bits index into.
+            * @param output Buffer of at least outputWidth() * outputHeight() pixels.
+            */
+            void scale(const Uint64 *plane0, const Uint64 *plane1, const Uint32 *palette, Uint32 *output);
+
+            /**
+            * @brief Checks if the scaler does anything.
+            *
+            * @return False if the filter is None.
+            */
+            bool enabled() const;
+
+            /**
+            * @brief Width of the scaled image.
+            */
+            int outputWidth() const;
+
+            /**
+            * @brief Height of the scaled image.
+            */
+            int outputHeight() const;
+
+            /**
+            * @brief Gets the kernel actually in use.
+            */
+            Kernel kernel() const;
+
+            /**
+            * @brief Parses a filter name (none, nearest, smooth).
+            *
+            * @param name The name to parse.
+            * @param filter The parsed filter is stored here.
+            *
+            * @return True if name was a valid filter.
+            */
+            static bool parseFilter(const std::string &name, Filter &filter);
+
+            /**
+            * @brief Parses a kernel name (auto, scalar, sse2, avx2).
+            *
+            * @param name The name to parse.
+            * @param kernel The parsed kernel is stored here.
+            *
+            * @return True if name was a valid kernel.
+            */
+            static bool parseKernel(const std::string &name, Kernel &kernel);
+
+            /**
+            * @brief Gets the name of a kernel.
+            */
+            static const char * kernelName(Kernel kernel);
+
+            /**
+            * @brief Checks if the host can run kernel.
+            */
+            static bool supported(Kernel kernel);
+
+        private:
+            // Expands one row of plane bits to pixels, each repeated scale times.
+            void expandRow(Uint64 bits0, Uint64 bits1, const Uint32 *palette, Uint32 *output) const;
+
+            // Runs Scale2x over the palette indices in _indices into _smoothed.
+            void smooth();
+
+            // Expands a row of palette indices to pixels, each repeated scale times.
+            void expandIndices(const unsigned char *indices, int count, const Uint32 *palette, Uint32 *output) const;
+
+            Filter _filter;
+            Kernel _kernel;
+            int _scale;
+
+            // The input of the last scale call, used to skip unchanged frames.
+            Uint64 _lastPlanes[2][32];
+            Uint32 _lastPalette[4];
+            bool _valid;
+
+            // Smooth only: padded index image and the 2x result.
+            std::vector<unsigned char> _indices;
+            std::vector<unsigned char> _smoothed;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
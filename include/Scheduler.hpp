@@ -0,0 +1,244 @@
+/**
+* @file Scheduler.hpp
+* @brief Runs many machines on a small pool of threads.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_SCHEDULER_HPP
+#define CHIP8_SCHEDULER_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Runs any number of sessions, each a Machine paced at a fixed
+    *        frame rate, on a fixed pool of worker threads.
+    *
+    *        A session runs one frame at a time. stepFrame already stops at
+    *        the end of its cycle budget and picks up where it left off, so
+    *        a frame is the unit of work and nothing needs a thread of its
+    *        own. Each worker keeps a queue of sessions ready to run and a
+    *        heap of sessions sleeping until their next frame is due. A
+    *        worker with nothing due takes ready sessions from the other
+    *        workers. Ready sessions run in the order they became ready, so
+    *        every session gets its frames in turn.
+    *
+    *        A session whose ROM waits for a key (FX0A) with the buzzer off
+    *        is parked: it is in no queue and costs nothing until setKeys
+    *        changes its keys. When it wakes its timers catch up on the time
+    *        it was parked, see Machine::idle.
+    *
+    *        Sessions are frame tasks rather than coroutines because a
+    *        Machine already keeps everything a suspended session needs:
+    *        the frame end, the FX0A wait and the cycle budget are where a
+    *        coroutine would co_await, and stepFrame already returns and
+    *        resumes at each of them. A coroutine would add a heap allocated
+    *        frame per session and a stack of awaiters to that state, and
+    *        nothing the scheduler can't already do.
+    */
+    class Scheduler
+    {
+        public:
+
+            /**
+            * @brief One machine run by the scheduler.
+            */
+            class Session
+            {
+                public:
+                    /**
+                    * @brief Gets the id add gave the session.
+                    */
+                    unsigned int id() const;
+
+                    /**
+                    * @brief Gets the machine. It may only be used from the
+                    *        frame callback, or before the session is added.
+                    */
+                    Machine & machine();
+
+                private:
+                    friend class Scheduler;
+                    enum Status
+                    {
+                        Active,
+                        Parked,
+                        Removed
+                    };
+
+                    Session(unsigned int id, std::unique_ptr<Machine> machine);
+                    Session(const Session &other);
+                    Session & operator=(const Session &other);
+
+                    unsigned int _id;
+                    std::unique_ptr<Machine> _machine;
+                    std::atomic<Uint16> _keys;
+                    std::atomic<int> _status;
+                    std::atomic<bool> _removed;
+                    // Only the worker running the session touches these.
+                    std::chrono::steady_clock::time_point _deadline;
+                    std::chrono::steady_clock::time_point _parkedAt;
+                    Uint16 _appliedKeys;
+                    unsigned int _worker;
+            };
+
+            /**
+            * @brief Called on a worker thread after each frame a session runs.
+            */
+            typedef std::function<void(Session &session)> FrameCallback;
+
+            /**
+            * @brief Counters since the scheduler was created.
+            */
+            struct Stats
+            {
+                // Sessions added and not removed.
+                Uint64 sessions;
+                // Sessions parked waiting for a key.
+                Uint64 parked;
+                // Frames run across all sessions.
+                Uint64 frames;
+                // Frames that started more than a period after they were due.
+                Uint64 late;
+                // Sessions one worker took from another's queue.
+                Uint64 steals;
+            };
+
+            /**
+            * @brief Creates a stopped scheduler.
+            *
+            * @param workers The number of worker threads, at least 1.
+            * @param hz The frame rate every session runs at.
+            */
+            Scheduler(unsigned int workers, double hz);
+
+            /**
+            * @brief Stops the workers.
+            */
+            ~Scheduler();
+
+            /**
+            * @brief Sets the callback run after each frame. Only call while
+            *        stopped.
+            */
+            void setFrameCallback(const FrameCallback &callback);
+
+            /**
+            * @brief Starts the worker threads.
+            */
+            void start();
+
+            /**
+            * @brief Stops and joins the worker threads. Sessions keep their
+            *        place and carry on if the scheduler is started again.
+            */
+            void stop();
+
+            /**
+            * @brief Checks if the workers are running.
+            */
+            bool isRunning() const;
+
+            /**
+            * @brief Adds a machine, due to run its first frame now.
+            *
+            * @return The session, which stays valid after it is removed.
+            */
+            std::shared_ptr<Session> add(std::unique_ptr<Machine> machine);
+
+            /**
+            * @brief Sets the keypad a session's next frame runs with, waking
+            *        it if it is parked. Safe to call from any thread.
+            */
+            void setKeys(const std::shared_ptr<Session> &session, Uint16 keys);
+
+            /**
+            * @brief Stops running a session. A frame already running finishes.
+            */
+            void remove(const std::shared_ptr<Session> &session);
+
+            /**
+            * @brief Gets the counters.
+            */
+            Stats stats() const;
+
+        private:
+            Scheduler(const Scheduler &other);
+            Scheduler & operator=(const Scheduler &other);
+
+            typedef std::chrono::steady_clock Clock;
+
+            struct Sleeper
+            {
+                Clock::time_point deadline;
+                std::shared_ptr<Session> session;
+
+                // Makes std::priority_queue a min-heap on deadline.
+                bool operator<(const Sleeper &other) const;
+            };
+
+            struct Worker
+            {
+                std::mutex mutex;
+                std::condition_variable wake;
+                std::deque<std::shared_ptr<Session> > ready;
+                std::priority_queue<Sleeper> sleeping;
+                bool idle;
+                // Set when another worker has sessions to spare.
+                bool poked;
+                std::thread thread;
+            };
+
+            // Worker thread main loop.
+            void run(unsigned int index);
+
+            // Takes a ready session from another worker, null if none has one.
+            std::shared_ptr<Session> steal(unsigned int thief);
+
+            // Wakes an idle worker other than busy to take spare sessions.
+            void pokeIdle(unsigned int busy);
+
+            // Runs one frame and decides when the session runs next.
+            void runFrame(unsigned int index, const std::shared_ptr<Session> &session);
+
+            // Queues a session to run as soon as a worker is free.
+            void makeReady(unsigned int index, const std::shared_ptr<Session> &session);
+
+            std::vector<std::unique_ptr<Worker> > _workers;
+            Clock::duration _period;
+            FrameCallback _onFrame;
+            std::atomic<bool> _running;
+            std::atomic<int> _idleWorkers;
+
+            mutable std::mutex _sessionsMutex;
+            std::unordered_map<unsigned int, std::shared_ptr<Session> > _sessions;
+            unsigned int _nextId;
+            unsigned int _nextWorker;
+
+            std::atomic<Uint64> _parked;
+            std::atomic<Uint64> _frames;
+            std::atomic<Uint64> _late;
+            std::atomic<Uint64> _steals;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+* @file SharedExport.hpp
+* @brief Publishes the screen and takes keys through POSIX shared memory.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_SHAREDEXPORT_HPP
+#define CHIP8_SHAREDEXPORT_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <string>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Shares the screen, a frame counter and a key word with another
+    *        process through a POSIX shared memory segment, so it can observe
+    *        and play without any system call per frame.
+    *
+    *        The segment holds one Layout. The emulator is the only writer of
+    *        everything but input, which belongs to the other process. The
+    *        frame fields are guarded by a sequence lock: the emulator makes
+    *        sequence odd, writes them and makes it even again. A reader
+    *        loads sequence (acquire), retries while it is odd, copies what it
+    *        needs, then after an acquire fence loads sequence again and
+    *        retries if it changed. read does this for C++ readers.
+    *
+    *        All fields are in host byte order. Readers should check magic,
+    *        version and size before using anything else.
+    */
+    class SharedExport
+    {
+        public:
+
+            /**
+            * @brief The segment contents, at the given byte offsets.
+            */
+            struct Layout
+            {
+                // 0: Set once when the segment is created. magic is written
+                // last, so a reader that sees it sees the rest.
+                Uint32 magic;
+                Uint32 version;
+                // sizeof(Layout).
+                Uint32 size;
+                // Bit 0 set if rgba is written every frame.
+                Uint32 flags;
+                Uint32 width;
+                Uint32 height;
+                Uint32 reserved0[10];
+
+                // 64: Written by the emulator under sequence.
+                Uint32 sequence;
+                Uint32 reserved1;
+                // Frames the machine has run.
+                Uint64 frame;
+                // Video::frameHash, changes when the screen does.
+                Uint64 screenHash;
+                Uint8 planeMask;
+                // Non-zero while the buzzer sounds.
+                Uint8 sound;
+                // The keys the last frame ran with.
+                Uint16 keys;
+                Uint32 reserved2[9];
+
+                // 128: Both bit planes, a Uint64 per row, the leftmost
+                // pixel in bit 63.
+                Uint64 planes[2][32];
+
+                // 640: The screen as Video::getPixels gives it, RGBA8888
+                // (red in the high byte of each Uint32) row by row.
+                Uint32 rgba[32 * 64];
+
+                // 8832: Written by the other process, on its own cache line.
+                // Bits 0-15 are held keys, ORed with the keyboard.
+                Uint32 input;
+                Uint32 reserved3[15];
+            };
+
+            /**
+            * @brief "C8SM" read as a little endian Uint32.
+            */
+            static const Uint32 Magic;
+
+            /**
+            * @brief Bumped whenever Layout changes.
+            */
+            static const Uint32 Version;
+
+            /**
+            * @brief Set in Layout::flags when rgba is written.
+            */
+            static const Uint32 HasRgba;
+
+            SharedExport();
+            ~SharedExport();
+
+            /**
+            * @brief Creates, or takes over, the segment called name.
+            *
+            * @param name A shared memory name such as /chip8.
+            * @param rgba True to also write the expanded screen each frame.
+            *
+            * @return False if the segment couldn't be created.
+            */
+            bool open(const std::string &name, bool rgba);
+
+            /**
+            * @brief Unmaps and removes the segment.
+            */
+            void close();
+
+            /**
+            * @brief Checks if the segment is open.
+            */
+            bool isOpen() const;
+
+            /**
+            * @brief Writes the machine's screen and state after a frame.
+            *
+            * @param machine The machine, whose Video must be the one current.
+            * @param frame The number of frames run so far.
+            */
+            void publish(Machine &machine, Uint64 frame);
+
+            /**
+            * @brief Gets the keys the other process holds.
+            */
+            Uint16 readKeys() const;
+
+            /**
+            * @brief Copies a consistent frame out of a mapped Layout, retrying
+            *        while the emulator is writing it.
+            *
+            * @param shared The mapped segment.
+            * @param copy Receives the header and frame fields. input isn't
+            *             copied.
+            *
+            * @return False if the frame was still being written after many
+            *         tries, as when the emulator died while writing it.
+            */
+            static bool read(const Layout &shared, Layout &copy);
+
+        private:
+            SharedExport(const SharedExport &other);
+            SharedExport & operator=(const SharedExport &other);
+
+            std::string _name;
+            Layout *_layout;
+            bool _rgba;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
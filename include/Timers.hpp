@@ -11,7 +11,8 @@
 
 namespace Chip8
 {
-    
+    class Machine;
+
     /**
     * @brief Emulates the Chip8 Delay Timer and Sound Timer. Both timers are
     *        decremented at a rate of 60Hz, and never go below 0. When the
@@ -22,12 +23,35 @@ namespace Chip8
         public:
 
             /**
-            * @brief Gets the singleton instance of the Timers module.
+            * @brief Plain copy of the timers, used for snapshots.
+            */
+            struct State
+            {
+                unsigned int dt;
+                unsigned int st;
+            };
+
+            /**
+            * @brief Gets the Timers module of the Machine bound to the calling thread.
             *
-            * @return Singleton instance of the Timers module.
+            * @return Timers module of the current Machine.
             */
             static Timers & instance();
 
+            /**
+            * @brief Copies the timers into state.
+            *
+            * @param state The state to write to.
+            */
+            void saveState(State &state) const;
+
+            /**
+            * @brief Replaces the timers with state.
+            *
+            * @param state The state to read from.
+            */
+            void loadState(const State &state);
+
             /**
             * @brief Gets the value in DT.
             *
@@ -62,10 +86,17 @@ namespace Chip8
             */
             void step();
 
+            /**
+            * @brief Executes frames timer steps at once, for time the machine
+            *        spent idle.
+            */
+            void step(unsigned int frames);
+
         private:
-            // For a correct singleton implementation it is necessary to make
-            // the constructor, copy constructor and assignment operators private,
-            // so that there isn't any accidental copying.
+            // Only a Machine creates modules. The copy constructor and
+            // assignment operators are private so that there isn't any
+            // accidental copying, use State for that.
+            friend class Machine;
             Timers();
             Timers(const Timers &other);
             Timers & operator=(const Timers &other);
@@ -0,0 +1,151 @@
+/**
+* @file Trace.hpp
+* @brief Machine state hashes, diffs and compressed golden traces.
+* @author cdettmering
+* @version 0.1
+* @date 2026-10-19
+*/
+
+#ifndef CHIP8_TRACE_HPP
+#define CHIP8_TRACE_HPP
+
+#include <Machine.hpp>
+
+#include <SDL_stdinc.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+    /**
+    * @brief Compares machine states, for checking that two cores run a ROM
+    *        identically.
+    */
+    class Trace
+    {
+        public:
+
+            /**
+            * @brief Hashes every field of state. Padding is skipped, so equal
+            *        machines always hash equal.
+            */
+            static Uint64 hashState(const Machine::State &state);
+
+            /**
+            * @brief Writes one line per field that differs between expected
+            *        and actual.
+            *
+            * @return The number of differing fields.
+            */
+            static int diff(const Machine::State &expected, const Machine::State &actual, std::ostream &out);
+
+        private:
+            static const std::string _Tag;
+    };
+
+    /**
+    * @brief The fixed part of a golden trace file.
+    */
+    struct TraceHeader
+    {
+        // Analyzer::hash of the ROM the trace was recorded on.
+        Uint64 romHash;
+        // Instructions per frame.
+        Uint32 cycles;
+        // One key mask per frame.
+        std::vector<Uint16> keys;
+    };
+
+    /**
+    * @brief Writes a gzip compressed golden trace: the header followed by the
+    *        PC and state hash after every instruction and timer step.
+    */
+    class TraceWriter
+    {
+        public:
+            TraceWriter();
+            ~TraceWriter();
+
+            /**
+            * @brief Creates path and writes header to it.
+            *
+            * @return False if the file couldn't be written.
+            */
+            bool open(const std::string &path, const TraceHeader &header);
+
+            /**
+            * @brief Appends one step.
+            *
+            * @param pc The PC before the step.
+            * @param hash The state hash after the step.
+            */
+            void step(Uint16 pc, Uint64 hash);
+
+            /**
+            * @brief Flushes and closes the file.
+            *
+            * @return False if any write failed.
+            */
+            bool close();
+
+        private:
+            TraceWriter(const TraceWriter &other);
+            TraceWriter & operator=(const TraceWriter &other);
+
+            // Writes the buffered steps.
+            void flush();
+
+            void *_file;
+            std::vector<Uint8> _buffer;
+            bool _failed;
+
+            static const std::string _Tag;
+    };
+
+    /**
+    * @brief Reads a golden trace written by TraceWriter.
+    */
+    class TraceReader
+    {
+        public:
+            TraceReader();
+            ~TraceReader();
+
+            /**
+            * @brief Opens path and reads its header.
+            *
+            * @return False if the file is missing or not a trace.
+            */
+            bool open(const std::string &path);
+
+            /**
+            * @brief Gets the header read by open.
+            */
+            const TraceHeader & header() const;
+
+            /**
+            * @brief Reads the next step.
+            *
+            * @return False at the end of the trace.
+            */
+            bool next(Uint16 &pc, Uint64 &hash);
+
+            /**
+            * @brief Closes the file.
+            */
+            void close();
+
+        private:
+            TraceReader(const TraceReader &other);
+            TraceReader & operator=(const TraceReader &other);
+
+            void *_file;
+            TraceHeader _header;
+
+            static const std::string _Tag;
+    };
+}
+
+#endif
@@ -14,7 +14,8 @@
 
 namespace Chip8
 {
-    
+    class Machine;
+
     /**
     * @brief Handles drawing sprites to the screen.
     */
@@ -23,32 +24,70 @@ namespace Chip8
         public:
 
             /**
-            * @brief Gets the singleton instance of the Video module.
+            * @brief Plain copy of the display, used for snapshots. The palette
+            *        belongs to the host and is not part of it.
+            */
+            struct State
+            {
+                Uint64 planes[2][32];
+                unsigned char planeMask;
+            };
+
+            /**
+            * @brief Gets the Video module of the Machine bound to the calling thread.
             *
-            * @return Singleton instance of the Video module.
+            * @return Video module of the current Machine.
             */
             static Video & instance();
 
             /**
-            * @brief Gets the pixels that SDL needs to draw the screen.
+            * @brief Copies the display into state.
+            *
+            * @param state The state to write to.
+            */
+            void saveState(State &state) const;
+
+            /**
+            * @brief Replaces the display with state.
+            *
+            * @param state The state to read from.
+            */
+            void loadState(const State &state);
+
+            /**
+            * @brief Gets the pixels that SDL needs to draw the screen. The bit
+            *        planes are resolved through the palette here, and only if
+            *        something was drawn since the last call, so calling this once
+            *        per frame costs a single conversion per frame at most.
             *
             * @return Array of pixels guranteed to be of size Width * Height
             */
             Uint32 * getPixels();
 
             /**
-            * @brief Draws a sprite to the pixel buffer.
+            * @brief Gets a 64 bit hash of both bit planes. Each row's share of
+            *        the hash is kept, and only rows drawn or cleared since the
+            *        last call are hashed again, so a frame that drew one 5 row
+            *        sprite costs 5 row hashes instead of 64.
+            *
+            * @return The hash, equal for equal planes, 0 for a blank screen.
+            */
+            Uint64 frameHash();
+
+            /**
+            * @brief Draws a sprite to every selected bit plane.
             *
             * @param x The x coordinate to place the upper left part of the sprite at.
             * @param y The y coordinate to place the upper left part of the sprite at.
             * @param sprite The byte buffer that contains the sprite data. This buffer
-            *               must be of size SpriteWidth * height
+            *               must be of size SpriteWidth * height for each selected
+            *               plane, with the data for the lowest selected plane first.
             * @param height The number of rows this sprite has.
             */
             void drawSprite(int x, int y, const unsigned char *sprite, int height);
 
             /**
-            * @brief Clears the screen to black. (NOTE: It's up to the Chip8
+            * @brief Clears the selected bit planes to black. (NOTE: It's up to the Chip8
             *        programmer to clear the screen at startup.)
             */
             void clearScreen();
@@ -61,6 +100,65 @@ namespace Chip8
             */
             void setPixelFormat(SDL_PixelFormat *format);
 
+            /**
+            * @brief Sets one entry of the palette. Index 0 is the background,
+            *        1 is plane 0 only, 2 is plane 1 only and 3 is both planes.
+            *
+            * @param index The palette entry to set (0-3).
+            * @param r Red component.
+            * @param g Green component.
+            * @param b Blue component.
+            */
+            void setPaletteColor(int index, Uint8 r, Uint8 g, Uint8 b);
+
+            /**
+            * @brief Selects the bit planes that drawing and clearing affect
+            *        (XO-CHIP FN01). Bit 0 selects plane 0, bit 1 selects plane 1.
+            *
+            * @param mask The plane mask (0-3).
+            */
+            void selectPlanes(unsigned char mask);
+
+            /**
+            * @brief Gets the number of planes currently selected.
+            *
+            * @return The number of planes a sprite draw will consume data for.
+            */
+            int selectedPlaneCount() const;
+
+            /**
+            * @brief Gets the selected plane mask set by selectPlanes.
+            */
+            unsigned char getPlaneMask() const;
+
+            /**
+            * @brief Gets one bit plane. Each row of the plane is a single word
+            *        where the most significant bit is x = 0.
+            *
+            * @param plane The plane to get (0 - Planes - 1).
+            *
+            * @return Array of Height rows.
+            */
+            const Uint64 * getPlane(int plane) const;
+
+            /**
+            * @brief Gets the color of one palette entry.
+            *
+            * @param index The palette entry to get (0-3).
+            * @param r Red component is stored here.
+            * @param g Green component is stored here.
+            * @param b Blue component is stored here.
+            */
+            void getPaletteColor(int index, Uint8 &r, Uint8 &g, Uint8 &b) const;
+
+            /**
+            * @brief Gets the palette the plane bits are resolved through. Only
+            *        valid once a pixel format has been set.
+            *
+            * @return Array of 4 pixels in the current pixel format.
+            */
+            const Uint32 * getPalette() const;
+
             /**
             * @brief Width of the Chip8 display.
             */
@@ -76,21 +174,49 @@ namespace Chip8
             */
             static const int SpriteWidth;
 
+            /**
+            * @brief Number of XO-CHIP bit planes.
+            */
+            static const int Planes;
+
         private:
-            // For a correct singleton implementation it is necessary to make
-            // the constructor, copy constructor and assignment operators private,
-            // so that there isn't any accidental copying.
+            // Only a Machine creates modules. The copy constructor and
+            // assignment operators are private so that there isn't any
+            // accidental copying, use State for that.
+            friend class Machine;
             Video();
             Video(const Video &other);
             Video & operator=(const Video &other);
 
-            // Copies the 0 or 1 pixel data from _data and maps it to 0 = Black
-            // 1 = White pixels and stores it in _pixels.
+            // XORs one sprite into a single packed plane, one word per row.
+            // Returns true if any pixel was turned off.
+            bool xorSprite(Uint64 *plane, int x, int y, const unsigned char *sprite, int height);
+
+            // Combines the planes into a 2 bit palette index per pixel and maps
+            // it through _palette into _pixels.
             void copyDataToPixels();
 
+            // Rebuilds _palette from _colors for the current pixel format.
+            void updatePalette();
+
+            // Marks rows y to y + height - 1 of plane p, wrapping, for frameHash.
+            void markRows(int p, int y, int height);
+
             // 64 * 32
             Uint32 _pixels[2048];
-            unsigned char _data[2048];
+            // 2 planes of 32 rows, 64 pixels per row.
+            Uint64 _planes[2][32];
+            unsigned char _planeMask;
+            bool _dirty;
+
+            // Rows changed since the last frameHash, one bit per row.
+            Uint32 _dirtyRows[2];
+            // Each row's share of _frameHash, XORed together.
+            Uint64 _rowHashes[2][32];
+            Uint64 _frameHash;
+
+            Uint8 _colors[4][3];
+            Uint32 _palette[4];
             SDL_PixelFormat *_format;
 
             static const std::string _Tag;
@@ -0,0 +1,700 @@
+#include <Analyzer.hpp>
+#include <Memory.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+
+namespace Chip8
+{
+    const std::string Analyzer::_Tag = "Analyzer:";
+
+    namespace
+    {
+        // Values of the I register during the data flow pass, other values
+        // are a known address.
+        const int Unset = -2;
+        const int Varying = -1;
+
+        struct Instruction
+        {
+            unsigned int opcode;
+            unsigned int operand;
+            unsigned int length;
+        };
+
+        struct Cache
+        {
+            std::mutex mutex;
+            std::map<Uint64, std::shared_ptr<const Analyzer::Analysis> > entries;
+        };
+
+        Cache & cache()
+        {
+            static Cache cache;
+            return cache;
+        }
+
+        bool inRom(const std::vector<unsigned char> &rom, unsigned int address, unsigned int length)
+        {
+            return address >= Memory::StartAddress && address - Memory::StartAddress + length <= rom.size();
+        }
+
+        // Writes the Cowgod mnemonic of an instruction into text, if text
+        // isn't NULL, and returns false for opcodes the Cpu doesn't execute.
+        bool describe(unsigned int opcode, unsigned int operand, char *text, size_t size)
+        {
+            unsigned int x = (opcode >> 8) & 0xF;
+            unsigned int y = (opcode >> 4) & 0xF;
+            unsigned int n = opcode & 0xF;
+            unsigned int nn = opcode & 0xFF;
+            unsigned int nnn = opcode & 0xFFF;
+            const char *format = 0;
+            int count = 0;
+            unsigned int a = 0;
+            unsigned int b = 0;
+            unsigned int c = 0;
+
+            switch(opcode >> 12) {
+                case 0x0:
+                    if(opcode == 0x00E0) {
+                        format = "CLS";
+                    } else if(opcode == 0x00EE) {
+                        format = "RET";
+                    }
+                    break;
+                case 0x1: format = "JP 0x%03X"; count = 1; a = nnn; break;
+                case 0x2: format = "CALL 0x%03X"; count = 1; a = nnn; break;
+                case 0x3: format = "SE V%X, 0x%02X"; count = 2; a = x; b = nn; break;
+                case 0x4: format = "SNE V%X, 0x%02X"; count = 2; a = x; b = nn; break;
+                case 0x5:
+                    count = 2; a = x; b = y;
+                    if(n == 0x0) {
+                        format = "SE V%X, V%X";
+                    } else if(n == 0x2) {
+                        format = "SAVE V%X - V%X";
+                    } else if(n == 0x3) {
+                        format = "LOAD V%X - V%X";
+                    }
+                    break;
+                case 0x6: format = "LD V%X, 0x%02X"; count = 2; a = x; b = nn; break;
+                case 0x7: format = "ADD V%X, 0x%02X"; count = 2; a = x; b = nn; break;
+                case 0x8:
+                    count = 2; a = x; b = y;
+                    switch(n) {
+                        case 0x0: format = "LD V%X, V%X"; break;
+                        case 0x1: format = "OR V%X, V%X"; break;
+                        case 0x2: format = "AND V%X, V%X"; break;
+                        case 0x3: format = "XOR V%X, V%X"; break;
+                        case 0x4: format = "ADD V%X, V%X"; break;
+                        case 0x5: format = "SUB V%X, V%X"; break;
+                        case 0x6: format = "SHR V%X, V%X"; break;
+                        case 0x7: format = "SUBN V%X, V%X"; break;
+                        case 0xE: format = "SHL V%X, V%X"; break;
+                    }
+                    break;
+                case 0x9:
+                    if(n == 0x0) {
+                        format = "SNE V%X, V%X"; count = 2; a = x; b = y;
+                    }
+                    break;
+                case 0xA: format = "LD I, 0x%03X"; count = 1; a = nnn; break;
+                case 0xB: format = "JP V0, 0x%03X"; count = 1; a = nnn; break;
+                case 0xC: format = "RND V%X, 0x%02X"; count = 2; a = x; b = nn; break;
+                case 0xD: format = "DRW V%X, V%X, %u"; count = 3; a = x; b = y; c = n; break;
+                case 0xE:
+                    count = 1; a = x;
+                    if(nn == 0x9E) {
+                        format = "SKP V%X";
+                    } else if(nn == 0xA1) {
+                        format = "SKNP V%X";
+                    }
+                    break;
+                case 0xF:
+                    count = 1; a = x;
+                    switch(nn) {
+                        case 0x00:
+                            if(x == 0x0) {
+                                format = "LD I, 0x%04X"; a = operand;
+                            }
+                            break;
+                        case 0x01: format = "PLANE %u"; break;
+                        case 0x07: format = "LD V%X, DT"; break;
+                        case 0x0A: format = "LD V%X, K"; break;
+                        case 0x15: format = "LD DT, V%X"; break;
+                        case 0x18: format = "LD ST, V%X"; break;
+                        case 0x1E: format = "ADD I, V%X"; break;
+                        case 0x29: format = "LD F, V%X"; break;
+                        case 0x33: format = "LD B, V%X"; break;
+                        case 0x55: format = "LD [I], V%X"; break;
+                        case 0x65: format = "LD V%X, [I]"; break;
+                    }
+                    break;
+            }
+
+            if(text != 0) {
+                if(format == 0) {
+                    snprintf(text, size, "DW 0x%04X", opcode);
+                } else if(count == 0) {
+                    snprintf(text, size, "%s", format);
+                } else {
+                    snprintf(text, size, format, a, b, c);
+                }
+            }
+            return format != 0;
+        }
+
+        bool decode(const std::vector<unsigned char> &rom, unsigned int address, Instruction &instruction)
+        {
+            if(!inRom(rom, address, 2)) {
+                return false;
+            }
+            unsigned int offset = address - Memory::StartAddress;
+            instruction.opcode = (rom[offset] << 8) | rom[offset + 1];
+            instruction.operand = 0;
+            instruction.length = Analyzer::instructionLength(rom[offset], rom[offset + 1]);
+            if(instruction.length == 4) {
+                if(!inRom(rom, address, 4)) {
+                    return false;
+                }
+                instruction.operand = (rom[offset + 2] << 8) | rom[offset + 3];
+            }
+            return describe(instruction.opcode, instruction.operand, 0, 0);
+        }
+
+        unsigned int lengthAt(const std::vector<unsigned char> &rom, unsigned int address)
+        {
+            if(!inRom(rom, address, 2)) {
+                return 2;
+            }
+            unsigned int offset = address - Memory::StartAddress;
+            return Analyzer::instructionLength(rom[offset], rom[offset + 1]);
+        }
+
+        // Gets how instruction at address moves control, FallThrough for
+        // instructions that just continue with the next one.
+        Analyzer::Exit flow(const std::vector<unsigned char> &rom, unsigned int address, const Instruction &instruction, std::vector<unsigned int> &targets)
+        {
+            unsigned int opcode = instruction.opcode;
+            unsigned int next = address + instruction.length;
+            targets.clear();
+            switch(opcode >> 12) {
+                case 0x0:
+                    if(opcode == 0x00EE) {
+                        return Analyzer::Return;
+                    }
+                    break;
+                case 0x1:
+                    if((opcode & 0xFFF) == address) {
+                        return Analyzer::Halt;
+                    }
+                    targets.push_back(opcode & 0xFFF);
+                    return Analyzer::Jump;
+                case 0x2:
+                    targets.push_back(opcode & 0xFFF);
+                    targets.push_back(next);
+                    return Analyzer::Call;
+                case 0x3:
+                case 0x4:
+                case 0x9:
+                    targets.push_back(next);
+                    targets.push_back(next + lengthAt(rom, next));
+                    return Analyzer::Skip;
+                case 0x5:
+                    if((opcode & 0xF) == 0x0) {
+                        targets.push_back(next);
+                        targets.push_back(next + lengthAt(rom, next));
+                        return Analyzer::Skip;
+                    }
+                    break;
+                case 0xB:
+                    return Analyzer::IndirectJump;
+                case 0xE:
+                    targets.push_back(next);
+                    targets.push_back(next + lengthAt(rom, next));
+                    return Analyzer::Skip;
+            }
+            return Analyzer::FallThrough;
+        }
+
+        // Gets the value of I after instruction, given its value before.
+        int transfer(const Instruction &instruction, int i)
+        {
+            unsigned int opcode = instruction.opcode;
+            if((opcode >> 12) == 0xA) {
+                return opcode & 0xFFF;
+            }
+            if(opcode == 0xF000) {
+                return instruction.operand;
+            }
+            if((opcode & 0xF0FF) == 0xF01E || (opcode & 0xF0FF) == 0xF029) {
+                return Varying;
+            }
+            return i;
+        }
+
+        // Gives the plane mask after instruction, FN01 selects planes N.
+        int transferPlanes(const Instruction &instruction, int planes)
+        {
+            if((instruction.opcode & 0xF0FF) == 0xF001) {
+                return (instruction.opcode >> 8) & 0x3;
+            }
+            return planes;
+        }
+
+        int meet(int a, int b)
+        {
+            if(a == Unset) {
+                return b;
+            }
+            if(b == Unset || a == b) {
+                return a;
+            }
+            return Varying;
+        }
+
+        void mark(Analyzer::Analysis &analysis, int i, unsigned int length, unsigned char flag)
+        {
+            if(i < 0) {
+                return;
+            }
+            for(unsigned int address = i; address < i + length; address++) {
+                if(inRom(analysis.rom, address, 1)) {
+                    analysis.map[address - Memory::StartAddress] |= flag;
+                }
+            }
+        }
+
+        int countPlanes(unsigned int mask)
+        {
+            return (mask & 0x1) + ((mask >> 1) & 0x1);
+        }
+
+        // Gives the planes a sprite is drawn to, both if the mask isn't known.
+        int spritePlanes(int planes)
+        {
+            return planes < 0 ? 2 : countPlanes(planes);
+        }
+
+        void discover(Analyzer::Analysis &analysis, std::vector<unsigned char> &starts,
+                      std::vector<unsigned char> &leaders, std::vector<unsigned char> &called)
+        {
+            const std::vector<unsigned char> &rom = analysis.rom;
+            std::vector<unsigned int> work(1, Memory::StartAddress);
+            std::vector<unsigned int> targets;
+            leaders[0] = 1;
+            while(!work.empty()) {
+                unsigned int address = work.back();
+                work.pop_back();
+                Instruction instruction;
+                while(!starts[address - Memory::StartAddress] && decode(rom, address, instruction)) {
+                    starts[address - Memory::StartAddress] = 1;
+                    mark(analysis, address, instruction.length, Analyzer::Code);
+
+                    Analyzer::Exit exit = flow(rom, address, instruction, targets);
+                    for(size_t t = 0; t < targets.size(); t++) {
+                        if(inRom(rom, targets[t], 2)) {
+                            leaders[targets[t] - Memory::StartAddress] = 1;
+                            work.push_back(targets[t]);
+                        }
+                    }
+                    if(exit == Analyzer::Call && inRom(rom, targets[0], 2)) {
+                        called[targets[0] - Memory::StartAddress] = 1;
+                    }
+                    if(exit != Analyzer::FallThrough) {
+                        break;
+                    }
+                    address += instruction.length;
+                    if(!inRom(rom, address, 2)) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        void buildBlocks(Analyzer::Analysis &analysis, const std::vector<unsigned char> &starts,
+                         const std::vector<unsigned char> &leaders, const std::vector<unsigned char> &called)
+        {
+            const std::vector<unsigned char> &rom = analysis.rom;
+            std::vector<unsigned int> targets;
+            unsigned int covered = 0;
+            for(unsigned int offset = 0; offset < rom.size(); offset++) {
+                if(!starts[offset] || (!leaders[offset] && offset < covered)) {
+                    continue;
+                }
+
+                Analyzer::Block block;
+                block.start = Memory::StartAddress + offset;
+                block.subroutine = called[offset] != 0;
+                unsigned int address = block.start;
+                for(;;) {
+                    Instruction instruction;
+                    decode(rom, address, instruction);
+                    block.exit = flow(rom, address, instruction, targets);
+                    block.end = address + instruction.length;
+                    if(block.exit != Analyzer::FallThrough) {
+                        block.successors = targets;
+                        break;
+                    }
+
+                    unsigned int next = block.end;
+                    if(!inRom(rom, next, 2)) {
+                        block.exit = Analyzer::End;
+                        break;
+                    }
+                    if(!starts[next - Memory::StartAddress]) {
+                        block.exit = Analyzer::Invalid;
+                        break;
+                    }
+                    if(leaders[next - Memory::StartAddress]) {
+                        block.successors.push_back(next);
+                        break;
+                    }
+                    address = next;
+                }
+                analysis.blocks.push_back(block);
+                covered = std::max(covered, block.end - Memory::StartAddress);
+            }
+        }
+
+        // Finds where I and the plane mask hold known values and marks what
+        // the sprite and memory instructions there read or write. Both are
+        // tracked through the same pass, so an FN01 in one block still
+        // counts in the blocks it leads to.
+        void markData(Analyzer::Analysis &analysis)
+        {
+            const std::vector<unsigned char> &rom = analysis.rom;
+            const std::vector<Analyzer::Block> &blocks = analysis.blocks;
+            std::map<unsigned int, size_t> index;
+            for(size_t b = 0; b < blocks.size(); b++) {
+                index[blocks[b].start] = b;
+            }
+
+            std::vector<int> in(blocks.size(), Unset);
+            std::vector<int> inPlanes(blocks.size(), Unset);
+            std::vector<size_t> work;
+            if(!blocks.empty() && blocks[0].start == Memory::StartAddress) {
+                in[0] = Varying;
+                // Only plane 0 is selected at boot.
+                inPlanes[0] = 0x1;
+                work.push_back(0);
+            }
+            while(!work.empty()) {
+                size_t b = work.back();
+                work.pop_back();
+
+                int i = in[b];
+                int planes = inPlanes[b];
+                Instruction instruction;
+                for(unsigned int address = blocks[b].start; address < blocks[b].end; address += instruction.length) {
+                    decode(rom, address, instruction);
+                    i = transfer(instruction, i);
+                    planes = transferPlanes(instruction, planes);
+                }
+
+                for(size_t s = 0; s < blocks[b].successors.size(); s++) {
+                    std::map<unsigned int, size_t>::const_iterator it = index.find(blocks[b].successors[s]);
+                    if(it == index.end()) {
+                        continue;
+                    }
+                    // The subroutine can leave anything in I and the mask.
+                    int value = i;
+                    int valuePlanes = planes;
+                    if(blocks[b].exit == Analyzer::Call && s == 1) {
+                        value = Varying;
+                        valuePlanes = Varying;
+                    }
+                    int merged = meet(in[it->second], value);
+                    int mergedPlanes = meet(inPlanes[it->second], valuePlanes);
+                    if(merged != in[it->second] || mergedPlanes != inPlanes[it->second]) {
+                        in[it->second] = merged;
+                        inPlanes[it->second] = mergedPlanes;
+                        work.push_back(it->second);
+                    }
+                }
+            }
+
+            for(size_t b = 0; b < blocks.size(); b++) {
+                if(in[b] == Unset) {
+                    continue;
+                }
+                int i = in[b];
+                int planes = inPlanes[b];
+                Instruction instruction;
+                for(unsigned int address = blocks[b].start; address < blocks[b].end; address += instruction.length) {
+                    decode(rom, address, instruction);
+                    unsigned int opcode = instruction.opcode;
+                    unsigned int x = (opcode >> 8) & 0xF;
+                    unsigned int y = (opcode >> 4) & 0xF;
+                    if((opcode >> 12) == 0xD) {
+                        // DXY0 reads nothing, this interpreter has no 16x16
+                        // SCHIP sprites.
+                        mark(analysis, i, (opcode & 0xF) * spritePlanes(planes), Analyzer::Sprite);
+                    } else if((opcode & 0xF0FF) == 0xF033) {
+                        mark(analysis, i, 3, Analyzer::Data);
+                    } else if((opcode & 0xF0FF) == 0xF055 || (opcode & 0xF0FF) == 0xF065) {
+                        mark(analysis, i, x + 1, Analyzer::Data);
+                    } else if((opcode & 0xF00E) == 0x5002) {
+                        mark(analysis, i, (x > y ? x - y : y - x) + 1, Analyzer::Data);
+                    }
+                    i = transfer(instruction, i);
+                    planes = transferPlanes(instruction, planes);
+                }
+            }
+        }
+
+        const char * flagName(unsigned char flags)
+        {
+            static const char *names[8] = {
+                "unknown", "code", "sprite", "code+sprite", "data", "code+data", "sprite+data", "code+sprite+data"
+            };
+            return names[flags & 0x7];
+        }
+
+        const char * exitName(Analyzer::Exit exit)
+        {
+            switch(exit) {
+                case Analyzer::FallThrough: return "fall through";
+                case Analyzer::Jump: return "jump";
+                case Analyzer::Call: return "call";
+                case Analyzer::Return: return "return";
+                case Analyzer::Skip: return "skip";
+                case Analyzer::IndirectJump: return "indirect jump";
+                case Analyzer::Halt: return "halt";
+                case Analyzer::Invalid: return "invalid";
+                default: return "end of rom";
+            }
+        }
+
+        void writeInstruction(const Analyzer::Analysis &analysis, unsigned int address, Instruction &instruction, const char *end, std::ostream &out)
+        {
+            char text[32];
+            char line[80];
+            decode(analysis.rom, address, instruction);
+            describe(instruction.opcode, instruction.operand, text, sizeof(text));
+            if(instruction.length == 4) {
+                snprintf(line, sizeof(line), "0x%03X  %04X%04X  %s%s", address, instruction.opcode, instruction.operand, text, end);
+            } else {
+                snprintf(line, sizeof(line), "0x%03X  %04X      %s%s", address, instruction.opcode, text, end);
+            }
+            out << line;
+        }
+
+        void writeData(const Analyzer::Analysis &analysis, unsigned int from, unsigned int to, std::ostream &out)
+        {
+            char line[80];
+            unsigned int address = from;
+            while(address < to) {
+                unsigned char flags = analysis.flags(address);
+                unsigned char byte = analysis.rom[address - Memory::StartAddress];
+                if(flags & Analyzer::Sprite) {
+                    char bits[9];
+                    for(int bit = 0; bit < 8; bit++) {
+                        bits[bit] = (byte & (0x80 >> bit)) ? '#' : '.';
+                    }
+                    bits[8] = '\0';
+                    snprintf(line, sizeof(line), "0x%03X  %02X        DB 0x%02X                ; %s", address, byte, byte, bits);
+                    out << line << std::endl;
+                    address++;
+                    continue;
+                }
+
+                // Up to 8 bytes of the same kind on one line.
+                std::string bytes;
+                unsigned int start = address;
+                while(address < to && address - start < 8 && analysis.flags(address) == flags) {
+                    char hex[8];
+                    snprintf(hex, sizeof(hex), "%s0x%02X", bytes.empty() ? "" : ", ", analysis.rom[address - Memory::StartAddress]);
+                    bytes += hex;
+                    address++;
+                }
+                snprintf(line, sizeof(line), "0x%03X            DB ", start);
+                out << line << bytes << " ; " << flagName(flags) << std::endl;
+            }
+        }
+    }
+
+    unsigned char Analyzer::Analysis::flags(unsigned int address) const
+    {
+        if(!inRom(rom, address, 1)) {
+            return 0;
+        }
+        return map[address - Memory::StartAddress];
+    }
+
+    const Analyzer::Block * Analyzer::Analysis::findBlock(unsigned int address) const
+    {
+        size_t low = 0;
+        size_t high = blocks.size();
+        while(low < high) {
+            size_t middle = (low + high) / 2;
+            if(blocks[middle].start < address) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if(low < blocks.size() && blocks[low].start == address) {
+            return &blocks[low];
+        }
+        return NULL;
+    }
+
+    std::shared_ptr<const Analyzer::Analysis> Analyzer::analyze(const std::vector<unsigned char> &rom)
+    {
+        Uint64 romHash = hash(rom);
+        Cache &analyses = cache();
+        {
+            std::lock_guard<std::mutex> lock(analyses.mutex);
+            std::map<Uint64, std::shared_ptr<const Analysis> >::const_iterator it = analyses.entries.find(romHash);
+            if(it != analyses.entries.end() && it->second->rom == rom) {
+                return it->second;
+            }
+        }
+
+        std::shared_ptr<Analysis> analysis(new Analysis());
+        analysis->hash = romHash;
+        analysis->rom = rom;
+        analysis->map.assign(rom.size(), 0);
+
+        std::vector<unsigned char> starts(rom.size(), 0);
+        std::vector<unsigned char> leaders(rom.size(), 0);
+        std::vector<unsigned char> called(rom.size(), 0);
+        if(!rom.empty()) {
+            discover(*analysis, starts, leaders, called);
+            buildBlocks(*analysis, starts, leaders, called);
+            markData(*analysis);
+        }
+        LOG(INFO) << _Tag << "Analyzed " << rom.size() << " byte rom into " << analysis->blocks.size() << " blocks";
+
+        std::lock_guard<std::mutex> lock(analyses.mutex);
+        analyses.entries[romHash] = analysis;
+        return analysis;
+    }
+
+    void Analyzer::clearCache()
+    {
+        Cache &analyses = cache();
+        std::lock_guard<std::mutex> lock(analyses.mutex);
+        analyses.entries.clear();
+    }
+
+    Uint64 Analyzer::hash(const std::vector<unsigned char> &rom)
+    {
+        Uint64 hash = 0xCBF29CE484222325ULL;
+        for(size_t i = 0; i < rom.size(); i++) {
+            hash ^= rom[i];
+            hash *= 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    unsigned int Analyzer::instructionLength(unsigned char upper, unsigned char lower)
+    {
+        return (upper == 0xF0 && lower == 0x00) ? 4 : 2;
+    }
+
+    std::string Analyzer::disassemble(unsigned int opcode, unsigned int operand)
+    {
+        char text[32];
+        describe(opcode, operand, text, sizeof(text));
+        return text;
+    }
+
+    void Analyzer::writeDisassembly(const Analysis &analysis, std::ostream &out)
+    {
+        char line[80];
+        snprintf(line, sizeof(line), "; %u bytes, %u blocks, hash %016llX", (unsigned int) analysis.rom.size(),
+                 (unsigned int) analysis.blocks.size(), (unsigned long long) analysis.hash);
+        out << line << std::endl;
+
+        unsigned int address = Memory::StartAddress;
+        unsigned int romEnd = Memory::StartAddress + analysis.rom.size();
+        for(size_t b = 0; b < analysis.blocks.size(); b++) {
+            const Block &block = analysis.blocks[b];
+            if(block.start > address) {
+                writeData(analysis, address, block.start, out);
+            }
+
+            snprintf(line, sizeof(line), "%s_%03X:", block.subroutine ? "sub" : "block", block.start);
+            out << std::endl << line << std::endl;
+            Instruction instruction;
+            for(unsigned int pc = block.start; pc < block.end; pc += instruction.length) {
+                writeInstruction(analysis, pc, instruction, "", out);
+                out << std::endl;
+            }
+            if(block.exit == Invalid || block.exit == End || block.exit == IndirectJump) {
+                out << "                 ; " << exitName(block.exit) << std::endl;
+            }
+            address = std::max(address, block.end);
+        }
+        if(address < romEnd) {
+            out << std::endl;
+            writeData(analysis, address, romEnd, out);
+        }
+    }
+
+    void Analyzer::writeCfg(const Analysis &analysis, std::ostream &out)
+    {
+        char name[16];
+        out << "digraph cfg {" << std::endl
+            << "    node [shape=box, fontname=\"monospace\"];" << std::endl;
+        for(size_t b = 0; b < analysis.blocks.size(); b++) {
+            const Block &block = analysis.blocks[b];
+            snprintf(name, sizeof(name), "0x%03X", block.start);
+            out << "    \"" << name << "\" [label=\"";
+            Instruction instruction;
+            for(unsigned int pc = block.start; pc < block.end; pc += instruction.length) {
+                writeInstruction(analysis, pc, instruction, "\\l", out);
+            }
+            out << "\"" << (block.subroutine ? ", peripheries=2" : "") << "];" << std::endl;
+
+            for(size_t s = 0; s < block.successors.size(); s++) {
+                char target[16];
+                snprintf(target, sizeof(target), "0x%03X", block.successors[s]);
+                out << "    \"" << name << "\" -> \"" << target << "\"";
+                if(block.exit == Call) {
+                    out << (s == 0 ? " [label=\"call\"]" : " [label=\"return\", style=dashed]");
+                } else if(block.exit == Skip && s == 1) {
+                    out << " [label=\"skip\"]";
+                }
+                out << ";" << std::endl;
+            }
+        }
+        out << "}" << std::endl;
+    }
+
+    void Analyzer::writeMap(const Analysis &analysis, std::ostream &out)
+    {
+        char line[80];
+        unsigned int totals[4] = {0, 0, 0, 0};
+        size_t size = analysis.map.size();
+        size_t start = 0;
+        while(start < size) {
+            size_t end = start;
+            while(end < size && analysis.map[end] == analysis.map[start]) {
+                end++;
+            }
+            unsigned char flags = analysis.map[start];
+            snprintf(line, sizeof(line), "0x%03X-0x%03X  %-12s %u bytes", (unsigned int) (Memory::StartAddress + start),
+                     (unsigned int) (Memory::StartAddress + end - 1), flagName(flags), (unsigned int) (end - start));
+            out << line << std::endl;
+
+            if(flags & Code) {
+                totals[0] += end - start;
+            } else if(flags & Sprite) {
+                totals[1] += end - start;
+            } else if(flags & Data) {
+                totals[2] += end - start;
+            } else {
+                totals[3] += end - start;
+            }
+            start = end;
+        }
+        out << "code " << totals[0] << ", sprite " << totals[1] << ", data " << totals[2]
+            << ", unknown " << totals[3] << " bytes" << std::endl;
+    }
+}
@@ -0,0 +1,173 @@
+#include <Audio.hpp>
+
+#include <glog/logging.h>
+
+namespace Chip8
+{
+    const int Audio::SampleRate = 44100;
+    const int Audio::BuzzerFrequency = 440;
+
+    const std::string Audio::_Tag = "Audio:";
+
+    namespace
+    {
+        // Timer steps per second.
+        const int TickRate = 60;
+
+        // 8 steps is 133ms, the producer never needs more than a few.
+        const size_t RingCapacity = 8;
+
+        // Steps queued before playback starts, which is the added latency.
+        const size_t PrefillTicks = 2;
+
+        // 512 samples is 11.6ms at 44100Hz.
+        const Uint16 DeviceSamples = 512;
+
+        const Sint16 Amplitude = 3000;
+    }
+
+    Audio::Audio()
+        : _ticks(RingCapacity),
+          _device(0),
+          _samplesPerTick(SampleRate / TickRate),
+          _started(false),
+          _buzzing(false),
+          _tickSamplesLeft(0),
+          _phase(0),
+          _phaseStep(0),
+          _underruns(0),
+          _overruns(0)
+    {
+    }
+
+    Audio & Audio::instance()
+    {
+        static Audio instance;
+        return instance;
+    }
+
+    bool Audio::open()
+    {
+        if(_device != 0) {
+            return true;
+        }
+        if(SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+            LOG(INFO) << _Tag << "Failed to init SDL audio - " << SDL_GetError();
+            return false;
+        }
+
+        SDL_AudioSpec desired;
+        SDL_AudioSpec obtained;
+        SDL_memset(&desired, 0, sizeof(desired));
+        desired.freq = SampleRate;
+        desired.format = AUDIO_S16SYS;
+        desired.channels = 1;
+        desired.samples = DeviceSamples;
+        desired.callback = &Audio::callback;
+        desired.userdata = this;
+
+        // Only the frequency may differ, the callback always writes mono S16.
+        _device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+        if(_device == 0) {
+            LOG(INFO) << _Tag << "Failed to open audio device - " << SDL_GetError();
+            SDL_QuitSubSystem(SDL_INIT_AUDIO);
+            return false;
+        }
+
+        _samplesPerTick = obtained.freq / TickRate;
+        _phaseStep = (Uint32) (((Uint64) BuzzerFrequency << 32) / obtained.freq);
+        _started = false;
+        _buzzing = false;
+        _tickSamplesLeft = 0;
+        _phase = 0;
+        LOG(INFO) << _Tag << "Opened " << SDL_GetCurrentAudioDriver() << " audio at " << obtained.freq << "Hz, " << obtained.samples << " samples";
+        SDL_PauseAudioDevice(_device, 0);
+        return true;
+    }
+
+    void Audio::close()
+    {
+        if(_device == 0) {
+            return;
+        }
+        SDL_CloseAudioDevice(_device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        _device = 0;
+        LOG(INFO) << _Tag << "Closed audio, " << underruns() << " underruns, " << overruns() << " overruns";
+    }
+
+    void Audio::tick(unsigned int soundTimer)
+    {
+        if(_device == 0) {
+            return;
+        }
+        if(!_ticks.push(soundTimer > 0 ? 1 : 0)) {
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Uint64 Audio::underruns() const
+    {
+        return _underruns.load(std::memory_order_relaxed);
+    }
+
+    Uint64 Audio::overruns() const
+    {
+        return _overruns.load(std::memory_order_relaxed);
+    }
+
+    void Audio::callback(void *userdata, Uint8 *stream, int length)
+    {
+        static_cast<Audio *>(userdata)->fill(reinterpret_cast<Sint16 *>(stream), length / sizeof(Sint16));
+    }
+
+    void Audio::fill(Sint16 *samples, int count)
+    {
+        if(!_started) {
+            if(_ticks.size() < PrefillTicks) {
+                SDL_memset(samples, 0, count * sizeof(Sint16));
+                return;
+            }
+            _started = true;
+            _tickSamplesLeft = 0;
+        }
+
+        int i = 0;
+        while(i < count) {
+            if(_tickSamplesLeft == 0) {
+                // The emulator's clock and the device's drift apart. Steps
+                // queued beyond the prefill are latency, so the oldest are
+                // dropped to keep it near PrefillTicks.
+                unsigned char state = 0;
+                while(_ticks.size() > PrefillTicks + 1) {
+                    _ticks.pop(state);
+                }
+                // Move on to the next timer step. If the emulator is late keep
+                // the current state, which only matters while buzzing, and
+                // prefill again before the next buffer.
+                if(_ticks.pop(state)) {
+                    _buzzing = state != 0;
+                } else {
+                    if(_buzzing) {
+                        _underruns.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    _started = false;
+                }
+                _tickSamplesLeft = _samplesPerTick;
+            }
+
+            int n = count - i < _tickSamplesLeft ? count - i : _tickSamplesLeft;
+            if(_buzzing) {
+                for(int k = 0; k < n; k++) {
+                    samples[i + k] = (_phase & 0x80000000u) ? Amplitude : -Amplitude;
+                    _phase += _phaseStep;
+                }
+            } else {
+                SDL_memset(samples + i, 0, n * sizeof(Sint16));
+                _phase = 0;
+            }
+            i += n;
+            _tickSamplesLeft -= n;
+        }
+    }
+}
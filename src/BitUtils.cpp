@@ -27,4 +27,20 @@ namespace Chip8
         ret = (ret << 8) | data2;
         return ret;
     }
+
+    Uint64 BitUtils::rotateRight(Uint64 data, unsigned int count)
+    {
+        count &= 63;
+        if(count == 0) {
+            return data;
+        }
+        return (data >> count) | (data << (64 - count));
+    }
+
+    Uint64 BitUtils::mix(Uint64 data)
+    {
+        data = (data ^ (data >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        data = (data ^ (data >> 27)) * 0x94D049BB133111EBULL;
+        return data ^ (data >> 31);
+    }
 }
@@ -0,0 +1,265 @@
+#include <Capture.hpp>
+#include <Video.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <string.h>
+
+namespace Chip8
+{
+    const std::string Capture::_Tag = "Capture:";
+
+    namespace
+    {
+        // About 4 seconds of frames at 60Hz.
+        const size_t QueueCapacity = 256;
+
+        const char FrameHeader[] = "FRAME\n";
+        const size_t FrameHeaderSize = sizeof(FrameHeader) - 1;
+    }
+
+    Capture::Capture()
+        : _queue(QueueCapacity),
+          _stopping(false),
+          _file(0),
+          _format(Y4M),
+          _hasLast(false),
+          _pendingRepeats(0),
+          _dropped(0),
+          _written(0)
+    {
+    }
+
+    Capture::~Capture()
+    {
+        close();
+    }
+
+    bool Capture::open(const std::string &path, Format format)
+    {
+        if(isOpen()) {
+            LOG(INFO) << _Tag << "Capture already running";
+            return false;
+        }
+
+        if(path == "-") {
+            _file = stdout;
+        } else {
+            _file = fopen(path.c_str(), "wb");
+        }
+        if(_file == 0) {
+            LOG(INFO) << _Tag << "Failed to open " << path;
+            return false;
+        }
+
+        _format = format;
+        int pixels = Video::Width * Video::Height;
+        if(_format == Y4M) {
+            fprintf(_file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", Video::Width, Video::Height);
+            _expanded.resize(FrameHeaderSize + pixels * 3);
+            memcpy(&_expanded[0], FrameHeader, FrameHeaderSize);
+        } else {
+            _expanded.resize(pixels * 4);
+        }
+
+        _hasLast = false;
+        _pendingRepeats = 0;
+        _stopping.store(false);
+        _writer = std::thread(&Capture::run, this);
+        LOG(INFO) << _Tag << "Capturing to " << path;
+        return true;
+    }
+
+    void Capture::close()
+    {
+        if(!isOpen()) {
+            return;
+        }
+
+        // Shutting down is allowed to wait for the writer to make room.
+        while(!flushRepeats()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        _stopping.store(true, std::memory_order_release);
+        _writer.join();
+
+        if(_file == stdout) {
+            fflush(_file);
+        } else {
+            fclose(_file);
+        }
+        _file = 0;
+        LOG(INFO) << _Tag << "Capture closed, " << writtenFrames() << " frames written, " << droppedFrames() << " dropped";
+    }
+
+    bool Capture::isOpen() const
+    {
+        return _file != 0;
+    }
+
+    void Capture::pushFrame(const Video &video)
+    {
+        if(!isOpen()) {
+            return;
+        }
+
+        Uint8 colors[4][3];
+        for(int i = 0; i < 4; i++) {
+            video.getPaletteColor(i, colors[i][0], colors[i][1], colors[i][2]);
+        }
+
+        // Static screens only cost a compare.
+        if(_hasLast &&
+           memcmp(_last.planes[0], video.getPlane(0), sizeof(_last.planes[0])) == 0 &&
+           memcmp(_last.planes[1], video.getPlane(1), sizeof(_last.planes[1])) == 0 &&
+           memcmp(_last.colors, colors, sizeof(colors)) == 0) {
+            _pendingRepeats++;
+            flushRepeats();
+            return;
+        }
+
+        // The repeats have to go out before the new frame. If there is no
+        // room the frame is dropped and the previous frame stands in for it.
+        Entry *entry = 0;
+        if(flushRepeats()) {
+            entry = _queue.acquire();
+        }
+        if(entry == 0) {
+            _pendingRepeats++;
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        entry->repeats = 0;
+        memcpy(entry->planes[0], video.getPlane(0), sizeof(entry->planes[0]));
+        memcpy(entry->planes[1], video.getPlane(1), sizeof(entry->planes[1]));
+        memcpy(entry->colors, colors, sizeof(colors));
+        memcpy(&_last, entry, sizeof(_last));
+        _hasLast = true;
+        _queue.commit();
+    }
+
+    Uint64 Capture::droppedFrames() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    Uint64 Capture::writtenFrames() const
+    {
+        return _written.load(std::memory_order_relaxed);
+    }
+
+    bool Capture::parseFormat(const std::string &name, Format &format)
+    {
+        if(name == "y4m") {
+            format = Y4M;
+        } else if(name == "rgba") {
+            format = RGBA;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool Capture::flushRepeats()
+    {
+        if(_pendingRepeats == 0) {
+            return true;
+        }
+        Entry *entry = _queue.acquire();
+        if(entry == 0) {
+            return false;
+        }
+        entry->repeats = _pendingRepeats;
+        _queue.commit();
+        _pendingRepeats = 0;
+        return true;
+    }
+
+    void Capture::run()
+    {
+        bool haveFrame = false;
+        while(true) {
+            Entry *entry = _queue.front();
+            if(entry == 0) {
+                // Everything pushed before close() is visible once the stop
+                // flag is, so one more look decides if the queue is drained.
+                if(_stopping.load(std::memory_order_acquire)) {
+                    entry = _queue.front();
+                    if(entry == 0) {
+                        break;
+                    }
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    continue;
+                }
+            }
+
+            if(entry->repeats == 0) {
+                expand(*entry);
+                haveFrame = true;
+                write();
+            } else if(haveFrame) {
+                // The expanded previous frame is still in _expanded.
+                for(Uint32 i = 0; i < entry->repeats; i++) {
+                    write();
+                }
+            }
+            _queue.release();
+        }
+        fflush(_file);
+    }
+
+    void Capture::expand(const Entry &entry)
+    {
+        int pixels = Video::Width * Video::Height;
+
+        // Resolve the palette once per frame.
+        Uint8 lut[4][4];
+        for(int i = 0; i < 4; i++) {
+            int r = entry.colors[i][0];
+            int g = entry.colors[i][1];
+            int b = entry.colors[i][2];
+            if(_format == Y4M) {
+                // BT.601 studio range.
+                lut[i][0] = (Uint8) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                lut[i][1] = (Uint8) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                lut[i][2] = (Uint8) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            } else {
+                lut[i][0] = (Uint8) r;
+                lut[i][1] = (Uint8) g;
+                lut[i][2] = (Uint8) b;
+            }
+            lut[i][3] = 255;
+        }
+
+        Uint8 *out = &_expanded[0];
+        if(_format == Y4M) {
+            out += FrameHeaderSize;
+        }
+        for(int j = 0; j < Video::Height; j++) {
+            for(int i = 0; i < Video::Width; i++) {
+                int shift = Video::Width - 1 - i;
+                int index = ((entry.planes[0][j] >> shift) & 0x1) | (((entry.planes[1][j] >> shift) & 0x1) << 1);
+                int pixel = j * Video::Width + i;
+                if(_format == Y4M) {
+                    out[pixel] = lut[index][0];
+                    out[pixels + pixel] = lut[index][1];
+                    out[2 * pixels + pixel] = lut[index][2];
+                } else {
+                    memcpy(out + pixel * 4, lut[index], 4);
+                }
+            }
+        }
+    }
+
+    void Capture::write()
+    {
+        if(fwrite(&_expanded[0], 1, _expanded.size(), _file) != _expanded.size()) {
+            LOG(INFO) << _Tag << "Failed to write frame";
+            return;
+        }
+        _written.fetch_add(1, std::memory_order_relaxed);
+    }
+}
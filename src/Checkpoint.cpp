@@ -0,0 +1,188 @@
+#include <BitUtils.hpp>
+#include <Checkpoint.hpp>
+
+#include <glog/logging.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+    const std::string Checkpoint::_Tag = "Checkpoint:";
+    const Uint32 Checkpoint::Magic = 0x4B433843;
+    const Uint32 Checkpoint::Version = 1;
+
+    namespace
+    {
+        static_assert(sizeof(Checkpoint::Header) == 64, "Header changed");
+
+        // Makes a rename in the directory holding path durable.
+        void syncDirectory(const std::string &path)
+        {
+            size_t slash = path.rfind('/');
+            std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+            int fd = open(directory.c_str(), O_RDONLY);
+            if(fd >= 0) {
+                fsync(fd);
+                close(fd);
+            }
+        }
+    }
+
+    Checkpoint::Checkpoint()
+        : _memory(0),
+          _size(0),
+          _writing(false)
+    {
+    }
+
+    Checkpoint::~Checkpoint()
+    {
+        close();
+    }
+
+    Checkpoint::Job * Checkpoint::begin(const std::string &path, size_t count, Uint64 run, Uint64 sequence)
+    {
+        close();
+        std::string temporary = path + ".tmp";
+        int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            LOG(INFO) << _Tag << "Failed to create " << temporary << " - " << strerror(errno);
+            return 0;
+        }
+        size_t size = sizeof(Header) + count * sizeof(Job);
+        void *memory = MAP_FAILED;
+        if(ftruncate(fd, (off_t) size) == 0) {
+            memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        int mapError = errno;
+        ::close(fd);
+        if(memory == MAP_FAILED) {
+            LOG(INFO) << _Tag << "Failed to map " << temporary << " - " << strerror(mapError);
+            unlink(temporary.c_str());
+            return 0;
+        }
+
+        // The file is new, so it reads as zeroes and Machine::save copies
+        // every page into it.
+        _memory = memory;
+        _size = size;
+        _writing = true;
+        _path = path;
+        Header &header = *(Header *) _memory;
+        header.version = Version;
+        header.jobSize = sizeof(Job);
+        header.count = (Uint32) count;
+        header.run = run;
+        header.sequence = sequence;
+        return (Job *) (&header + 1);
+    }
+
+    bool Checkpoint::commit()
+    {
+        if(_memory == 0 || !_writing) {
+            return false;
+        }
+        Header &header = *(Header *) _memory;
+        header.checksum = checksum(header);
+        header.magic = Magic;
+
+        std::string temporary = _path + ".tmp";
+        int fd = open(temporary.c_str(), O_RDWR);
+        bool written = fd >= 0 && msync(_memory, _size, MS_SYNC) == 0 && fsync(fd) == 0;
+        int writeError = errno;
+        if(fd >= 0) {
+            ::close(fd);
+        }
+        if(!written || rename(temporary.c_str(), _path.c_str()) != 0) {
+            LOG(INFO) << _Tag << "Failed to write " << _path << " - " << strerror(written ? errno : writeError);
+            close();
+            return false;
+        }
+        syncDirectory(_path);
+        // What's mapped is now path, so close mustn't remove path.tmp.
+        _writing = false;
+        return true;
+    }
+
+    const Checkpoint::Job * Checkpoint::load(const std::string &path, Uint64 run)
+    {
+        close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) {
+            if(errno != ENOENT) {
+                LOG(INFO) << _Tag << "Failed to open " << path << " - " << strerror(errno);
+            }
+            return 0;
+        }
+        struct stat status;
+        void *memory = MAP_FAILED;
+        if(fstat(fd, &status) == 0 && (size_t) status.st_size >= sizeof(Header)) {
+            memory = mmap(0, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if(memory == MAP_FAILED) {
+            LOG(INFO) << _Tag << path << " is too short or can't be mapped";
+            return 0;
+        }
+        _memory = memory;
+        _size = (size_t) status.st_size;
+        _writing = false;
+        _path = path;
+
+        const Header &header = *(const Header *) _memory;
+        if(header.magic != Magic || header.version != Version || header.jobSize != sizeof(Job)) {
+            LOG(INFO) << _Tag << path << " isn't a version " << Version << " checkpoint from this build";
+        } else if(header.run != run) {
+            LOG(INFO) << _Tag << path << " is a checkpoint of another run";
+        } else if(_size != sizeof(Header) + (size_t) header.count * sizeof(Job)) {
+            LOG(INFO) << _Tag << path << " is truncated";
+        } else if(header.checksum != checksum(header)) {
+            LOG(INFO) << _Tag << path << " is damaged";
+        } else {
+            return (const Job *) (&header + 1);
+        }
+        close();
+        return 0;
+    }
+
+    size_t Checkpoint::count() const
+    {
+        return _memory == 0 ? 0 : ((const Header *) _memory)->count;
+    }
+
+    Uint64 Checkpoint::sequence() const
+    {
+        return _memory == 0 ? 0 : ((const Header *) _memory)->sequence;
+    }
+
+    void Checkpoint::close()
+    {
+        if(_memory == 0) {
+            return;
+        }
+        munmap(_memory, _size);
+        if(_writing) {
+            unlink((_path + ".tmp").c_str());
+        }
+        _memory = 0;
+        _size = 0;
+        _writing = false;
+        _path.clear();
+    }
+
+    Uint64 Checkpoint::checksum(const Header &header)
+    {
+        const Uint64 *words = (const Uint64 *) (&header + 1);
+        size_t count = (size_t) header.count * sizeof(Job) / sizeof(Uint64);
+        Uint64 hash = BitUtils::mix(header.run ^ header.sequence);
+        for(size_t i = 0; i < count; i++) {
+            hash = BitUtils::mix(hash ^ words[i]);
+        }
+        return hash;
+    }
+}
@@ -1,35 +1,69 @@
 #include <Cpu.hpp>
+#include <Machine.hpp>
 #include <BitUtils.hpp>
 #include <Memory.hpp>
 #include <Input.hpp>
 #include <Video.hpp>
 #include <Timers.hpp>
+#include <Metrics.hpp>
 
 #include <glog/logging.h>
-#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 namespace Chip8
 {
     const std::string Cpu::_Tag = "Cpu:";
 
+    namespace
+    {
+        const int StackSize = 16;
+
+        // DXYN draws at most 15 rows to each of the two XO-CHIP planes.
+        const unsigned int MaxSpriteBytes = 0xF * 2;
+
+        // A ROM that overflows its stack usually does so every frame, so
+        // only the first of every this many stack errors is logged.
+        const int StackErrorLogInterval = 1000;
+    }
+
     Cpu::Cpu()
         : _pc(0),
           _sp(-1)
     {
         // Clear stack.
-        for(int i = 0; i < 16; i++) {
+        for(int i = 0; i < StackSize; i++) {
             _stack[i] = 0;
         }
 
         // Seed random number generator
-        srand(time(NULL));
+        seed(time(NULL));
     }
 
     Cpu & Cpu::instance()
     {
-        static Cpu instance;
-        return instance;
+        return Machine::current().cpu();
+    }
+
+    void Cpu::saveState(State &state) const
+    {
+        state.pc = _pc;
+        state.sp = _sp;
+        memcpy(state.stack, _stack, sizeof(_stack));
+        state.random = _random;
+    }
+
+    void Cpu::loadState(const State &state)
+    {
+        _pc = state.pc;
+        _sp = state.sp;
+        memcpy(_stack, state.stack, sizeof(_stack));
+        _random = state.random;
+    }
+
+    void Cpu::seed(unsigned int seed)
+    {
+        _random = seed != 0 ? seed : 0x2545F491;
     }
 
     unsigned char Cpu::fetch()
@@ -37,17 +71,19 @@ namespace Chip8
         // Read next memory address past the PC
         unsigned char byte = 0;
         if(!Memory::instance().read(_pc, byte)) {
-            LOG(FATAL) << _Tag << "Failed to fetch next instruction at " << _pc;
+            LOG(INFO) << _Tag << "Failed to fetch next instruction at " << _pc;
         }
-        _pc++;
+        // Running off the end of memory wraps around to address 0.
+        _pc = (_pc + 1) % Memory::MaxAddress;
         return byte;
 }
 
     void Cpu::step()
     {
+        CHIP8_METRIC_ADD(instructions, 1);
         unsigned char upper = fetch();
         unsigned char lower = fetch();
-        LOG(INFO) << "Executing opcode " << (int) upper << " " << (int) lower;
+        VLOG(1) << "Executing opcode " << (int) upper << " " << (int) lower;
         unsigned int address = extractAddress(upper, lower);
         unsigned char firstLevelOpcode = BitUtils::upper(upper);
         unsigned char lowerLower = BitUtils::lower(lower);
@@ -101,10 +137,53 @@ namespace Chip8
                 skipNextInstruction();
             }
             break;
-         // SKIP IF REGISTER EQUAL 0x5XY0 - Skips the next instruction if VX == VY
          case 0x5:
-            if(dataX == dataY) {
-                skipNextInstruction();
+            switch(lowerLower) {
+                // SKIP IF REGISTER EQUAL 0x5XY0 - Skips the next instruction if VX == VY
+                case 0x0:
+                    if(dataX == dataY) {
+                        skipNextInstruction();
+                    }
+                    break;
+                // SAVE REGISTER RANGE 0x5XY2 - Store registers VX through VY in memory starting at I.
+                //                              I is not modified. (XO-CHIP)
+                case 0x2:
+                    {
+                        int direction = registerX <= registerY ? 1 : -1;
+                        int count = (registerY - registerX) * direction + 1;
+                        for(int i = 0; i < count; i++) {
+                            unsigned char reg = registerX + i * direction;
+                            unsigned char data = 0;
+                            if(!Memory::instance().getRegister(reg, data)) {
+                                LOG(INFO) << _Tag << "Failed to get data in register " << (int) reg;
+                            }
+                            if(!Memory::instance().write(Memory::instance().getI() + i, data)) {
+                                LOG(INFO) << _Tag << "Failed to write data " << (int) data << " to memory address " << Memory::instance().getI() + i;
+                            }
+                        }
+                    }
+                    break;
+                // LOAD REGISTER RANGE 0x5XY3 - Load registers VX through VY from memory starting at I.
+                //                              I is not modified. (XO-CHIP)
+                case 0x3:
+                    {
+                        int direction = registerX <= registerY ? 1 : -1;
+                        int count = (registerY - registerX) * direction + 1;
+                        for(int i = 0; i < count; i++) {
+                            unsigned char reg = registerX + i * direction;
+                            unsigned char data = 0;
+                            if(!Memory::instance().read(Memory::instance().getI() + i, data)) {
+                                LOG(INFO) << _Tag << "Failed to get data from memory address " << Memory::instance().getI() + i;
+                            }
+                            if(!Memory::instance().setRegister(reg, data)) {
+                                LOG(INFO) << _Tag << "Failed to write data " << (int) data << " to register " << (int) reg;
+                            }
+                        }
+                    }
+                    break;
+                default:
+                    LOG(INFO) << _Tag << "Unrecognized second level opcode " << (int) lowerLower << " for first level opcode " << (int) firstLevelOpcode;
+                    break;
             }
             break;
          // SET REGISTER 0x6xNN - Sets register VX to NN
@@ -180,7 +259,7 @@ namespace Chip8
                 // RIGHT SHIFT 0x8XY6 - If least significant bit of VX is 1 set VF to 1,
                 //                      otherwise 0. Then right shift VX.
                 case 0x6:
-                    if(BitUtils::bitQuery(0x0, dataX) == 0x1) {
+                    if(BitUtils::bitQuery(dataX, 0) == 0x1) {
                         if(!Memory::instance().setRegister(0xF, 0x1))  {
                             LOG(INFO) << _Tag << "Could not set carry flag to 1";
                         }
@@ -206,7 +285,7 @@ namespace Chip8
                 // LEFT SHIFT 0x8XYE - If most significant bit of VX is 1 set VF to 1,
                 //                     otherwise 0. Then left shift VX.
                 case 0xE:
-                    if(BitUtils::bitQuery(0x7, dataX) == 0x1) {
+                    if(BitUtils::bitQuery(dataX, 7) == 0x1) {
                         if(!Memory::instance().setRegister(0xF, 0x1))  {
                             LOG(INFO) << _Tag << "Could not set carry flag to 1";
                         }
@@ -232,7 +311,7 @@ namespace Chip8
             break;
          // LOAD ADDRESS 0xANNN - Sets the value of register I to NNN
          case 0xA:
-            LOG(INFO) << "Setting register I to " << address;
+            VLOG(1) << "Setting register I to " << address;
             Memory::instance().setI(address);
             break;
          // JUMP ADDRESS + V0 0xBNNN - Jumps to address + V0
@@ -250,24 +329,30 @@ namespace Chip8
                 break;
             }
          // DRAW SPRITE 0xDXYN - Draws a sprite of height N at coordinate (X, Y). The sprite is loaded from memory address I.
+         //                     With XO-CHIP every selected plane reads its own N bytes, one after the other.
          case 0xD:
          {
             // Read sprite from memory
             unsigned char n = BitUtils::lower(lower);
-            LOG(INFO) << "Loading " << (int) n << " byte sprite from location " << Memory::instance().getI();
-            unsigned char *sprite = new unsigned char[n];
-            for(int i = 0; i < n; i++) {
-                unsigned char data = 0;
-                if(!Memory::instance().read(Memory::instance().getI() + i, data)) {
-                    LOG(INFO) << _Tag << "Failed to read memory at address " << Memory::instance().getI() + i;
+            unsigned int size = n * Video::instance().selectedPlaneCount();
+            VLOG(1) << "Loading " << size << " byte sprite from location " << Memory::instance().getI();
+            const unsigned char *sprite = Memory::instance().span(Memory::instance().getI(), size);
+            unsigned char wrapped[MaxSpriteBytes];
+            if(sprite == 0) {
+                // Only a sprite running off the end of memory is copied, the
+                // bytes past the end read as 0.
+                for(unsigned int i = 0; i < size; i++) {
+                    unsigned char data = 0;
+                    if(!Memory::instance().read(Memory::instance().getI() + i, data)) {
+                        VLOG(1) << _Tag << "Failed to read memory at address " << Memory::instance().getI() + i;
+                    }
+                    wrapped[i] = data;
                 }
-                sprite[i] = data;
+                sprite = wrapped;
             }
 
             // Draw sprite onto screen
             Video::instance().drawSprite(dataX, dataY, sprite, n);
-            delete[] sprite;
-           
             break;
          }
          case 0xE:
@@ -278,7 +363,7 @@ namespace Chip8
                         LOG(INFO) << _Tag << dataX << " is not a valid key";
                         break;
                     }
-                    if(InputManager::instance().isKeyDown(InputManager::Keys[dataX])) {
+                    if(InputManager::instance().isHexKeyDown(dataX)) {
                         skipNextInstruction();
                     }
                     break;
@@ -288,7 +373,7 @@ namespace Chip8
                         LOG(INFO) << _Tag << dataX << " is not a valid key";
                         break;
                     }
-                    if(!InputManager::instance().isKeyDown(InputManager::Keys[dataX])) {
+                    if(!InputManager::instance().isHexKeyDown(dataX)) {
                         skipNextInstruction();
                     }
                     break;
@@ -299,6 +384,25 @@ namespace Chip8
             break;
          case 0xF:
             switch(lower) {
+                // LONG LOAD ADDRESS 0xF000 NNNN - Sets I to the 16 bit address NNNN stored in the
+                //                                 next 2 bytes. (XO-CHIP)
+                case 0x00:
+                    if(registerX != 0x0) {
+                        LOG(INFO) << _Tag << "Unrecognized second level opcode " << (int) lower << " for first level opcode " << (int) firstLevelOpcode;
+                        break;
+                    }
+                    {
+                        unsigned char addressUpper = fetch();
+                        unsigned char addressLower = fetch();
+                        unsigned int longAddress = BitUtils::combine(addressUpper, addressLower);
+                        VLOG(1) << "Setting register I to " << longAddress;
+                        Memory::instance().setI(longAddress);
+                    }
+                    break;
+                // SELECT PLANES 0xFN01 - Selects the bit planes N that drawing and clearing affect. (XO-CHIP)
+                case 0x01:
+                    Video::instance().selectPlanes(registerX);
+                    break;
                 // LOAD DELAY TIMER INTO REGISTER 0xFX07 - Loads the value of DT into VX.
                 case 0x07:
                     if(!Memory::instance().setRegister(registerX, Timers::instance().getDelayTimer())) {
@@ -308,7 +412,7 @@ namespace Chip8
                 // WAIT FOR KEY PRESS - Wait for a key press, then store value of key in VX.
                 case 0x0A:
                     {
-                        LOG(INFO) << "Waiting for key press at register " << (int) registerX << std::endl;
+                        VLOG(1) << "Waiting for key press at register " << (int) registerX;
                         InputManager::instance().IsWaitingForKeyPress = true;
                         InputManager::instance().KeyPressRegister = registerX;
                     }
@@ -325,7 +429,7 @@ namespace Chip8
                 case 0x1E:
                     {
                         unsigned int result = Memory::instance().getI() + dataX;
-                        LOG(INFO) << "Setting register I original = " << Memory::instance().getI() << " new = " << result;
+                        VLOG(1) << "Setting register I original = " << Memory::instance().getI() << " new = " << result;
                         Memory::instance().setI(result);
                     }
                     break;
@@ -333,7 +437,7 @@ namespace Chip8
                 case 0x29:
                 {
                     unsigned int fontAddress = Memory::instance().getFontAddress(dataX);
-                    LOG(INFO) << "Font address for " << (int) dataX << " = " << fontAddress;
+                    VLOG(1) << "Font address for " << (int) dataX << " = " << fontAddress;
                     Memory::instance().setI(Memory::instance().getFontAddress(dataX));
                     break;
                 }
@@ -356,7 +460,7 @@ namespace Chip8
                     break;
                 // LOAD REGISTER ARRAY TO MEMORY 0xFX55 - Load registers V0 - VX into memory starting at address I
                 case 0x55:
-                    for(unsigned char i = 0; i < registerX; i++) {
+                    for(unsigned char i = 0; i <= registerX; i++) {
                         unsigned char data = 0;
                         if(!Memory::instance().getRegister(i, data)) {
                             LOG(INFO) << _Tag << "Failed to get data in register " << (int) i;
@@ -368,7 +472,7 @@ namespace Chip8
                     break;
                 // LOAD MEMORY ARRAY INTO REGISTERS 0xFX65 - Load data starting at memory address I into registers V0 - VX.
                 case 0x65:
-                    for(unsigned char i = 0; i < registerX; i++) {
+                    for(unsigned char i = 0; i <= registerX; i++) {
                         unsigned char data = 0;
                         if(!Memory::instance().read(Memory::instance().getI() + i, data)) {
                             LOG(INFO) << _Tag << "Failed to get data from memory address " << Memory::instance().getI() + (unsigned int) i;
@@ -391,13 +495,23 @@ namespace Chip8
 
     void Cpu::jump(unsigned int address)
     {
-        LOG(INFO) << _Tag << "Jump to address " << address;
-        _pc = address;
+        VLOG(1) << _Tag << "Jump to address " << address;
+        _pc = address % Memory::MaxAddress;
+    }
+
+    unsigned int Cpu::getPc() const
+    {
+        return _pc;
     }
 
     void Cpu::call(unsigned int address)
     {
-        LOG(INFO) << _Tag << "Call subroutine at address " << address;
+        VLOG(1) << _Tag << "Call subroutine at address " << address;
+        if(_sp + 1 >= StackSize) {
+            LOG_EVERY_N(INFO, StackErrorLogInterval) << _Tag << "Stack overflow, ignoring call to " << address
+                                                     << " (" << google::COUNTER << " times)";
+            return;
+        }
         _sp++;
         _stack[_sp] = _pc;
         jump(address);
@@ -405,17 +519,28 @@ namespace Chip8
 
     void Cpu::ret()
     {
-        LOG(INFO) << _Tag << "Return from subroutine ";
+        VLOG(1) << _Tag << "Return from subroutine ";
+        if(_sp < 0) {
+            LOG_EVERY_N(INFO, StackErrorLogInterval) << _Tag << "Stack underflow, ignoring return ("
+                                                     << google::COUNTER << " times)";
+            return;
+        }
         jump(_stack[_sp]);
         _sp--;
     }
 
     void Cpu::skipNextInstruction()
     {
-        LOG(INFO) << _Tag << "Skip next instruction";
+        VLOG(1) << _Tag << "Skip next instruction";
         // Fetch next instruction but don't do anything with it.
-        fetch();
-        fetch();
+        unsigned char upper = fetch();
+        unsigned char lower = fetch();
+
+        // XO-CHIP F000 NNNN is 4 bytes long, so skip its address as well.
+        if(upper == 0xF0 && lower == 0x00) {
+            fetch();
+            fetch();
+        }
     }
             
     unsigned char Cpu::add(unsigned char a, unsigned char b) const
@@ -453,9 +578,13 @@ namespace Chip8
         return result & 0xFF;
     }
 
-    unsigned char Cpu::randomByte() const
+    unsigned char Cpu::randomByte()
     {
-        return rand() % 256;
+        // xorshift32
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        return (_random >> 24) & 0xFF;
     }
 
     unsigned int Cpu::extractAddress(unsigned char upper, unsigned char lower)
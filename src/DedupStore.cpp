@@ -0,0 +1,193 @@
+#include <DedupStore.hpp>
+
+#include <glog/logging.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace Chip8
+{
+    const std::string DedupStore::_Tag = "DedupStore:";
+
+    namespace
+    {
+        const Uint8 Magic[4] = {'C', '8', 'D', 'S'};
+        const Uint8 Version = 1;
+
+        // Stands in for hash 0, which marks empty slots.
+        const Uint64 ZeroKey = 0x9E3779B97F4A7C15ULL;
+
+        // Hashes read or written per fread or fwrite.
+        const size_t Batch = 4096;
+    }
+
+    DedupStore::DedupStore(size_t capacity)
+        : _mask(0),
+          _capacity(capacity),
+          _size(0)
+    {
+        size_t slots = 16;
+        while(slots < capacity * 2) {
+            slots *= 2;
+        }
+        _slots.reset(new std::atomic<Uint64>[slots]);
+        _mask = slots - 1;
+        clear();
+    }
+
+    Uint64 DedupStore::key(Uint64 hash)
+    {
+        return hash == 0 ? ZeroKey : hash;
+    }
+
+    bool DedupStore::insert(Uint64 hash)
+    {
+        Uint64 wanted = key(hash);
+        // The hashes are already well mixed, so the low bits pick the slot.
+        for(size_t i = (size_t) wanted & _mask;; i = (i + 1) & _mask) {
+            Uint64 current = _slots[i].load(std::memory_order_acquire);
+            if(current == wanted) {
+                return false;
+            }
+            if(current != 0) {
+                continue;
+            }
+
+            // Reserve room before claiming the slot, so the table never
+            // holds more than capacity and always has empty slots to end
+            // probes on.
+            if(_size.fetch_add(1, std::memory_order_relaxed) >= _capacity) {
+                _size.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            if(_slots[i].compare_exchange_strong(current, wanted, std::memory_order_acq_rel)) {
+                return true;
+            }
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            // Another thread took the slot, maybe for the same hash.
+            if(current == wanted) {
+                return false;
+            }
+        }
+    }
+
+    bool DedupStore::contains(Uint64 hash) const
+    {
+        Uint64 wanted = key(hash);
+        for(size_t i = (size_t) wanted & _mask;; i = (i + 1) & _mask) {
+            Uint64 current = _slots[i].load(std::memory_order_acquire);
+            if(current == wanted) {
+                return true;
+            }
+            if(current == 0) {
+                return false;
+            }
+        }
+    }
+
+    size_t DedupStore::size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    size_t DedupStore::capacity() const
+    {
+        return _capacity;
+    }
+
+    void DedupStore::clear()
+    {
+        for(size_t i = 0; i <= _mask; i++) {
+            _slots[i].store(0, std::memory_order_relaxed);
+        }
+        _size.store(0);
+    }
+
+    bool DedupStore::save(const std::string &path) const
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        if(file == 0) {
+            LOG(INFO) << _Tag << "Failed to create " << path;
+            return false;
+        }
+
+        Uint8 header[sizeof(Magic) + 1 + 8];
+        memcpy(header, Magic, sizeof(Magic));
+        header[4] = Version;
+        Uint64 count = size();
+        for(int i = 0; i < 8; i++) {
+            header[5 + i] = (count >> (i * 8)) & 0xFF;
+        }
+        bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+        // Slots hold keys, which load inserts back unchanged.
+        std::vector<Uint8> buffer;
+        buffer.reserve(Batch * 8);
+        for(size_t i = 0; i <= _mask && ok; i++) {
+            Uint64 value = _slots[i].load(std::memory_order_relaxed);
+            if(value == 0) {
+                continue;
+            }
+            for(int b = 0; b < 8; b++) {
+                buffer.push_back((value >> (b * 8)) & 0xFF);
+            }
+            if(buffer.size() == Batch * 8) {
+                ok = fwrite(&buffer[0], buffer.size(), 1, file) == 1;
+                buffer.clear();
+            }
+        }
+        if(ok && !buffer.empty()) {
+            ok = fwrite(&buffer[0], buffer.size(), 1, file) == 1;
+        }
+        if(fclose(file) != 0 || !ok) {
+            LOG(INFO) << _Tag << "Failed to write " << path;
+            return false;
+        }
+        return true;
+    }
+
+    bool DedupStore::load(const std::string &path)
+    {
+        FILE *file = fopen(path.c_str(), "rb");
+        if(file == 0) {
+            LOG(INFO) << _Tag << "Failed to open " << path;
+            return false;
+        }
+
+        Uint8 header[sizeof(Magic) + 1 + 8];
+        if(fread(header, sizeof(header), 1, file) != 1 || memcmp(header, Magic, sizeof(Magic)) != 0 || header[4] != Version) {
+            LOG(INFO) << _Tag << path << " is not a version " << (int) Version << " store";
+            fclose(file);
+            return false;
+        }
+        Uint64 count = 0;
+        for(int i = 0; i < 8; i++) {
+            count |= (Uint64) header[5 + i] << (i * 8);
+        }
+
+        std::vector<Uint8> buffer(Batch * 8);
+        Uint64 loaded = 0;
+        while(loaded < count) {
+            size_t hashes = count - loaded < Batch ? (size_t) (count - loaded) : Batch;
+            if(fread(&buffer[0], hashes * 8, 1, file) != 1) {
+                LOG(INFO) << _Tag << path << " is truncated";
+                fclose(file);
+                return false;
+            }
+            for(size_t i = 0; i < hashes; i++) {
+                Uint64 value = 0;
+                for(int b = 0; b < 8; b++) {
+                    value |= (Uint64) buffer[i * 8 + b] << (b * 8);
+                }
+                insert(value);
+            }
+            loaded += hashes;
+        }
+        fclose(file);
+        if(size() >= _capacity) {
+            LOG(INFO) << _Tag << path << " filled the store, " << count << " hashes for " << _capacity << " slots";
+        }
+        return true;
+    }
+}
@@ -14,20 +14,15 @@ namespace Chip8
         if(file.is_open()){
             // Find the length of the file.
             file.seekg(0, file.end);
-            int length = file.tellg();
+            std::streamoff length = file.tellg();
             file.seekg(0, file.beg);
 
-            // Store the file into a buffer. 
-            char *buffer = new char[length];
-            file.read(buffer, length);
-
-            // Put the file in our vector.
-            for(int i = 0; i < length; i++){
-                data.push_back(buffer[i]);
+            // Read the file straight into the vector.
+            if(length > 0) {
+                data.resize((size_t) length);
+                file.read(reinterpret_cast<char *>(&data[0]), length);
+                data.resize((size_t) file.gcount());
             }
-
-            // Clean up.
-            delete[] buffer;
             file.close();
         }
         return data;
@@ -0,0 +1,91 @@
+#include <FrameCodec.hpp>
+
+namespace Chip8
+{
+    const unsigned int FrameCodec::FrameBytes = 2 * 32 * 8;
+
+    namespace
+    {
+        const unsigned int MaxRun = 0x80;
+        const Uint8 LiteralToken = 0x80;
+
+        // Lays out the XOR of screen and base as FrameBytes bytes.
+        void difference(const Uint64 screen[2][32], const Uint64 base[2][32], Uint8 *bytes)
+        {
+            for(int p = 0; p < 2; p++) {
+                for(int y = 0; y < 32; y++) {
+                    Uint64 row = screen[p][y] ^ (base != 0 ? base[p][y] : 0);
+                    for(int i = 0; i < 8; i++) {
+                        *bytes++ = (Uint8) (row >> (56 - i * 8));
+                    }
+                }
+            }
+        }
+    }
+
+    void FrameCodec::encode(const Uint64 screen[2][32], const Uint64 base[2][32], std::vector<Uint8> &out)
+    {
+        Uint8 bytes[2 * 32 * 8];
+        difference(screen, base, bytes);
+        unsigned int end = FrameBytes;
+        while(end > 0 && bytes[end - 1] == 0) {
+            end--;
+        }
+
+        unsigned int i = 0;
+        while(i < end) {
+            unsigned int start = i;
+            if(bytes[i] == 0) {
+                while(i < end && bytes[i] == 0 && i - start < MaxRun) {
+                    i++;
+                }
+                out.push_back((Uint8) (i - start - 1));
+                continue;
+            }
+            // A lone zero between changed bytes stays in the literal, since
+            // ending the literal there would cost two tokens instead of one
+            // byte.
+            while(i < end && i - start < MaxRun && (bytes[i] != 0 || bytes[i + 1] != 0)) {
+                i++;
+            }
+            out.push_back((Uint8) (LiteralToken + i - start - 1));
+            out.insert(out.end(), bytes + start, bytes + i);
+        }
+    }
+
+    bool FrameCodec::decode(const Uint8 *data, size_t size, const Uint64 base[2][32], Uint64 screen[2][32])
+    {
+        Uint8 bytes[2 * 32 * 8] = {0};
+        unsigned int at = 0;
+        size_t i = 0;
+        while(i < size) {
+            Uint8 token = data[i++];
+            unsigned int count = (token & (LiteralToken - 1)) + 1;
+            if(at + count > FrameBytes) {
+                return false;
+            }
+            if(token & LiteralToken) {
+                if(i + count > size) {
+                    return false;
+                }
+                for(unsigned int j = 0; j < count; j++) {
+                    bytes[at + j] = data[i + j];
+                }
+                i += count;
+            }
+            at += count;
+        }
+
+        const Uint8 *byte = bytes;
+        for(int p = 0; p < 2; p++) {
+            for(int y = 0; y < 32; y++) {
+                Uint64 row = 0;
+                for(int b = 0; b < 8; b++) {
+                    row = row << 8 | *byte++;
+                }
+                screen[p][y] = row ^ (base != 0 ? base[p][y] : 0);
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,136 @@
+#include <FramePacer.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace Chip8
+{
+    const std::chrono::microseconds FramePacer::SpinMargin(500);
+
+    const std::string FramePacer::_Tag = "FramePacer:";
+
+    namespace
+    {
+        // 10 seconds at 60Hz.
+        const size_t StatsWindow = 600;
+
+        // Falling this many periods behind restarts the schedule.
+        const int MaxLatePeriods = 4;
+
+        double toMs(std::chrono::steady_clock::duration d)
+        {
+            return std::chrono::duration<double, std::milli>(d).count();
+        }
+    }
+
+    FramePacer::FramePacer(double hz)
+        : _period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz))),
+          _lastFrameMs(0.0),
+          _lastFrameLate(false),
+          _started(false),
+          _frameTimes(StatsWindow, 0.0),
+          _sorted(StatsWindow, 0.0),
+          _frames(0),
+          _maxOverrunMs(0.0),
+          _late(0)
+    {
+    }
+
+    void FramePacer::reset()
+    {
+        _lastFrame = Clock::now();
+        _deadline = _lastFrame + _period;
+        _started = true;
+    }
+
+    void FramePacer::wait()
+    {
+        if(!_started) {
+            reset();
+        }
+
+        Clock::time_point now = Clock::now();
+        if(_deadline - now > SpinMargin) {
+            std::this_thread::sleep_for(_deadline - now - SpinMargin);
+        }
+        while((now = Clock::now()) < _deadline) {
+            // Spin out the last fraction of a millisecond.
+        }
+
+        Clock::duration overrun = now - _deadline;
+        double overrunMs = toMs(overrun);
+        if(overrunMs > _maxOverrunMs) {
+            _maxOverrunMs = overrunMs;
+        }
+        _lastFrameLate = overrun > _period;
+        if(_lastFrameLate) {
+            _late++;
+        }
+
+        _lastFrameMs = toMs(now - _lastFrame);
+        _frameTimes[_frames % StatsWindow] = _lastFrameMs;
+        _frames++;
+        _lastFrame = now;
+
+        if(overrun > _period * MaxLatePeriods) {
+            LOG(INFO) << _Tag << "Fell " << overrunMs << "ms behind, restarting schedule";
+            _deadline = now + _period;
+        } else {
+            _deadline += _period;
+        }
+    }
+
+    Uint64 FramePacer::frames() const
+    {
+        return _frames;
+    }
+
+    double FramePacer::lastFrameMs() const
+    {
+        return _lastFrameMs;
+    }
+
+    bool FramePacer::lastFrameLate() const
+    {
+        return _lastFrameLate;
+    }
+
+    FramePacer::Stats FramePacer::stats() const
+    {
+        Stats stats;
+        stats.frames = _frames;
+        stats.meanMs = 0.0;
+        stats.p99Ms = 0.0;
+        stats.maxOverrunMs = _maxOverrunMs;
+        stats.late = _late;
+
+        size_t count = _frames < StatsWindow ? (size_t) _frames : StatsWindow;
+        if(count == 0) {
+            return stats;
+        }
+
+        double sum = 0.0;
+        for(size_t i = 0; i < count; i++) {
+            sum += _frameTimes[i];
+            _sorted[i] = _frameTimes[i];
+        }
+        stats.meanMs = sum / count;
+
+        size_t p99 = (count * 99) / 100;
+        if(p99 >= count) {
+            p99 = count - 1;
+        }
+        std::nth_element(_sorted.begin(), _sorted.begin() + p99, _sorted.begin() + count);
+        stats.p99Ms = _sorted[p99];
+        return stats;
+    }
+
+    void FramePacer::resetStats()
+    {
+        _frames = 0;
+        _maxOverrunMs = 0.0;
+        _late = 0;
+    }
+}
@@ -0,0 +1,622 @@
+#include <GdbStub.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+    const std::string GdbStub::_Tag = "GdbStub:";
+
+    namespace
+    {
+        const int SigInt = 2;
+        const int SigTrap = 5;
+
+        // Register numbers, in g packet order.
+        const unsigned int FirstV = 0;
+        const unsigned int RegisterI = 16;
+        const unsigned int RegisterPc = 17;
+        const unsigned int RegisterSp = 18;
+        const unsigned int FirstStack = 19;
+        const unsigned int RegisterCount = 35;
+
+        // Largest packet the debugger may send, advertised in qSupported.
+        const size_t PacketSize = 0x1000;
+
+        const char TargetXml[] =
+            "<?xml version=\"1.0\"?>"
+            "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+            "<target version=\"1.0\">"
+            "<feature name=\"org.chip8.core\">"
+            "<reg name=\"v0\" bitsize=\"8\"/><reg name=\"v1\" bitsize=\"8\"/>"
+            "<reg name=\"v2\" bitsize=\"8\"/><reg name=\"v3\" bitsize=\"8\"/>"
+            "<reg name=\"v4\" bitsize=\"8\"/><reg name=\"v5\" bitsize=\"8\"/>"
+            "<reg name=\"v6\" bitsize=\"8\"/><reg name=\"v7\" bitsize=\"8\"/>"
+            "<reg name=\"v8\" bitsize=\"8\"/><reg name=\"v9\" bitsize=\"8\"/>"
+            "<reg name=\"va\" bitsize=\"8\"/><reg name=\"vb\" bitsize=\"8\"/>"
+            "<reg name=\"vc\" bitsize=\"8\"/><reg name=\"vd\" bitsize=\"8\"/>"
+            "<reg name=\"ve\" bitsize=\"8\"/><reg name=\"vf\" bitsize=\"8\"/>"
+            "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+            "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+            "<reg name=\"sp\" bitsize=\"8\"/>"
+            "<reg name=\"s0\" bitsize=\"16\"/><reg name=\"s1\" bitsize=\"16\"/>"
+            "<reg name=\"s2\" bitsize=\"16\"/><reg name=\"s3\" bitsize=\"16\"/>"
+            "<reg name=\"s4\" bitsize=\"16\"/><reg name=\"s5\" bitsize=\"16\"/>"
+            "<reg name=\"s6\" bitsize=\"16\"/><reg name=\"s7\" bitsize=\"16\"/>"
+            "<reg name=\"s8\" bitsize=\"16\"/><reg name=\"s9\" bitsize=\"16\"/>"
+            "<reg name=\"s10\" bitsize=\"16\"/><reg name=\"s11\" bitsize=\"16\"/>"
+            "<reg name=\"s12\" bitsize=\"16\"/><reg name=\"s13\" bitsize=\"16\"/>"
+            "<reg name=\"s14\" bitsize=\"16\"/><reg name=\"s15\" bitsize=\"16\"/>"
+            "</feature>"
+            "</target>";
+
+        const char HexDigits[] = "0123456789abcdef";
+
+        // Appends value as bytes little endian hex digits.
+        void appendHex(std::string &out, unsigned int value, int bytes)
+        {
+            for(int i = 0; i < bytes; i++) {
+                unsigned int byte = (value >> (i * 8)) & 0xFF;
+                out += HexDigits[byte >> 4];
+                out += HexDigits[byte & 0xF];
+            }
+        }
+
+        int hexValue(char c)
+        {
+            if(c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if(c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if(c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        // Reads bytes little endian hex digits from hex at offset.
+        bool parseHex(const std::string &hex, size_t offset, int bytes, unsigned int &value)
+        {
+            if(offset + bytes * 2 > hex.size()) {
+                return false;
+            }
+            value = 0;
+            for(int i = 0; i < bytes; i++) {
+                int high = hexValue(hex[offset + i * 2]);
+                int low = hexValue(hex[offset + i * 2 + 1]);
+                if(high < 0 || low < 0) {
+                    return false;
+                }
+                value |= (unsigned int) (high << 4 | low) << (i * 8);
+            }
+            return true;
+        }
+
+        // Parses a big endian hex number, as addresses and lengths are sent.
+        bool parseNumber(const std::string &text, unsigned int &value)
+        {
+            if(text.empty() || text.size() > 8) {
+                return false;
+            }
+            value = 0;
+            for(size_t i = 0; i < text.size(); i++) {
+                int digit = hexValue(text[i]);
+                if(digit < 0) {
+                    return false;
+                }
+                value = value << 4 | digit;
+            }
+            return true;
+        }
+
+        // Sets or clears the bit for address, returns true if it changed.
+        bool setBit(std::vector<Uint8> &bitmap, unsigned int address, bool set)
+        {
+            Uint8 bit = (Uint8) (1 << (address & 7));
+            Uint8 &byte = bitmap[address >> 3];
+            if(((byte & bit) != 0) == set) {
+                return false;
+            }
+            byte ^= bit;
+            return true;
+        }
+    }
+
+    GdbStub::GdbStub()
+        : _listener(-1),
+          _connection(-1),
+          _halted(false),
+          _signal(SigTrap),
+          _breakpoints(Memory::MaxAddress / 8, 0),
+          _watchpoints(Memory::MaxAddress / 8, 0),
+          _breakpointCount(0),
+          _watchpointCount(0)
+    {
+    }
+
+    GdbStub::~GdbStub()
+    {
+        close();
+    }
+
+    bool GdbStub::open(int port)
+    {
+        if(isOpen()) {
+            LOG(INFO) << _Tag << "Already listening";
+            return false;
+        }
+        _listener = socket(AF_INET, SOCK_STREAM, 0);
+        if(_listener < 0) {
+            LOG(INFO) << _Tag << "Failed to create socket - " << strerror(errno);
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        fcntl(_listener, F_SETFL, fcntl(_listener, F_GETFL, 0) | O_NONBLOCK);
+
+        // A debugger can write anywhere in the machine, so only local
+        // connections are accepted.
+        sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        local.sin_port = htons(port);
+        if(bind(_listener, (const sockaddr *) &local, sizeof(local)) < 0 || listen(_listener, 1) < 0) {
+            LOG(INFO) << _Tag << "Failed to listen on port " << port << " - " << strerror(errno);
+            ::close(_listener);
+            _listener = -1;
+            return false;
+        }
+        LOG(INFO) << _Tag << "Waiting for a debugger on 127.0.0.1:" << port;
+        return true;
+    }
+
+    void GdbStub::close()
+    {
+        if(_connection >= 0) {
+            ::close(_connection);
+            _connection = -1;
+        }
+        if(_listener >= 0) {
+            ::close(_listener);
+            _listener = -1;
+        }
+    }
+
+    bool GdbStub::isOpen() const
+    {
+        return _listener >= 0;
+    }
+
+    bool GdbStub::poll(Machine &machine)
+    {
+        if(!isOpen()) {
+            return true;
+        }
+        if(_connection < 0) {
+            _connection = accept(_listener, 0, 0);
+            if(_connection < 0) {
+                return true;
+            }
+            fcntl(_connection, F_SETFL, fcntl(_connection, F_GETFL, 0) | O_NONBLOCK);
+            int noDelay = 1;
+            setsockopt(_connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            _input.clear();
+
+            // A debugger expects the target to be stopped when it attaches.
+            _halted = true;
+            _signal = SigTrap;
+            LOG(INFO) << _Tag << "Debugger attached";
+        }
+        receive(machine);
+        return !_halted;
+    }
+
+    void GdbStub::check(Machine &machine)
+    {
+        if(_connection >= 0 && !_halted && machine.lastTrap() != Machine::NoTrap) {
+            stop(machine, SigTrap);
+        }
+    }
+
+    void GdbStub::receive(Machine &machine)
+    {
+        char buffer[PacketSize];
+        for(;;) {
+            ssize_t size = recv(_connection, buffer, sizeof(buffer), 0);
+            if(size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                LOG(INFO) << _Tag << "Debugger disconnected";
+                disconnect(machine);
+                return;
+            }
+            if(size < 0) {
+                break;
+            }
+            _input.append(buffer, size);
+        }
+
+        while(!_input.empty() && _connection >= 0) {
+            char first = _input[0];
+            if(first == '\x03') {
+                // Ctrl-C from the debugger.
+                _input.erase(0, 1);
+                if(!_halted) {
+                    stop(machine, SigInt);
+                }
+                continue;
+            }
+            if(first != '$') {
+                // Acks and line noise.
+                _input.erase(0, 1);
+                continue;
+            }
+            size_t end = _input.find('#');
+            if(end == std::string::npos || end + 2 >= _input.size()) {
+                if(_input.size() > PacketSize * 2) {
+                    _input.clear();
+                }
+                break;
+            }
+            std::string packet = _input.substr(1, end - 1);
+            unsigned int checksum = 0;
+            bool valid = parseNumber(_input.substr(end + 1, 2), checksum);
+            _input.erase(0, end + 3);
+
+            Uint8 sum = 0;
+            for(size_t i = 0; i < packet.size(); i++) {
+                sum += (Uint8) packet[i];
+            }
+            if(!valid || sum != checksum) {
+                ::send(_connection, "-", 1, MSG_NOSIGNAL);
+                continue;
+            }
+            ::send(_connection, "+", 1, MSG_NOSIGNAL);
+            handle(machine, packet);
+        }
+    }
+
+    void GdbStub::handle(Machine &machine, const std::string &packet)
+    {
+        char command = packet.empty() ? 0 : packet[0];
+        std::string args = packet.size() > 1 ? packet.substr(1) : "";
+        switch(command) {
+            case '?':
+                send(stopReply(machine));
+                break;
+            case 'g':
+                send(readRegisters(machine));
+                break;
+            case 'G':
+                send(writeRegisters(machine, args) ? "OK" : "E01");
+                break;
+            case 'p':
+                {
+                    unsigned int reg = 0;
+                    send(parseNumber(args, reg) && reg < RegisterCount ? readRegister(machine, reg) : "E01");
+                }
+                break;
+            case 'P':
+                {
+                    size_t equals = args.find('=');
+                    unsigned int reg = 0;
+                    bool ok = equals != std::string::npos && parseNumber(args.substr(0, equals), reg)
+                              && writeRegister(machine, reg, args.substr(equals + 1));
+                    send(ok ? "OK" : "E01");
+                }
+                break;
+            case 'm':
+                send(readMemory(machine, args));
+                break;
+            case 'M':
+                send(writeMemory(machine, args) ? "OK" : "E01");
+                break;
+            case 'c':
+                // Continuing from an address is not supported, only from the PC.
+                _halted = false;
+                break;
+            case 's':
+                machine.stepInstruction();
+                _halted = true;
+                _signal = SigTrap;
+                send(stopReply(machine));
+                break;
+            case 'Z':
+            case 'z':
+                send(setTrap(args, command == 'Z') ? "OK" : "");
+                arm(machine);
+                break;
+            case 'H':
+            case 'T':
+                send("OK");
+                break;
+            case 'D':
+                send("OK");
+                disconnect(machine);
+                break;
+            case 'k':
+                disconnect(machine);
+                break;
+            case 'q':
+                if(args.compare(0, 9, "Supported") == 0) {
+                    char reply[64];
+                    snprintf(reply, sizeof(reply), "PacketSize=%x;qXfer:features:read+", (unsigned int) PacketSize);
+                    send(reply);
+                } else if(args == "Attached") {
+                    send("1");
+                } else if(args == "C") {
+                    send("QC1");
+                } else if(args == "fThreadInfo") {
+                    send("m1");
+                } else if(args == "sThreadInfo") {
+                    send("l");
+                } else if(args.compare(0, 30, "Xfer:features:read:target.xml:") == 0) {
+                    // qXfer:features:read:target.xml:OFFSET,LENGTH
+                    std::string range = args.substr(30);
+                    size_t comma = range.find(',');
+                    unsigned int offset = 0;
+                    unsigned int length = 0;
+                    std::string xml = TargetXml;
+                    if(comma == std::string::npos || !parseNumber(range.substr(0, comma), offset)
+                       || !parseNumber(range.substr(comma + 1), length)) {
+                        send("E01");
+                    } else if(offset >= xml.size()) {
+                        send("l");
+                    } else {
+                        std::string part = xml.substr(offset, length);
+                        send((offset + part.size() >= xml.size() ? "l" : "m") + part);
+                    }
+                } else {
+                    send("");
+                }
+                break;
+            default:
+                // An empty reply tells the debugger the packet isn't supported.
+                send("");
+                break;
+        }
+    }
+
+    void GdbStub::send(const std::string &payload)
+    {
+        if(_connection < 0) {
+            return;
+        }
+        Uint8 sum = 0;
+        for(size_t i = 0; i < payload.size(); i++) {
+            sum += (Uint8) payload[i];
+        }
+        std::string packet = "$" + payload + "#";
+        appendHex(packet, sum, 1);
+
+        // Replies are small, so the socket buffer practically always takes
+        // them whole. If it doesn't, wait rather than drop half a packet.
+        size_t sent = 0;
+        while(sent < packet.size()) {
+            ssize_t size = ::send(_connection, packet.data() + sent, packet.size() - sent, MSG_NOSIGNAL);
+            if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+            if(size <= 0) {
+                return;
+            }
+            sent += size;
+        }
+    }
+
+    void GdbStub::stop(Machine &machine, int signal)
+    {
+        _halted = true;
+        _signal = signal;
+        send(stopReply(machine));
+    }
+
+    std::string GdbStub::stopReply(Machine &machine) const
+    {
+        std::string reply = "T";
+        appendHex(reply, _signal, 1);
+        if(_signal == SigTrap && machine.lastTrap() == Machine::Watchpoint) {
+            char watch[32];
+            snprintf(watch, sizeof(watch), "watch:%x;", machine.trapAddress());
+            reply += watch;
+        } else if(_signal == SigTrap && machine.lastTrap() == Machine::Breakpoint) {
+            reply += "swbreak:;";
+        }
+        return reply;
+    }
+
+    std::string GdbStub::readRegisters(Machine &machine) const
+    {
+        std::string out;
+        for(unsigned int reg = 0; reg < RegisterCount; reg++) {
+            out += readRegister(machine, reg);
+        }
+        return out;
+    }
+
+    bool GdbStub::writeRegisters(Machine &machine, const std::string &hex)
+    {
+        size_t offset = 0;
+        for(unsigned int reg = 0; reg < RegisterCount; reg++) {
+            int bytes = reg == RegisterI || reg == RegisterPc || reg >= FirstStack ? 2 : 1;
+            if(!writeRegister(machine, reg, hex.substr(offset, bytes * 2))) {
+                return false;
+            }
+            offset += bytes * 2;
+        }
+        return true;
+    }
+
+    std::string GdbStub::readRegister(Machine &machine, unsigned int reg) const
+    {
+        std::string out;
+        Cpu::State cpu;
+        machine.cpu().saveState(cpu);
+        if(reg < RegisterI) {
+            unsigned char data = 0;
+            machine.memory().getRegister(FirstV + reg, data);
+            appendHex(out, data, 1);
+        } else if(reg == RegisterI) {
+            appendHex(out, machine.memory().getI(), 2);
+        } else if(reg == RegisterPc) {
+            appendHex(out, cpu.pc, 2);
+        } else if(reg == RegisterSp) {
+            appendHex(out, (unsigned int) cpu.sp & 0xFF, 1);
+        } else {
+            appendHex(out, cpu.stack[reg - FirstStack], 2);
+        }
+        return out;
+    }
+
+    bool GdbStub::writeRegister(Machine &machine, unsigned int reg, const std::string &hex)
+    {
+        if(reg >= RegisterCount) {
+            return false;
+        }
+        int bytes = reg == RegisterI || reg == RegisterPc || reg >= FirstStack ? 2 : 1;
+        unsigned int value = 0;
+        if(hex.size() != (size_t) bytes * 2 || !parseHex(hex, 0, bytes, value)) {
+            return false;
+        }
+
+        if(reg < RegisterI) {
+            return machine.memory().setRegister(FirstV + reg, (unsigned char) value);
+        }
+        if(reg == RegisterI) {
+            machine.memory().setI(value);
+            return true;
+        }
+        Cpu::State cpu;
+        machine.cpu().saveState(cpu);
+        if(reg == RegisterPc) {
+            cpu.pc = (int) value;
+        } else if(reg == RegisterSp) {
+            // 0xFF is the empty stack, anything else must be a valid entry.
+            int sp = value == 0xFF ? -1 : (int) value;
+            if(sp >= 16) {
+                return false;
+            }
+            cpu.sp = sp;
+        } else {
+            cpu.stack[reg - FirstStack] = value;
+        }
+        machine.cpu().loadState(cpu);
+        return true;
+    }
+
+    std::string GdbStub::readMemory(Machine &machine, const std::string &args) const
+    {
+        size_t comma = args.find(',');
+        unsigned int address = 0;
+        unsigned int length = 0;
+        if(comma == std::string::npos || !parseNumber(args.substr(0, comma), address)
+           || !parseNumber(args.substr(comma + 1), length) || length > PacketSize / 2) {
+            return "E01";
+        }
+        std::string out;
+        for(unsigned int i = 0; i < length; i++) {
+            unsigned char byte = 0;
+            if(!machine.memory().read(address + i, byte)) {
+                // A partial read is allowed, an empty one is an error.
+                return i == 0 ? "E14" : out;
+            }
+            appendHex(out, byte, 1);
+        }
+        return out;
+    }
+
+    bool GdbStub::writeMemory(Machine &machine, const std::string &args)
+    {
+        size_t comma = args.find(',');
+        size_t colon = args.find(':');
+        unsigned int address = 0;
+        unsigned int length = 0;
+        if(comma == std::string::npos || colon == std::string::npos || colon < comma
+           || !parseNumber(args.substr(0, comma), address) || !parseNumber(args.substr(comma + 1, colon - comma - 1), length)) {
+            return false;
+        }
+        std::string data = args.substr(colon + 1);
+        if(data.size() != (size_t) length * 2 || address + length > Memory::MaxAddress) {
+            return false;
+        }
+        // Writes from the debugger don't trip its own watchpoints.
+        unsigned int ignored = 0;
+        for(unsigned int i = 0; i < length; i++) {
+            unsigned int byte = 0;
+            if(!parseHex(data, i * 2, 1, byte)) {
+                return false;
+            }
+            machine.memory().write(address + i, (unsigned char) byte);
+        }
+        machine.memory().takeWatchHit(ignored);
+        return true;
+    }
+
+    bool GdbStub::setTrap(const std::string &args, bool insert)
+    {
+        // TYPE,ADDR,KIND where KIND is the length for watchpoints.
+        size_t first = args.find(',');
+        size_t second = first == std::string::npos ? std::string::npos : args.find(',', first + 1);
+        unsigned int address = 0;
+        unsigned int kind = 0;
+        if(second == std::string::npos || !parseNumber(args.substr(first + 1, second - first - 1), address)
+           || !parseNumber(args.substr(second + 1, args.find(';', second) - second - 1), kind)
+           || address >= Memory::MaxAddress) {
+            return false;
+        }
+
+        std::string type = args.substr(0, first);
+        if(type == "0" || type == "1") {
+            // Software and hardware breakpoints are the same bitmap, memory
+            // is never patched.
+            if(setBit(_breakpoints, address, insert)) {
+                _breakpointCount += insert ? 1 : -1;
+            }
+            return true;
+        }
+        if(type == "2") {
+            for(unsigned int i = 0; i < kind && address + i < Memory::MaxAddress; i++) {
+                if(setBit(_watchpoints, address + i, insert)) {
+                    _watchpointCount += insert ? 1 : -1;
+                }
+            }
+            return true;
+        }
+        // Read and access watchpoints would need a check on every read,
+        // instruction fetches included.
+        return false;
+    }
+
+    void GdbStub::arm(Machine &machine)
+    {
+        machine.setBreakpoints(_breakpointCount > 0 ? &_breakpoints[0] : 0);
+        machine.setWatchpoints(_watchpointCount > 0 ? &_watchpoints[0] : 0);
+    }
+
+    void GdbStub::disconnect(Machine &machine)
+    {
+        if(_connection >= 0) {
+            ::close(_connection);
+            _connection = -1;
+        }
+        _input.clear();
+        std::fill(_breakpoints.begin(), _breakpoints.end(), 0);
+        std::fill(_watchpoints.begin(), _watchpoints.end(), 0);
+        _breakpointCount = 0;
+        _watchpointCount = 0;
+        arm(machine);
+        _halted = false;
+    }
+}
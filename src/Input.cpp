@@ -1,4 +1,5 @@
 #include <Input.hpp>
+#include <Machine.hpp>
 
 #include <SDL_keyboard.h>
 #include <SDL_events.h>
@@ -25,19 +26,60 @@ namespace Chip8
     const SDL_Scancode InputManager::Keys[] = {Key0, Key1, Key2, Key3, Key4, Key5, Key6,
                                                Key7, Key8, Key9, KeyA, KeyB, KeyC, KeyD,
                                                KeyE, KeyF};
-    bool InputManager::IsWaitingForKeyPress = false;
-    unsigned char InputManager::KeyPressRegister = 0x0;
     const std::string InputManager::_Tag = "InputManager:";
 
     InputManager::InputManager()
+        : IsWaitingForKeyPress(false),
+          KeyPressRegister(0x0),
+          _keys(0)
     {
 
     }
             
     InputManager & InputManager::instance()
     {
-        static InputManager instance;
-        return instance;
+        return Machine::current().input();
+    }
+
+    void InputManager::saveState(State &state) const
+    {
+        state.keys = _keys;
+        state.isWaitingForKeyPress = IsWaitingForKeyPress;
+        state.keyPressRegister = KeyPressRegister;
+    }
+
+    void InputManager::loadState(const State &state)
+    {
+        _keys = state.keys;
+        IsWaitingForKeyPress = state.isWaitingForKeyPress;
+        KeyPressRegister = state.keyPressRegister;
+    }
+
+    void InputManager::setKeys(Uint16 keys)
+    {
+        _keys = keys;
+    }
+
+    Uint16 InputManager::getKeys() const
+    {
+        return _keys;
+    }
+
+    bool InputManager::isHexKeyDown(unsigned char hex) const
+    {
+        return hex <= 0xF && (_keys & (1 << hex)) != 0;
+    }
+
+    Uint16 InputManager::readKeyboard()
+    {
+        const Uint8 *state = SDL_GetKeyboardState(NULL);
+        Uint16 keys = 0;
+        for(int hex = 0; hex <= 0xF; hex++) {
+            if(state[Keys[hex]] == 1) {
+                keys |= 1 << hex;
+            }
+        }
+        return keys;
     }
 
     bool InputManager::isKeyDown(SDL_Scancode key) const
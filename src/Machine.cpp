@@ -0,0 +1,324 @@
+#include <Machine.hpp>
+#include <Fonts.hpp>
+#include <BitUtils.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <string.h>
+#include <type_traits>
+
+namespace Chip8
+{
+    const std::string Machine::_Tag = "Machine:";
+
+    static_assert(std::is_trivially_copyable<Machine::State>::value, "Machine::State must stay plain data");
+
+    namespace
+    {
+        thread_local Machine *boundMachine = 0;
+    }
+
+    Machine::Scope::Scope(Machine &machine)
+        : _previous(boundMachine)
+    {
+        boundMachine = &machine;
+    }
+
+    Machine::Scope::~Scope()
+    {
+        boundMachine = _previous;
+    }
+
+    Machine::Machine()
+        : _cyclesPerFrame(1),
+          _cycle(0),
+          _breakpoints(0),
+          _bootHash(0),
+          _romSpan(0),
+          _trap(NoTrap),
+          _trapAddress(0)
+    {
+    }
+
+    Machine & Machine::current()
+    {
+        if(boundMachine != 0) {
+            return *boundMachine;
+        }
+        return defaultMachine();
+    }
+
+    Machine & Machine::defaultMachine()
+    {
+        static Machine machine;
+        return machine;
+    }
+
+    Memory & Machine::memory()
+    {
+        return _memory;
+    }
+
+    Cpu & Machine::cpu()
+    {
+        return _cpu;
+    }
+
+    Timers & Machine::timers()
+    {
+        return _timers;
+    }
+
+    Video & Machine::video()
+    {
+        return _video;
+    }
+
+    InputManager & Machine::input()
+    {
+        return _input;
+    }
+
+    void Machine::loadFonts()
+    {
+        // The sprites are stored in font address order.
+        _memory.load(_memory.getFontAddress(0), Fonts::Sprites, Fonts::SpritesSize);
+    }
+
+    bool Machine::loadRom(const std::vector<unsigned char> &rom)
+    {
+        if(rom.size() > Memory::MaxAddress - Memory::StartAddress) {
+            LOG(INFO) << _Tag << "Rom of " << rom.size() << " bytes doesn't fit in memory";
+            return false;
+        }
+        if(!rom.empty()) {
+            _memory.load(Memory::StartAddress, &rom[0], rom.size());
+        }
+        _romSpan = std::max(_romSpan, rom.size());
+        LOG(INFO) << _Tag << "Loaded " << rom.size() << " byte rom";
+        return true;
+    }
+
+    bool Machine::reset(const std::vector<unsigned char> &rom)
+    {
+        if(rom.size() > Memory::MaxAddress - Memory::StartAddress) {
+            LOG(INFO) << _Tag << "Rom of " << rom.size() << " bytes doesn't fit in memory";
+            return false;
+        }
+        // Batch runs reset constantly, usually with the same rom, so this
+        // doesn't log like loadRom and keeps the hash of the last rom rather
+        // than working it out again.
+        static const Uint64 fontsHash = Memory::hashBlock(_memory.getFontAddress(0), Fonts::Sprites, Fonts::SpritesSize);
+        if(rom != _bootRom) {
+            _bootRom = rom;
+            _bootHash = rom.empty() ? 0 : Memory::hashBlock(Memory::StartAddress, &rom[0], rom.size());
+        }
+        _memory.clear();
+        _memory.load(_memory.getFontAddress(0), Fonts::Sprites, Fonts::SpritesSize, fontsHash);
+        if(!rom.empty()) {
+            _memory.load(Memory::StartAddress, &rom[0], rom.size(), _bootHash);
+        }
+        _romSpan = std::max(_romSpan, rom.size());
+
+        Cpu::State cpu;
+        _cpu.saveState(cpu);
+        cpu.pc = Memory::StartAddress;
+        cpu.sp = -1;
+        memset(cpu.stack, 0, sizeof(cpu.stack));
+        _cpu.loadState(cpu);
+
+        Timers::State timers = Timers::State();
+        _timers.loadState(timers);
+        Video::State video = Video::State();
+        video.planeMask = 0x1;
+        _video.loadState(video);
+        InputManager::State input = InputManager::State();
+        _input.loadState(input);
+
+        _cycle = 0;
+        _trap = NoTrap;
+        return true;
+    }
+
+    bool Machine::reloadRom(const std::vector<unsigned char> &rom)
+    {
+        if(rom.size() > Memory::MaxAddress - Memory::StartAddress) {
+            LOG(INFO) << _Tag << "Rom of " << rom.size() << " bytes doesn't fit in memory";
+            return false;
+        }
+        // Whatever an older rom had past the end of the new one would still
+        // run as code, so it is zeroed in the same copy. Memory restored
+        // from a state can hold any rom loaded before, not just the last.
+        std::vector<unsigned char> block(rom);
+        _romSpan = std::max(_romSpan, rom.size());
+        block.resize(_romSpan, 0);
+        if(!block.empty()) {
+            _memory.load(Memory::StartAddress, &block[0], (unsigned int) block.size());
+        }
+        _bootRom = rom;
+        _bootHash = rom.empty() ? 0 : Memory::hashBlock(Memory::StartAddress, &rom[0], rom.size());
+        LOG(INFO) << _Tag << "Reloaded " << rom.size() << " byte rom";
+        return true;
+    }
+
+    void Machine::stepFrame()
+    {
+        Scope scope(*this);
+        _trap = NoTrap;
+        // The timers keep counting down while FX0A waits, like the 60Hz
+        // interrupt that drives them on the COSMAC VIP.
+        if(_input.IsWaitingForKeyPress) {
+            _timers.step();
+            return;
+        }
+        if(_breakpoints == 0 && !_memory.isWatching()) {
+            for(; _cycle < _cyclesPerFrame && !_input.IsWaitingForKeyPress; _cycle++) {
+                _cpu.step();
+            }
+        } else {
+            // Only a debugger pays for checking between instructions.
+            while(_cycle < _cyclesPerFrame && !_input.IsWaitingForKeyPress) {
+                unsigned int pc = _cpu.getPc();
+                if(_breakpoints != 0 && (_breakpoints[pc >> 3] >> (pc & 7)) & 0x1) {
+                    _trap = Breakpoint;
+                    _trapAddress = pc;
+                    return;
+                }
+                _cpu.step();
+                _cycle++;
+                if(_memory.takeWatchHit(_trapAddress)) {
+                    _trap = Watchpoint;
+                    return;
+                }
+            }
+        }
+        _timers.step();
+        _cycle = 0;
+    }
+
+    void Machine::stepInstruction()
+    {
+        Scope scope(*this);
+        _trap = NoTrap;
+        if(_input.IsWaitingForKeyPress) {
+            return;
+        }
+        _cpu.step();
+        _cycle++;
+        if(_memory.takeWatchHit(_trapAddress)) {
+            _trap = Watchpoint;
+        }
+        if(_cycle >= _cyclesPerFrame || _input.IsWaitingForKeyPress) {
+            _timers.step();
+            _cycle = 0;
+        }
+    }
+
+    bool Machine::isWaitingForKey() const
+    {
+        return _input.IsWaitingForKeyPress;
+    }
+
+    void Machine::idle(unsigned int frames)
+    {
+        if(_input.IsWaitingForKeyPress) {
+            _timers.step(frames);
+        }
+    }
+
+    void Machine::setBreakpoints(const Uint8 *bitmap)
+    {
+        _breakpoints = bitmap;
+    }
+
+    void Machine::setWatchpoints(const Uint8 *bitmap)
+    {
+        _memory.setWriteWatch(bitmap);
+    }
+
+    Machine::Trap Machine::lastTrap() const
+    {
+        return _trap;
+    }
+
+    unsigned int Machine::trapAddress() const
+    {
+        return _trapAddress;
+    }
+
+    void Machine::setKeys(Uint16 keys)
+    {
+        Uint16 pressed = keys & ~_input.getKeys();
+        _input.setKeys(keys);
+        if(!_input.IsWaitingForKeyPress || pressed == 0) {
+            return;
+        }
+
+        // Store the lowest newly pressed key and let the Cpu continue.
+        for(unsigned char hex = 0; hex <= 0xF; hex++) {
+            if(pressed & (1 << hex)) {
+                VLOG(1) << _Tag << "Key " << (int) hex << " pressed, setting register " << (int) _input.KeyPressRegister;
+                _memory.setRegister(_input.KeyPressRegister, hex);
+                _input.IsWaitingForKeyPress = false;
+                break;
+            }
+        }
+    }
+
+    void Machine::setCyclesPerFrame(int cycles)
+    {
+        _cyclesPerFrame = cycles < 1 ? 1 : cycles;
+    }
+
+    int Machine::getCyclesPerFrame() const
+    {
+        return _cyclesPerFrame;
+    }
+
+    void Machine::save(State &state) const
+    {
+        _memory.saveState(state.memory);
+        _cpu.saveState(state.cpu);
+        _timers.saveState(state.timers);
+        _video.saveState(state.video);
+        _input.saveState(state.input);
+    }
+
+    void Machine::restore(const State &state)
+    {
+        _memory.loadState(state.memory);
+        _cpu.loadState(state.cpu);
+        _timers.loadState(state.timers);
+        _video.loadState(state.video);
+        _input.loadState(state.input);
+        _cycle = 0;
+        _trap = NoTrap;
+    }
+
+    Uint64 Machine::stateHash()
+    {
+        Uint64 hash = BitUtils::mix(_video.frameHash() ^ _video.getPlaneMask());
+        hash = BitUtils::mix(hash ^ _memory.hash());
+        for(unsigned char reg = Memory::FirstRegisterAddress; reg <= Memory::LastRegisterAddress; reg++) {
+            unsigned char data = 0;
+            _memory.getRegister(reg, data);
+            hash = BitUtils::mix(hash ^ ((Uint64) reg << 8 | data));
+        }
+        hash = BitUtils::mix(hash ^ _memory.getI());
+
+        Cpu::State cpu;
+        _cpu.saveState(cpu);
+        hash = BitUtils::mix(hash ^ ((Uint64) (Uint32) cpu.pc << 32 | (Uint32) cpu.sp));
+        // Entries above the stack pointer are dead and don't count.
+        for(int i = 0; i <= cpu.sp; i++) {
+            hash = BitUtils::mix(hash ^ cpu.stack[i]);
+        }
+        hash = BitUtils::mix(hash ^ cpu.random);
+        hash = BitUtils::mix(hash ^ ((Uint64) _timers.getDelayTimer() << 32 | _timers.getSoundTimer()));
+
+        InputManager::State input;
+        _input.saveState(input);
+        return BitUtils::mix(hash ^ ((Uint64) input.keys << 16 | input.isWaitingForKeyPress << 8 | input.keyPressRegister));
+    }
+}
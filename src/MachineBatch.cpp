@@ -0,0 +1,167 @@
+#include <MachineBatch.hpp>
+#include <Video.hpp>
+
+#include <string.h>
+
+namespace Chip8
+{
+    namespace
+    {
+        const size_t PlaneWords = 2 * 32;
+        const size_t ScreenPixels = 32 * 64;
+    }
+
+    MachineBatch::MachineBatch(size_t size, unsigned int threads, bool expand)
+        : _planes((size < 1 ? 1 : size) * PlaneWords, 0),
+          _sounds(size < 1 ? 1 : size, 0),
+          _expand(expand),
+          _generation(0),
+          _pending(0),
+          _stopping(false),
+          _keys(0),
+          _frames(0)
+    {
+        for(size_t i = 0; i < (size < 1 ? 1 : size); i++) {
+            _machines.push_back(std::unique_ptr<Machine>(new Machine()));
+        }
+        if(expand) {
+            _pixels.resize(_machines.size() * ScreenPixels, 0);
+        }
+        // More threads than machines would have nothing to do.
+        if(threads < 1) {
+            threads = 1;
+        }
+        if(threads > _machines.size()) {
+            threads = (unsigned int) _machines.size();
+        }
+        for(unsigned int i = 1; i < threads; i++) {
+            _threads.push_back(std::thread(&MachineBatch::run, this, i));
+        }
+    }
+
+    MachineBatch::~MachineBatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _start.notify_all();
+        for(size_t i = 0; i < _threads.size(); i++) {
+            _threads[i].join();
+        }
+    }
+
+    size_t MachineBatch::size() const
+    {
+        return _machines.size();
+    }
+
+    Machine & MachineBatch::machine(size_t index)
+    {
+        return *_machines[index];
+    }
+
+    bool MachineBatch::reset(const std::vector<unsigned char> &rom, unsigned int seed)
+    {
+        for(size_t i = 0; i < _machines.size(); i++) {
+            if(!_machines[i]->reset(rom)) {
+                return false;
+            }
+            _machines[i]->cpu().seed(seed + (unsigned int) i);
+            refresh(i);
+        }
+        return true;
+    }
+
+    void MachineBatch::step(const Uint16 *keys, unsigned int frames)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _keys = keys;
+            _frames = frames;
+            _pending = (unsigned int) _threads.size();
+            _generation++;
+        }
+        _start.notify_all();
+
+        // The caller takes the first slice rather than waiting idle.
+        stepSlice(0);
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(_pending > 0) {
+            _done.wait(lock);
+        }
+    }
+
+    const Uint64 * MachineBatch::planes() const
+    {
+        return &_planes[0];
+    }
+
+    const Uint8 * MachineBatch::pixels() const
+    {
+        return _expand ? &_pixels[0] : 0;
+    }
+
+    const Uint8 * MachineBatch::sounds() const
+    {
+        return &_sounds[0];
+    }
+
+    void MachineBatch::run(unsigned int index)
+    {
+        Uint64 seen = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(true) {
+            while(!_stopping && _generation == seen) {
+                _start.wait(lock);
+            }
+            if(_stopping) {
+                return;
+            }
+            seen = _generation;
+            lock.unlock();
+            stepSlice(index);
+            lock.lock();
+            if(--_pending == 0) {
+                _done.notify_one();
+            }
+        }
+    }
+
+    void MachineBatch::stepSlice(unsigned int index)
+    {
+        size_t threads = _threads.size() + 1;
+        size_t first = _machines.size() * index / threads;
+        size_t last = _machines.size() * (index + 1) / threads;
+        for(size_t i = first; i < last; i++) {
+            Machine &machine = *_machines[i];
+            machine.setKeys(_keys[i]);
+            for(unsigned int f = 0; f < _frames; f++) {
+                machine.stepFrame();
+            }
+            refresh(i);
+        }
+    }
+
+    void MachineBatch::refresh(size_t index)
+    {
+        Machine &machine = *_machines[index];
+        Video &video = machine.video();
+        Uint64 *planes = &_planes[index * PlaneWords];
+        memcpy(planes, video.getPlane(0), 32 * sizeof(Uint64));
+        memcpy(planes + 32, video.getPlane(1), 32 * sizeof(Uint64));
+        _sounds[index] = machine.timers().getSoundTimer() > 0 ? 1 : 0;
+        if(!_expand) {
+            return;
+        }
+
+        Uint8 *pixels = &_pixels[index * ScreenPixels];
+        for(int y = 0; y < 32; y++) {
+            Uint64 plane0 = planes[y];
+            Uint64 plane1 = planes[32 + y];
+            for(int x = 0; x < 64; x++) {
+                *pixels++ = (Uint8) (((plane0 >> (63 - x)) & 0x1) | (((plane1 >> (63 - x)) & 0x1) << 1));
+            }
+        }
+    }
+}
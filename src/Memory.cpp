@@ -1,22 +1,104 @@
 #include <Memory.hpp>
+#include <Machine.hpp>
 #include <Fonts.hpp>
+#include <BitUtils.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string.h>
 
 namespace Chip8 
 {
-    const unsigned int Memory::MaxAddress = 4096;
+    const unsigned int Memory::MaxAddress = 0x10000;
+    const unsigned int Memory::PageSize = 0x100;
     const unsigned int Memory::StartAddress = 0x200;
     const unsigned char Memory::FirstRegisterAddress = 0x0;
     const unsigned char Memory::LastRegisterAddress = 0xF;
 
-    Memory::Memory()
+    namespace
     {
+        // One byte's share of the memory hash. Zero bytes have none, so
+        // cleared memory hashes to 0 without hashing anything.
+        Uint64 byteHash(unsigned int address, unsigned char byte)
+        {
+            return byte == 0 ? 0 : BitUtils::mix(((Uint64) address << 8) | byte);
+        }
+
+        const unsigned int PageShift = 8;
+        const unsigned int PageCount = 0x100;
 
+        // A lineage unlikely to be shared with any other Memory, even one
+        // in another process whose states were saved to a file.
+        Uint64 newLineage()
+        {
+            static std::atomic<Uint64> created(0);
+            Uint64 seed = (Uint64) std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            Uint64 lineage = BitUtils::mix(seed ^ BitUtils::mix(++created));
+            return lineage == 0 ? 1 : lineage;
+        }
+    }
+
+    Memory::Memory()
+        : _addressRegister(0),
+          _hash(0),
+          _lineage(newLineage()),
+          _epoch(1),
+          _writeWatch(0),
+          _watchHit(false),
+          _watchAddress(0)
+    {
+        memset(_memory, 0, sizeof(_memory));
+        memset(_registers, 0, sizeof(_registers));
+        memset(_pageVersions, 0, sizeof(_pageVersions));
     }
 
     Memory & Memory::instance()
     {
-        static Memory instance;
-        return instance;
+        return Machine::current().memory();
+    }
+
+    void Memory::saveState(State &state) const
+    {
+        if(state.lineage != _lineage) {
+            memcpy(state.memory, _memory, sizeof(_memory));
+            memcpy(state.pageVersions, _pageVersions, sizeof(_pageVersions));
+            state.lineage = _lineage;
+        } else {
+            for(unsigned int page = 0; page < PageCount; page++) {
+                if(state.pageVersions[page] != _pageVersions[page]) {
+                    memcpy(state.memory + (page << PageShift), _memory + (page << PageShift), PageSize);
+                    state.pageVersions[page] = _pageVersions[page];
+                }
+            }
+        }
+        memcpy(state.registers, _registers, sizeof(_registers));
+        state.addressRegister = _addressRegister;
+        state.hash = _hash;
+        // Later writes must not reuse the versions state now holds.
+        _epoch++;
+    }
+
+    void Memory::loadState(const State &state)
+    {
+        if(state.lineage != _lineage) {
+            // The state's versions mean nothing here, so every page counts
+            // as written since any state this Memory saved.
+            memcpy(_memory, state.memory, sizeof(_memory));
+            for(unsigned int page = 0; page < PageCount; page++) {
+                _pageVersions[page] = _epoch;
+            }
+        } else {
+            for(unsigned int page = 0; page < PageCount; page++) {
+                if(_pageVersions[page] != state.pageVersions[page]) {
+                    memcpy(_memory + (page << PageShift), state.memory + (page << PageShift), PageSize);
+                    _pageVersions[page] = state.pageVersions[page];
+                }
+            }
+        }
+        memcpy(_registers, state.registers, sizeof(_registers));
+        _addressRegister = state.addressRegister;
+        _hash = state.hash;
+        _epoch++;
     }
 
     bool Memory::read(unsigned int address, unsigned char &byte) const
@@ -28,15 +110,80 @@ namespace Chip8
         return false;
     }
 
+    const unsigned char * Memory::span(unsigned int address, unsigned int size) const
+    {
+        if(address > MaxAddress || size > MaxAddress - address) {
+            return 0;
+        }
+        return _memory + address;
+    }
+
     bool Memory::write(unsigned int address, unsigned char byte)
     {
         if(validAddress(address)){
+            _hash ^= byteHash(address, _memory[address]) ^ byteHash(address, byte);
             _memory[address] = byte;
+            _pageVersions[address >> PageShift] = _epoch;
+            if(_writeWatch != 0 && (_writeWatch[address >> 3] >> (address & 7)) & 0x1) {
+                _watchHit = true;
+                _watchAddress = address;
+            }
             return true;
         }
         return false;
     }
     
+    bool Memory::load(unsigned int address, const unsigned char *data, unsigned int size)
+    {
+        if(address > MaxAddress || size > MaxAddress - address) {
+            return false;
+        }
+        // Take out what the block replaces, which leaves the hash as if
+        // memory there were zero.
+        for(unsigned int i = 0; i < size; i++) {
+            _hash ^= byteHash(address + i, _memory[address + i]);
+        }
+        return load(address, data, size, hashBlock(address, data, size));
+    }
+
+    bool Memory::load(unsigned int address, const unsigned char *data, unsigned int size, Uint64 hash)
+    {
+        if(address > MaxAddress || size > MaxAddress - address) {
+            return false;
+        }
+        _hash ^= hash;
+        memcpy(_memory + address, data, size);
+        if(size > 0) {
+            for(unsigned int page = address >> PageShift; page <= (address + size - 1) >> PageShift; page++) {
+                _pageVersions[page] = _epoch;
+            }
+        }
+        return true;
+    }
+
+    Uint64 Memory::hashBlock(unsigned int address, const unsigned char *data, unsigned int size)
+    {
+        Uint64 hash = 0;
+        for(unsigned int i = 0; i < size; i++) {
+            hash ^= byteHash(address + i, data[i]);
+        }
+        return hash;
+    }
+
+    void Memory::clear()
+    {
+        for(unsigned int page = 0; page < PageCount; page++) {
+            if(_pageVersions[page] != 0) {
+                memset(_memory + (page << PageShift), 0, PageSize);
+                _pageVersions[page] = 0;
+            }
+        }
+        memset(_registers, 0, sizeof(_registers));
+        _addressRegister = 0;
+        _hash = 0;
+        _watchHit = false;
+    }
+
     bool Memory::setRegister(unsigned char reg, unsigned char data)
     {
         if(validRegisterAddress(reg)) {
@@ -71,6 +218,32 @@ namespace Chip8
         return 0x0 + hex * Fonts::SpriteHeight;
     }
 
+    Uint64 Memory::hash() const
+    {
+        return _hash;
+    }
+
+    void Memory::setWriteWatch(const Uint8 *bitmap)
+    {
+        _writeWatch = bitmap;
+        _watchHit = false;
+    }
+
+    bool Memory::isWatching() const
+    {
+        return _writeWatch != 0;
+    }
+
+    bool Memory::takeWatchHit(unsigned int &address)
+    {
+        if(!_watchHit) {
+            return false;
+        }
+        _watchHit = false;
+        address = _watchAddress;
+        return true;
+    }
+
     bool Memory::validAddress(unsigned int address) const
     {
         return address < MaxAddress;
@@ -0,0 +1,316 @@
+#include <Metrics.hpp>
+
+#include <glog/logging.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+#ifdef CHIP8_ENABLE_METRICS
+    const bool Metrics::Enabled = true;
+#else
+    const bool Metrics::Enabled = false;
+#endif
+
+    const std::string Metrics::_Tag = "Metrics:";
+    const std::string MetricsExporter::_Tag = "MetricsExporter:";
+
+    namespace
+    {
+        // Frame time buckets in microseconds, centered on 16.7ms.
+        const Uint64 FrameTimeBounds[] = {
+            1000, 4000, 8000, 12000, 15000, 16000, 16500, 17000, 17500, 18000, 20000, 25000, 33333, 50000, 100000
+        };
+
+        // How long the thread waits for a connection before checking the
+        // stop flag and the file interval.
+        const int PollMs = 100;
+
+        // Longest a client gets to send its request.
+        const int RequestTimeoutMs = 1000;
+    }
+
+    Counter::Counter(const char *name, const char *help)
+        : _name(name),
+          _help(help),
+          _value(0)
+    {
+    }
+
+    Uint64 Counter::value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+    void Counter::write(std::ostream &out) const
+    {
+        out << "# HELP " << _name << " " << _help << "\n"
+            << "# TYPE " << _name << " counter\n"
+            << _name << " " << value() << "\n";
+    }
+
+    Gauge::Gauge(const char *name, const char *help, double unit)
+        : _name(name),
+          _help(help),
+          _unit(unit),
+          _value(0)
+    {
+    }
+
+    Uint64 Gauge::value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+    void Gauge::write(std::ostream &out) const
+    {
+        out << "# HELP " << _name << " " << _help << "\n"
+            << "# TYPE " << _name << " gauge\n"
+            << _name << " " << value() * _unit << "\n";
+    }
+
+    Histogram::Histogram(const char *name, const char *help, const Uint64 *bounds, int count, double unit)
+        : _name(name),
+          _help(help),
+          _bounds(bounds),
+          _count(count < MaxBuckets ? count : MaxBuckets),
+          _unit(unit),
+          _sum(0)
+    {
+        for(int i = 0; i <= MaxBuckets; i++) {
+            _buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Histogram::observe(Uint64 value)
+    {
+        int bucket = 0;
+        while(bucket < _count && value > _bounds[bucket]) {
+            bucket++;
+        }
+        _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void Histogram::write(std::ostream &out) const
+    {
+        out << "# HELP " << _name << " " << _help << "\n"
+            << "# TYPE " << _name << " histogram\n";
+        // The default 6 digits would round a long running sum.
+        std::streamsize precision = out.precision(15);
+        Uint64 cumulative = 0;
+        for(int i = 0; i < _count; i++) {
+            cumulative += _buckets[i].load(std::memory_order_relaxed);
+            out << _name << "_bucket{le=\"" << _bounds[i] * _unit << "\"} " << cumulative << "\n";
+        }
+        cumulative += _buckets[_count].load(std::memory_order_relaxed);
+        out << _name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+            << _name << "_sum " << _sum.load(std::memory_order_relaxed) * _unit << "\n"
+            << _name << "_count " << cumulative << "\n";
+        out.precision(precision);
+    }
+
+    Metrics::Metrics()
+        : instructions("chip8_instructions_total", "Instructions executed."),
+          draws("chip8_draws_total", "DXYN sprite draws."),
+          collisions("chip8_collisions_total", "DXYN sprite draws that set VF."),
+          framesPresented("chip8_frames_presented_total", "Frames shown in the window."),
+          framesSkipped("chip8_frames_skipped_total", "Frames emulated but never shown."),
+          timerTicks("chip8_timer_ticks_total", "60Hz delay and sound timer steps."),
+          inputEvents("chip8_input_events_total", "Key presses and releases."),
+          lateFrames("chip8_frames_late_total", "Paced frames that started more than a period after their deadline."),
+          frameTime("chip8_frame_time_seconds", "Time between the starts of consecutive frames.",
+                    FrameTimeBounds, sizeof(FrameTimeBounds) / sizeof(FrameTimeBounds[0]), 1e-6),
+          maxFrameOverrun("chip8_frame_overrun_max_seconds",
+                          "Longest a paced frame started after its deadline, over the last 600 frames.", 1e-6)
+    {
+    }
+
+    Metrics & Metrics::instance()
+    {
+        static Metrics instance;
+        return instance;
+    }
+
+    void Metrics::write(std::ostream &out) const
+    {
+        instructions.write(out);
+        draws.write(out);
+        collisions.write(out);
+        framesPresented.write(out);
+        framesSkipped.write(out);
+        timerTicks.write(out);
+        inputEvents.write(out);
+        lateFrames.write(out);
+        frameTime.write(out);
+        maxFrameOverrun.write(out);
+    }
+
+    MetricsExporter::MetricsExporter()
+        : _stopping(false),
+          _socket(-1),
+          _intervalSeconds(10)
+    {
+    }
+
+    MetricsExporter::~MetricsExporter()
+    {
+        stop();
+    }
+
+    bool MetricsExporter::start(const std::string &path, int port, int intervalSeconds)
+    {
+        if(isRunning()) {
+            LOG(INFO) << _Tag << "Exporter already running";
+            return false;
+        }
+        if(!Metrics::Enabled) {
+            LOG(WARNING) << _Tag << "Built without CHIP8_ENABLE_METRICS, every metric will be 0";
+        }
+
+        if(port > 0) {
+            _socket = socket(AF_INET, SOCK_STREAM, 0);
+            if(_socket < 0) {
+                LOG(INFO) << _Tag << "Failed to create socket - " << strerror(errno);
+                return false;
+            }
+            int reuse = 1;
+            setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            // Only the local machine can scrape, the metrics aren't meant to
+            // be exposed on the network.
+            sockaddr_in local;
+            memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            local.sin_port = htons(port);
+            if(bind(_socket, (const sockaddr *) &local, sizeof(local)) < 0 || listen(_socket, 4) < 0) {
+                LOG(INFO) << _Tag << "Failed to listen on port " << port << " - " << strerror(errno);
+                ::close(_socket);
+                _socket = -1;
+                return false;
+            }
+        }
+
+        _path = path;
+        _intervalSeconds = intervalSeconds > 0 ? intervalSeconds : 1;
+        _stopping.store(false);
+        _thread = std::thread(&MetricsExporter::run, this);
+        LOG(INFO) << _Tag << "Exporting metrics" << (path.empty() ? "" : " to " + path)
+                  << (port > 0 ? " on 127.0.0.1:" + std::to_string(port) : "");
+        return true;
+    }
+
+    void MetricsExporter::stop()
+    {
+        if(!isRunning()) {
+            return;
+        }
+        _stopping.store(true);
+        _thread.join();
+        if(_socket >= 0) {
+            ::close(_socket);
+            _socket = -1;
+        }
+        if(!_path.empty()) {
+            writeFile();
+        }
+    }
+
+    bool MetricsExporter::isRunning() const
+    {
+        return _thread.joinable();
+    }
+
+    void MetricsExporter::run()
+    {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point nextWrite = Clock::now();
+        while(!_stopping.load()) {
+            if(!_path.empty() && Clock::now() >= nextWrite) {
+                writeFile();
+                nextWrite += std::chrono::seconds(_intervalSeconds);
+            }
+
+            if(_socket < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(PollMs));
+                continue;
+            }
+            pollfd listener;
+            listener.fd = _socket;
+            listener.events = POLLIN;
+            if(poll(&listener, 1, PollMs) > 0) {
+                int connection = accept(_socket, 0, 0);
+                if(connection >= 0) {
+                    serve(connection);
+                    ::close(connection);
+                }
+            }
+        }
+    }
+
+    void MetricsExporter::writeFile()
+    {
+        // Written next to the target and renamed over it, which is atomic.
+        std::string temporary = _path + ".tmp";
+        {
+            std::ofstream out(temporary.c_str(), std::ios::out | std::ios::trunc);
+            Metrics::instance().write(out);
+            if(!out) {
+                LOG(INFO) << _Tag << "Failed to write " << temporary;
+                return;
+            }
+        }
+        if(rename(temporary.c_str(), _path.c_str()) != 0) {
+            LOG(INFO) << _Tag << "Failed to replace " << _path << " - " << strerror(errno);
+        }
+    }
+
+    void MetricsExporter::serve(int connection)
+    {
+        // Every path gets the metrics, so only the end of the headers matters.
+        std::string request;
+        char buffer[512];
+        pollfd client;
+        client.fd = connection;
+        client.events = POLLIN;
+        while(request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            if(poll(&client, 1, RequestTimeoutMs) <= 0) {
+                return;
+            }
+            ssize_t size = recv(connection, buffer, sizeof(buffer), 0);
+            if(size <= 0) {
+                return;
+            }
+            request.append(buffer, size);
+        }
+
+        std::ostringstream body;
+        Metrics::instance().write(body);
+        std::string text = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << text.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << text;
+        std::string data = response.str();
+        size_t sent = 0;
+        while(sent < data.size()) {
+            ssize_t size = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if(size <= 0) {
+                return;
+            }
+            sent += size;
+        }
+    }
+}
@@ -0,0 +1,423 @@
+#include <Netplay.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+    const std::string Netplay::_Tag = "Netplay:";
+
+    namespace
+    {
+        // Frames of input history kept for each player.
+        const Uint32 HistorySize = 256;
+
+        // Inputs are resent until acknowledged, so one arriving packet makes
+        // up for the lost ones before it. Neither side can get more than
+        // 2 * (inputDelay + maxRollback) frames of input ahead of what the
+        // other has acknowledged, so the limits below keep every unacknowledged
+        // input in one packet.
+        const Uint32 MaxInputsPerPacket = 128;
+        const int MaxInputDelay = 16;
+        const int MaxRollback = 48;
+
+        const Uint8 Magic[4] = {'C', '8', 'N', 'P'};
+        const Uint8 Version = 1;
+
+        // Magic, version, count, first frame, acknowledged frame.
+        const size_t HeaderSize = 4 + 1 + 1 + 4 + 4;
+        const size_t MaxPacketSize = HeaderSize + MaxInputsPerPacket * 2;
+
+        const Uint32 NoRollback = 0xFFFFFFFF;
+
+        void put32(Uint8 *data, Uint32 value)
+        {
+            data[0] = value & 0xFF;
+            data[1] = (value >> 8) & 0xFF;
+            data[2] = (value >> 16) & 0xFF;
+            data[3] = (value >> 24) & 0xFF;
+        }
+
+        Uint32 get32(const Uint8 *data)
+        {
+            return data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32) data[3] << 24);
+        }
+    }
+
+    LinkSimulator::LinkSimulator()
+        : _latencyMs(0),
+          _jitterMs(0),
+          _lossPercent(0),
+          _random(1)
+    {
+    }
+
+    void LinkSimulator::configure(int latencyMs, int jitterMs, int lossPercent, unsigned int seed)
+    {
+        _latencyMs = latencyMs;
+        _jitterMs = jitterMs;
+        _lossPercent = lossPercent;
+        _random = seed != 0 ? seed : 1;
+        _queue.clear();
+    }
+
+    void LinkSimulator::send(int socket, const sockaddr_in &to, const Uint8 *data, size_t size)
+    {
+        if(_lossPercent > 0 && (int) random(100) < _lossPercent) {
+            return;
+        }
+        if(_latencyMs == 0 && _jitterMs == 0) {
+            sendto(socket, data, size, 0, (const sockaddr *) &to, sizeof(to));
+            return;
+        }
+
+        int delayMs = _latencyMs + (_jitterMs > 0 ? (int) random(_jitterMs + 1) : 0);
+        Packet packet;
+        packet.due = Clock::now() + std::chrono::milliseconds(delayMs);
+        packet.to = to;
+        packet.data.assign(data, data + size);
+
+        // Jitter can reorder packets, keep the queue sorted by due time.
+        std::deque<Packet>::iterator it = _queue.end();
+        while(it != _queue.begin() && (it - 1)->due > packet.due) {
+            --it;
+        }
+        _queue.insert(it, packet);
+    }
+
+    void LinkSimulator::pump(int socket)
+    {
+        Clock::time_point now = Clock::now();
+        while(!_queue.empty() && _queue.front().due <= now) {
+            const Packet &packet = _queue.front();
+            sendto(socket, &packet.data[0], packet.data.size(), 0, (const sockaddr *) &packet.to, sizeof(packet.to));
+            _queue.pop_front();
+        }
+    }
+
+    unsigned int LinkSimulator::random(unsigned int range)
+    {
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        return _random % range;
+    }
+
+    Netplay::Config::Config()
+        : localPort(0),
+          remotePort(0),
+          inputDelay(2),
+          maxRollback(8),
+          latencyMs(0),
+          jitterMs(0),
+          lossPercent(0),
+          simulatorSeed(1)
+    {
+    }
+
+    Netplay::Netplay()
+        : _socket(-1),
+          _localInputs(HistorySize, 0),
+          _remoteInputs(HistorySize, 0),
+          _usedRemoteInputs(HistorySize, 0),
+          _frame(0),
+          _localEnd(0),
+          _remoteEnd(0),
+          _remoteAck(0),
+          _rollbackFrom(NoRollback),
+          _rollbacks(0),
+          _maxResimulated(0),
+          _maxRollbackMicroseconds(0.0)
+    {
+        memset(&_remote, 0, sizeof(_remote));
+    }
+
+    Netplay::~Netplay()
+    {
+        close();
+    }
+
+    bool Netplay::open(const Config &config)
+    {
+        close();
+        _config = config;
+        _config.inputDelay = std::max(0, std::min(_config.inputDelay, MaxInputDelay));
+        _config.maxRollback = std::max(1, std::min(_config.maxRollback, MaxRollback));
+
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *result = 0;
+        if(getaddrinfo(_config.remoteHost.c_str(), NULL, &hints, &result) != 0 || result == 0) {
+            LOG(INFO) << _Tag << "Unknown host " << _config.remoteHost;
+            return false;
+        }
+        _remote = *(const sockaddr_in *) result->ai_addr;
+        _remote.sin_port = htons(_config.remotePort);
+        freeaddrinfo(result);
+
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if(_socket < 0) {
+            LOG(INFO) << _Tag << "Failed to create socket - " << strerror(errno);
+            return false;
+        }
+        fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL, 0) | O_NONBLOCK);
+
+        sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(_config.localPort);
+        if(bind(_socket, (const sockaddr *) &local, sizeof(local)) < 0) {
+            LOG(INFO) << _Tag << "Failed to bind port " << _config.localPort << " - " << strerror(errno);
+            close();
+            return false;
+        }
+
+        _simulator.configure(_config.latencyMs, _config.jitterMs, _config.lossPercent, _config.simulatorSeed);
+        _states.resize(_config.maxRollback + 1);
+        std::fill(_localInputs.begin(), _localInputs.end(), 0);
+        std::fill(_remoteInputs.begin(), _remoteInputs.end(), 0);
+        std::fill(_usedRemoteInputs.begin(), _usedRemoteInputs.end(), 0);
+
+        // Both sides play no input during the first inputDelay frames, so
+        // those frames are known without asking.
+        _frame = 0;
+        _localEnd = _config.inputDelay;
+        _remoteEnd = _config.inputDelay;
+        _remoteAck = _config.inputDelay;
+        _rollbackFrom = NoRollback;
+        _rollbacks = 0;
+        _maxResimulated = 0;
+        _maxRollbackMicroseconds = 0.0;
+
+        LOG(INFO) << _Tag << "Listening on " << _config.localPort << ", playing with "
+                  << _config.remoteHost << ":" << _config.remotePort << " delay " << _config.inputDelay
+                  << " rollback " << _config.maxRollback;
+        return true;
+    }
+
+    void Netplay::close()
+    {
+        if(_socket >= 0) {
+            ::close(_socket);
+            _socket = -1;
+        }
+    }
+
+    bool Netplay::isOpen() const
+    {
+        return _socket >= 0;
+    }
+
+    bool Netplay::advance(Machine &machine, Uint16 localKeys)
+    {
+        poll(machine);
+
+        // Too far ahead to roll back if the prediction is wrong, wait for
+        // the remote side to catch up.
+        if(_frame >= _remoteEnd + _config.maxRollback) {
+            return false;
+        }
+
+        _localInputs[_localEnd % HistorySize] = localKeys;
+        _localEnd++;
+        runFrame(machine, _frame);
+        _frame++;
+        sendInputs();
+        return true;
+    }
+
+    void Netplay::poll(Machine &machine)
+    {
+        if(!isOpen()) {
+            return;
+        }
+        _simulator.pump(_socket);
+        receive();
+        rollback(machine);
+        sendInputs();
+    }
+
+    const Netplay::Config & Netplay::config() const
+    {
+        return _config;
+    }
+
+    Uint32 Netplay::frame() const
+    {
+        return _frame;
+    }
+
+    Uint32 Netplay::confirmedFrame() const
+    {
+        return _remoteEnd < _frame ? _remoteEnd : _frame;
+    }
+
+    Uint64 Netplay::rollbacks() const
+    {
+        return _rollbacks;
+    }
+
+    Uint32 Netplay::maxResimulatedFrames() const
+    {
+        return _maxResimulated;
+    }
+
+    double Netplay::maxRollbackMicroseconds() const
+    {
+        return _maxRollbackMicroseconds;
+    }
+
+    bool Netplay::parseAddress(const std::string &value, Config &config)
+    {
+        size_t first = value.find(':');
+        size_t last = value.rfind(':');
+        if(first == std::string::npos || first == last) {
+            return false;
+        }
+
+        std::string localPort = value.substr(0, first);
+        std::string host = value.substr(first + 1, last - first - 1);
+        std::string remotePort = value.substr(last + 1);
+        char *end = 0;
+        long local = strtol(localPort.c_str(), &end, 10);
+        if(localPort.empty() || *end != '\0' || local < 1 || local > 0xFFFF) {
+            return false;
+        }
+        long remote = strtol(remotePort.c_str(), &end, 10);
+        if(remotePort.empty() || *end != '\0' || remote < 1 || remote > 0xFFFF || host.empty()) {
+            return false;
+        }
+
+        config.localPort = (int) local;
+        config.remoteHost = host;
+        config.remotePort = (int) remote;
+        return true;
+    }
+
+    void Netplay::receive()
+    {
+        Uint8 data[MaxPacketSize];
+        for(;;) {
+            sockaddr_in from;
+            socklen_t fromSize = sizeof(from);
+            ssize_t size = recvfrom(_socket, data, sizeof(data), 0, (sockaddr *) &from, &fromSize);
+            if(size < 0) {
+                break;
+            }
+            if(from.sin_addr.s_addr != _remote.sin_addr.s_addr || from.sin_port != _remote.sin_port) {
+                continue;
+            }
+            handlePacket(data, (size_t) size);
+        }
+    }
+
+    void Netplay::handlePacket(const Uint8 *data, size_t size)
+    {
+        if(size < HeaderSize || memcmp(data, Magic, sizeof(Magic)) != 0 || data[4] != Version) {
+            return;
+        }
+        Uint32 count = data[5];
+        if(count > MaxInputsPerPacket || size != HeaderSize + count * 2) {
+            return;
+        }
+        Uint32 first = get32(data + 6);
+        Uint32 ack = get32(data + 10);
+        if(ack > _remoteAck && ack <= _localEnd) {
+            _remoteAck = ack;
+        }
+
+        // Only take packets that continue the confirmed inputs, a later
+        // packet will repeat anything skipped here.
+        if(first > _remoteEnd || first + count <= _remoteEnd) {
+            return;
+        }
+        for(Uint32 frame = _remoteEnd; frame < first + count; frame++) {
+            const Uint8 *input = data + HeaderSize + (frame - first) * 2;
+            Uint16 keys = input[0] | (input[1] << 8);
+            _remoteInputs[frame % HistorySize] = keys;
+            if(frame < _frame && _usedRemoteInputs[frame % HistorySize] != keys && frame < _rollbackFrom) {
+                _rollbackFrom = frame;
+            }
+        }
+        _remoteEnd = first + count;
+    }
+
+    void Netplay::rollback(Machine &machine)
+    {
+        if(_rollbackFrom == NoRollback) {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Uint32 from = _rollbackFrom;
+        machine.restore(_states[from % _states.size()]);
+        for(Uint32 frame = from; frame < _frame; frame++) {
+            runFrame(machine, frame);
+        }
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        _rollbacks++;
+        if(_frame - from > _maxResimulated) {
+            _maxResimulated = _frame - from;
+        }
+        if(microseconds > _maxRollbackMicroseconds) {
+            _maxRollbackMicroseconds = microseconds;
+        }
+        _rollbackFrom = NoRollback;
+    }
+
+    void Netplay::runFrame(Machine &machine, Uint32 frame)
+    {
+        Uint16 remote = remoteInput(frame);
+        _usedRemoteInputs[frame % HistorySize] = remote;
+        machine.save(_states[frame % _states.size()]);
+        machine.setKeys(_localInputs[frame % HistorySize] | remote);
+        machine.stepFrame();
+    }
+
+    Uint16 Netplay::remoteInput(Uint32 frame) const
+    {
+        if(frame < _remoteEnd) {
+            return _remoteInputs[frame % HistorySize];
+        }
+        // Players mostly hold keys for many frames, so repeat the last input.
+        if(_remoteEnd == 0) {
+            return 0;
+        }
+        return _remoteInputs[(_remoteEnd - 1) % HistorySize];
+    }
+
+    void Netplay::sendInputs()
+    {
+        Uint32 first = _remoteAck;
+        if(_localEnd - first > MaxInputsPerPacket) {
+            first = _localEnd - MaxInputsPerPacket;
+        }
+        Uint32 count = _localEnd - first;
+
+        Uint8 data[MaxPacketSize];
+        memcpy(data, Magic, sizeof(Magic));
+        data[4] = Version;
+        data[5] = (Uint8) count;
+        put32(data + 6, first);
+        put32(data + 10, _remoteEnd);
+        for(Uint32 i = 0; i < count; i++) {
+            Uint16 keys = _localInputs[(first + i) % HistorySize];
+            data[HeaderSize + i * 2] = keys & 0xFF;
+            data[HeaderSize + i * 2 + 1] = keys >> 8;
+        }
+        _simulator.send(_socket, _remote, data, HeaderSize + count * 2);
+    }
+}
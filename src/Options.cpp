@@ -0,0 +1,255 @@
+#include <Options.hpp>
+
+#include <glog/logging.h>
+
+#include <iostream>
+#include <stdlib.h>
+
+namespace Chip8
+{
+    const std::string Options::_Tag = "Options:";
+
+    Options::Options()
+        : scaler(Scaler::None),
+          scalerKernel(Scaler::Auto),
+          scale(24),
+          captureFormat(Capture::Y4M),
+          mute(false),
+          cycles(1),
+          runAhead(0),
+          turbo(false),
+          presentEvery(0),
+          seed(-1),
+          netplayEnabled(false),
+          gdbPort(0),
+          metricsPort(0),
+          metricsInterval(10),
+          sharedRgba(false),
+          watch(false)
+    {
+    }
+
+    bool Options::parse(int argc, char *argv[])
+    {
+        for(int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::string name;
+            std::string value;
+            if(!split(arg, name, value)) {
+                if(!romName.empty()) {
+                    std::cout << "Only one rom can be given" << std::endl;
+                    return false;
+                }
+                romName = arg;
+                continue;
+            }
+
+            if(name == "scaler") {
+                if(!Scaler::parseFilter(value, scaler)) {
+                    std::cout << "Unknown scaler " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "scaler-kernel") {
+                if(!Scaler::parseKernel(value, scalerKernel)) {
+                    std::cout << "Unknown scaler kernel " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "scale") {
+                // The window and the scaled texture are scale times the
+                // screen, 64 makes a 4096x2048 window already.
+                if(!toInt(value, scale) || scale > 64) {
+                    std::cout << "Invalid scale " << value << ", it must be 1 to 64" << std::endl;
+                    return false;
+                }
+            } else if(name == "capture") {
+                if(value.empty()) {
+                    std::cout << "--capture needs a file name or -" << std::endl;
+                    return false;
+                }
+                capturePath = value;
+            } else if(name == "capture-format") {
+                if(!Capture::parseFormat(value, captureFormat)) {
+                    std::cout << "Unknown capture format " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "mute") {
+                mute = true;
+            } else if(name == "cycles") {
+                if(!toInt(value, cycles)) {
+                    std::cout << "Invalid cycles " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "runahead") {
+                if(!toInt(value, runAhead, 0)) {
+                    std::cout << "Invalid runahead " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "turbo") {
+                turbo = true;
+            } else if(name == "present-every") {
+                if(!toInt(value, presentEvery)) {
+                    std::cout << "Invalid present every " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "seed") {
+                if(!toInt(value, seed, 0)) {
+                    std::cout << "Invalid seed " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "netplay") {
+                if(!Netplay::parseAddress(value, netplay)) {
+                    std::cout << "--netplay needs LOCALPORT:HOST:REMOTEPORT" << std::endl;
+                    return false;
+                }
+                netplayEnabled = true;
+            } else if(name == "input-delay") {
+                if(!toInt(value, netplay.inputDelay, 0)) {
+                    std::cout << "Invalid input delay " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "rollback") {
+                if(!toInt(value, netplay.maxRollback)) {
+                    std::cout << "Invalid rollback " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "net-latency") {
+                if(!toInt(value, netplay.latencyMs, 0)) {
+                    std::cout << "Invalid latency " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "net-jitter") {
+                if(!toInt(value, netplay.jitterMs, 0)) {
+                    std::cout << "Invalid jitter " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "net-loss") {
+                if(!toInt(value, netplay.lossPercent, 0) || netplay.lossPercent > 100) {
+                    std::cout << "Invalid loss " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "gdb") {
+                if(!toInt(value, gdbPort) || gdbPort > 65535) {
+                    std::cout << "Invalid gdb port " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "metrics-file") {
+                if(value.empty()) {
+                    std::cout << "--metrics-file needs a file name" << std::endl;
+                    return false;
+                }
+                metricsPath = value;
+            } else if(name == "metrics-port") {
+                if(!toInt(value, metricsPort) || metricsPort > 65535) {
+                    std::cout << "Invalid metrics port " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "metrics-interval") {
+                if(!toInt(value, metricsInterval)) {
+                    std::cout << "Invalid metrics interval " << value << std::endl;
+                    return false;
+                }
+            } else if(name == "shm") {
+                if(value.size() < 2 || value[0] != '/' || value.find('/', 1) != std::string::npos) {
+                    std::cout << "--shm needs a name such as /chip8" << std::endl;
+                    return false;
+                }
+                sharedName = value;
+            } else if(name == "shm-rgba") {
+                sharedRgba = true;
+            } else if(name == "watch") {
+                watch = true;
+            } else {
+                std::cout << "Unknown option --" << name << std::endl;
+                return false;
+            }
+        }
+
+        if(romName.empty()) {
+            return false;
+        }
+        // Both sides of a netplay session have to run at the same rate.
+        if(turbo && netplayEnabled) {
+            std::cout << "--turbo can't be used with --netplay" << std::endl;
+            return false;
+        }
+        // Rolled back and run ahead frames would stop on breakpoints too.
+        if(gdbPort > 0 && (netplayEnabled || runAhead > 0)) {
+            std::cout << "--gdb can't be used with --netplay or --runahead" << std::endl;
+            return false;
+        }
+        // The other side would keep running the old ROM.
+        if(watch && netplayEnabled) {
+            std::cout << "--watch can't be used with --netplay" << std::endl;
+            return false;
+        }
+        if(sharedRgba && sharedName.empty()) {
+            std::cout << "--shm-rgba needs --shm" << std::endl;
+            return false;
+        }
+        LOG(INFO) << _Tag << "Rom " << romName << " scale " << scale;
+        return true;
+    }
+
+    void Options::printUsage()
+    {
+        std::cout << "Usage: chip8 [options] [romfile]" << std::endl
+                  << "  --scale=N                 Window scale, 1 to 64 (default 24)" << std::endl
+                  << "  --scaler=none|nearest|smooth" << std::endl
+                  << "                            Scale on the CPU instead of in SDL" << std::endl
+                  << "  --scaler-kernel=auto|scalar|sse2|avx2" << std::endl
+                  << "                            Instruction set the CPU scaler uses" << std::endl
+                  << "  --capture=FILE|-          Record presented frames, - for stdout" << std::endl
+                  << "  --capture-format=y4m|rgba Format of the recording (default y4m)" << std::endl
+                  << "  --mute                    Don't play the buzzer" << std::endl
+                  << "  --cycles=N                Instructions per frame (default 1)" << std::endl
+                  << "  --runahead=N              Present the frame N frames ahead (default 0)" << std::endl
+                  << "  --turbo                   Run as fast as possible, timers still tick per frame" << std::endl
+                  << "  --present-every=N         In turbo, present every Nth frame (default refresh rate)" << std::endl
+                  << "  --seed=N                  Random seed, netplay needs the same on both sides" << std::endl
+                  << "  --netplay=LOCALPORT:HOST:REMOTEPORT" << std::endl
+                  << "                            Play with another chip8 over UDP" << std::endl
+                  << "  --input-delay=N           Netplay frames of local input delay (default 2)" << std::endl
+                  << "  --rollback=N              Most netplay frames rolled back (default 8)" << std::endl
+                  << "  --net-latency=MS          Simulated extra latency for outgoing packets" << std::endl
+                  << "  --net-jitter=MS           Simulated random extra latency" << std::endl
+                  << "  --net-loss=PERCENT        Simulated outgoing packet loss" << std::endl
+                  << "  --gdb=PORT                Let a GDB remote protocol debugger attach on 127.0.0.1:PORT" << std::endl
+                  << "  --metrics-file=FILE       Write Prometheus metrics to FILE" << std::endl
+                  << "  --metrics-port=PORT       Serve Prometheus metrics on 127.0.0.1:PORT" << std::endl
+                  << "  --metrics-interval=S      Seconds between metrics file writes (default 10)" << std::endl
+                  << "  --shm=NAME                Export frames and take keys through shared memory NAME" << std::endl
+                  << "  --shm-rgba                Also export the screen as RGBA pixels" << std::endl
+                  << "  --watch                   Reload the ROM into the running machine when the file changes," << std::endl
+                  << "                            F5 saves a snapshot to return to on reload, F9 returns now" << std::endl;
+    }
+
+    bool Options::split(const std::string &arg, std::string &name, std::string &value)
+    {
+        if(arg.compare(0, 2, "--") != 0) {
+            return false;
+        }
+        size_t equals = arg.find('=');
+        if(equals == std::string::npos) {
+            name = arg.substr(2);
+            value.clear();
+        } else {
+            name = arg.substr(2, equals - 2);
+            value = arg.substr(equals + 1);
+        }
+        return true;
+    }
+
+    bool Options::toInt(const std::string &value, int &result, int minimum)
+    {
+        if(value.empty()) {
+            return false;
+        }
+        char *end = 0;
+        long parsed = strtol(value.c_str(), &end, 10);
+        if(*end != '\0' || parsed < minimum) {
+            return false;
+        }
+        result = (int) parsed;
+        return true;
+    }
+}
@@ -0,0 +1,133 @@
+#include <RomWatcher.hpp>
+
+#include <SDL_stdinc.h>
+#include <glog/logging.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace Chip8
+{
+    const std::string RomWatcher::_Tag = "RomWatcher:";
+
+    RomWatcher::RomWatcher()
+        : _inotify(-1),
+          _wake(-1),
+          _changed(false)
+    {
+    }
+
+    RomWatcher::~RomWatcher()
+    {
+        close();
+    }
+
+    bool RomWatcher::open(const std::string &path, const std::function<void()> &onChange)
+    {
+        if(isOpen()) {
+            LOG(INFO) << _Tag << "Already watching " << _name;
+            return false;
+        }
+#ifdef __linux__
+        size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        _name = slash == std::string::npos ? path : path.substr(slash + 1);
+        _inotify = inotify_init1(IN_CLOEXEC);
+        _wake = eventfd(0, EFD_CLOEXEC);
+        if(_inotify < 0 || _wake < 0
+           || inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            LOG(INFO) << _Tag << "Failed to watch " << directory << " - " << strerror(errno);
+            close();
+            return false;
+        }
+        _onChange = onChange;
+        _changed = false;
+        _thread = std::thread(&RomWatcher::run, this);
+        LOG(INFO) << _Tag << "Watching " << path;
+        return true;
+#else
+        (void) onChange;
+        LOG(INFO) << _Tag << "Can't watch " << path << ", there's no inotify";
+        return false;
+#endif
+    }
+
+    void RomWatcher::close()
+    {
+#ifdef __linux__
+        if(_thread.joinable()) {
+            Uint64 one = 1;
+            if(write(_wake, &one, sizeof(one)) != sizeof(one)) {
+                LOG(INFO) << _Tag << "Failed to wake the watcher - " << strerror(errno);
+            }
+            _thread.join();
+        }
+#endif
+        if(_inotify >= 0) {
+            ::close(_inotify);
+        }
+        if(_wake >= 0) {
+            ::close(_wake);
+        }
+        _inotify = -1;
+        _wake = -1;
+        _onChange = std::function<void()>();
+    }
+
+    bool RomWatcher::isOpen() const
+    {
+        return _inotify >= 0;
+    }
+
+    bool RomWatcher::changed()
+    {
+        return _changed.exchange(false);
+    }
+
+    void RomWatcher::run()
+    {
+#ifdef __linux__
+        // Big enough for several events with the longest names.
+        alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+        pollfd fds[2] = { { _inotify, POLLIN, 0 }, { _wake, POLLIN, 0 } };
+        while(true) {
+            if(poll(fds, 2, -1) < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                LOG(INFO) << _Tag << "Stopped watching " << _name << " - " << strerror(errno);
+                return;
+            }
+            if(fds[1].revents != 0) {
+                return;
+            }
+            ssize_t size = read(_inotify, buffer, sizeof(buffer));
+            if(size <= 0) {
+                continue;
+            }
+            bool changed = false;
+            for(ssize_t offset = 0; offset < size; ) {
+                const inotify_event *event = (const inotify_event *) (buffer + offset);
+                if(event->len > 0 && _name == event->name) {
+                    changed = true;
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+            if(changed) {
+                _changed = true;
+                if(_onChange) {
+                    _onChange();
+                }
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,476 @@
+#include <Scaler.hpp>
+#include <Video.hpp>
+
+#include <glog/logging.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CHIP8_SCALER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Chip8
+{
+    const std::string Scaler::_Tag = "Scaler:";
+
+    namespace
+    {
+        // The padded index image has a 1 pixel border on every side, and its
+        // rows are wide enough for 16 byte loads at x - 1 and x + 1.
+        const int PaddedStride = 80;
+        const int PaddedHeight = 32 + 2;
+        const int SmoothWidth = 64 * 2;
+        const int SmoothHeight = 32 * 2;
+
+        // Maps a byte of plane bits to 8 index bytes (0 or 1), most significant
+        // bit first.
+        struct BitsToBytes
+        {
+            unsigned char bytes[256][8];
+
+            BitsToBytes()
+            {
+                for(int b = 0; b < 256; b++) {
+                    for(int k = 0; k < 8; k++) {
+                        bytes[b][k] = (b >> (7 - k)) & 0x1;
+                    }
+                }
+            }
+        };
+
+        const BitsToBytes & bitsToBytes()
+        {
+            static const BitsToBytes table;
+            return table;
+        }
+
+        // Scalar kernels.
+
+        void expandRowScalar(Uint64 bits0, Uint64 bits1, const Uint32 *palette, Uint32 *output, int scale)
+        {
+            for(int x = 0; x < 64; x++) {
+                int shift = 63 - x;
+                Uint32 color = palette[((bits0 >> shift) & 0x1) | (((bits1 >> shift) & 0x1) << 1)];
+                for(int s = 0; s < scale; s++) {
+                    *output++ = color;
+                }
+            }
+        }
+
+        void expandIndicesScalar(const unsigned char *indices, int count, const Uint32 *palette, Uint32 *output, int scale)
+        {
+            for(int x = 0; x < count; x++) {
+                Uint32 color = palette[indices[x]];
+                for(int s = 0; s < scale; s++) {
+                    *output++ = color;
+                }
+            }
+        }
+
+        void smoothScalar(const unsigned char *indices, unsigned char *smoothed)
+        {
+            for(int y = 0; y < 32; y++) {
+                const unsigned char *above = indices + y * PaddedStride + 1;
+                const unsigned char *row = above + PaddedStride;
+                const unsigned char *below = row + PaddedStride;
+                unsigned char *top = smoothed + (2 * y) * SmoothWidth;
+                unsigned char *bottom = top + SmoothWidth;
+                for(int x = 0; x < 64; x++) {
+                    unsigned char b = above[x];
+                    unsigned char d = row[x - 1];
+                    unsigned char e = row[x];
+                    unsigned char f = row[x + 1];
+                    unsigned char h = below[x];
+                    top[2 * x] = (d == b && b != f && d != h) ? d : e;
+                    top[2 * x + 1] = (b == f && b != d && f != h) ? f : e;
+                    bottom[2 * x] = (d == h && d != b && h != f) ? d : e;
+                    bottom[2 * x + 1] = (h == f && h != d && b != f) ? f : e;
+                }
+            }
+        }
+
+#ifdef CHIP8_SCALER_X86
+
+        // SSE2 kernels.
+
+        // Writes the 4 pixels in colors to output, each repeated scale times.
+        __attribute__((target("sse2")))
+        inline void replicateSSE2(__m128i colors, Uint32 *output, int scale)
+        {
+            if(scale == 1) {
+                _mm_storeu_si128((__m128i *) output, colors);
+            } else if(scale == 2) {
+                _mm_storeu_si128((__m128i *) output, _mm_unpacklo_epi32(colors, colors));
+                _mm_storeu_si128((__m128i *) (output + 4), _mm_unpackhi_epi32(colors, colors));
+            } else if(scale == 3) {
+                Uint32 lanes[4];
+                _mm_storeu_si128((__m128i *) lanes, colors);
+                for(int k = 0; k < 4; k++) {
+                    output[3 * k] = lanes[k];
+                    output[3 * k + 1] = lanes[k];
+                    output[3 * k + 2] = lanes[k];
+                }
+            } else {
+                // Broadcast each lane and fill its run with full stores. The
+                // last store of a run may overlap the previous one, which is
+                // fine since it writes the same color.
+                __m128i lanes[4] = {
+                    _mm_shuffle_epi32(colors, 0x00),
+                    _mm_shuffle_epi32(colors, 0x55),
+                    _mm_shuffle_epi32(colors, 0xAA),
+                    _mm_shuffle_epi32(colors, 0xFF)
+                };
+                for(int k = 0; k < 4; k++) {
+                    Uint32 *run = output + k * scale;
+                    int o = 0;
+                    for(; o + 4 <= scale; o += 4) {
+                        _mm_storeu_si128((__m128i *) (run + o), lanes[k]);
+                    }
+                    if(o < scale) {
+                        _mm_storeu_si128((__m128i *) (run + scale - 4), lanes[k]);
+                    }
+                }
+            }
+        }
+
+        // Selects between two colors with an all ones / all zeros lane mask.
+        __attribute__((target("sse2")))
+        inline __m128i selectSSE2(__m128i mask, __m128i set, __m128i clear)
+        {
+            return _mm_or_si128(_mm_and_si128(mask, set), _mm_andnot_si128(mask, clear));
+        }
+
+        __attribute__((target("sse2")))
+        void expandRowSSE2(Uint64 bits0, Uint64 bits1, const Uint32 *palette, Uint32 *output, int scale)
+        {
+            const __m128i color0 = _mm_set1_epi32(palette[0]);
+            const __m128i color1 = _mm_set1_epi32(palette[1]);
+            const __m128i color2 = _mm_set1_epi32(palette[2]);
+            const __m128i color3 = _mm_set1_epi32(palette[3]);
+            // Lane 0 is the leftmost pixel of a nibble, its most significant bit.
+            const __m128i select = _mm_set_epi32(1, 2, 4, 8);
+
+            for(int x = 0; x < 64; x += 4) {
+                int shift = 60 - x;
+                __m128i nibble0 = _mm_set1_epi32((int) ((bits0 >> shift) & 0xF));
+                __m128i nibble1 = _mm_set1_epi32((int) ((bits1 >> shift) & 0xF));
+                __m128i mask0 = _mm_cmpeq_epi32(_mm_and_si128(nibble0, select), select);
+                __m128i mask1 = _mm_cmpeq_epi32(_mm_and_si128(nibble1, select), select);
+                __m128i low = selectSSE2(mask0, color1, color0);
+                __m128i high = selectSSE2(mask0, color3, color2);
+                replicateSSE2(selectSSE2(mask1, high, low), output + x * scale, scale);
+            }
+        }
+
+        __attribute__((target("sse2")))
+        void smoothSSE2(const unsigned char *indices, unsigned char *smoothed)
+        {
+            for(int y = 0; y < 32; y++) {
+                const unsigned char *above = indices + y * PaddedStride + 1;
+                const unsigned char *row = above + PaddedStride;
+                const unsigned char *below = row + PaddedStride;
+                unsigned char *top = smoothed + (2 * y) * SmoothWidth;
+                unsigned char *bottom = top + SmoothWidth;
+                for(int x = 0; x < 64; x += 16) {
+                    __m128i b = _mm_loadu_si128((const __m128i *) (above + x));
+                    __m128i d = _mm_loadu_si128((const __m128i *) (row + x - 1));
+                    __m128i e = _mm_loadu_si128((const __m128i *) (row + x));
+                    __m128i f = _mm_loadu_si128((const __m128i *) (row + x + 1));
+                    __m128i h = _mm_loadu_si128((const __m128i *) (below + x));
+
+                    __m128i db = _mm_cmpeq_epi8(d, b);
+                    __m128i bf = _mm_cmpeq_epi8(b, f);
+                    __m128i dh = _mm_cmpeq_epi8(d, h);
+                    __m128i hf = _mm_cmpeq_epi8(h, f);
+
+                    // andnot(a, b) is ~a & b.
+                    __m128i e0 = selectSSE2(_mm_andnot_si128(bf, _mm_andnot_si128(dh, db)), d, e);
+                    __m128i e1 = selectSSE2(_mm_andnot_si128(db, _mm_andnot_si128(hf, bf)), f, e);
+                    __m128i e2 = selectSSE2(_mm_andnot_si128(db, _mm_andnot_si128(hf, dh)), d, e);
+                    __m128i e3 = selectSSE2(_mm_andnot_si128(dh, _mm_andnot_si128(bf, hf)), f, e);
+
+                    _mm_storeu_si128((__m128i *) (top + 2 * x), _mm_unpacklo_epi8(e0, e1));
+                    _mm_storeu_si128((__m128i *) (top + 2 * x + 16), _mm_unpackhi_epi8(e0, e1));
+                    _mm_storeu_si128((__m128i *) (bottom + 2 * x), _mm_unpacklo_epi8(e2, e3));
+                    _mm_storeu_si128((__m128i *) (bottom + 2 * x + 16), _mm_unpackhi_epi8(e2, e3));
+                }
+            }
+        }
+
+        // AVX2 kernels.
+
+        // Writes the 8 pixels in colors to output, each repeated scale times.
+        __attribute__((target("avx2")))
+        inline void replicateAVX2(__m256i colors, Uint32 *output, int scale)
+        {
+            if(scale == 1) {
+                _mm256_storeu_si256((__m256i *) output, colors);
+            } else if(scale < 8) {
+                replicateSSE2(_mm256_castsi256_si128(colors), output, scale);
+                replicateSSE2(_mm256_extracti128_si256(colors, 1), output + 4 * scale, scale);
+            } else {
+                for(int k = 0; k < 8; k++) {
+                    __m256i lane = _mm256_permutevar8x32_epi32(colors, _mm256_set1_epi32(k));
+                    Uint32 *run = output + k * scale;
+                    int o = 0;
+                    for(; o + 8 <= scale; o += 8) {
+                        _mm256_storeu_si256((__m256i *) (run + o), lane);
+                    }
+                    if(o < scale) {
+                        _mm256_storeu_si256((__m256i *) (run + scale - 8), lane);
+                    }
+                }
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void expandRowAVX2(Uint64 bits0, Uint64 bits1, const Uint32 *palette, Uint32 *output, int scale)
+        {
+            // The palette lives in a register and the 2 bit indices pick from it.
+            const __m256i colors = _mm256_setr_epi32(palette[0], palette[1], palette[2], palette[3],
+                                                     palette[0], palette[1], palette[2], palette[3]);
+            // Lane 0 is the leftmost pixel of a byte, its most significant bit.
+            const __m256i shifts = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+            const __m256i one = _mm256_set1_epi32(1);
+
+            for(int x = 0; x < 64; x += 8) {
+                int shift = 56 - x;
+                __m256i byte0 = _mm256_set1_epi32((int) ((bits0 >> shift) & 0xFF));
+                __m256i byte1 = _mm256_set1_epi32((int) ((bits1 >> shift) & 0xFF));
+                __m256i index = _mm256_or_si256(_mm256_and_si256(_mm256_srlv_epi32(byte0, shifts), one),
+                                                _mm256_slli_epi32(_mm256_and_si256(_mm256_srlv_epi32(byte1, shifts), one), 1));
+                replicateAVX2(_mm256_permutevar8x32_epi32(colors, index), output + x * scale, scale);
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void expandIndicesAVX2(const unsigned char *indices, int count, const Uint32 *palette, Uint32 *output, int scale)
+        {
+            const __m256i colors = _mm256_setr_epi32(palette[0], palette[1], palette[2], palette[3],
+                                                     palette[0], palette[1], palette[2], palette[3]);
+            for(int x = 0; x < count; x += 8) {
+                __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (indices + x)));
+                replicateAVX2(_mm256_permutevar8x32_epi32(colors, index), output + x * scale, scale);
+            }
+        }
+
+#endif
+    }
+
+    Scaler::Scaler(Filter filter, int scale, Kernel kernel)
+        : _filter(filter),
+          _kernel(kernel),
+          _scale(scale < 1 ? 1 : scale),
+          _valid(false)
+    {
+        if(_filter == None) {
+            _scale = 1;
+        } else if(_filter == Smooth) {
+            // Scale2x doubles the image, the rest is done with nearest neighbor.
+            _scale = _scale < 2 ? 2 : _scale & ~0x1;
+            _indices.resize(PaddedStride * PaddedHeight, 0);
+            _smoothed.resize(SmoothWidth * SmoothHeight, 0);
+        }
+
+        if(_kernel == Auto) {
+            _kernel = supported(AVX2) ? AVX2 : supported(SSE2) ? SSE2 : Scalar;
+        } else if(!supported(_kernel)) {
+            LOG(INFO) << _Tag << kernelName(_kernel) << " is not supported on this host, using scalar";
+            _kernel = Scalar;
+        }
+        LOG(INFO) << _Tag << "Scaling by " << _scale << " using the " << kernelName(_kernel) << " kernel";
+    }
+
+    void Scaler::scale(const Uint64 *plane0, const Uint64 *plane1, const Uint32 *palette, Uint32 *output)
+    {
+        if(_filter == None) {
+            return;
+        }
+
+        // Most frames don't change the screen, so skip those.
+        if(_valid &&
+           memcmp(_lastPlanes[0], plane0, sizeof(_lastPlanes[0])) == 0 &&
+           memcmp(_lastPlanes[1], plane1, sizeof(_lastPlanes[1])) == 0 &&
+           memcmp(_lastPalette, palette, sizeof(_lastPalette)) == 0) {
+            return;
+        }
+        memcpy(_lastPlanes[0], plane0, sizeof(_lastPlanes[0]));
+        memcpy(_lastPlanes[1], plane1, sizeof(_lastPlanes[1]));
+        memcpy(_lastPalette, palette, sizeof(_lastPalette));
+        _valid = true;
+
+        int width = outputWidth();
+        size_t rowBytes = width * sizeof(Uint32);
+
+        if(_filter == Nearest) {
+            for(int j = 0; j < Video::Height; j++) {
+                Uint32 *row = output + j * _scale * width;
+                expandRow(plane0[j], plane1[j], palette, row);
+                for(int s = 1; s < _scale; s++) {
+                    memcpy(row + s * width, row, rowBytes);
+                }
+            }
+            return;
+        }
+
+        // Build the padded palette index image, 8 pixels at a time.
+        const BitsToBytes &table = bitsToBytes();
+        for(int j = 0; j < Video::Height; j++) {
+            unsigned char *row = &_indices[(j + 1) * PaddedStride + 1];
+            for(int k = 0; k < 8; k++) {
+                int shift = 56 - 8 * k;
+                const unsigned char *bytes0 = table.bytes[(plane0[j] >> shift) & 0xFF];
+                const unsigned char *bytes1 = table.bytes[(plane1[j] >> shift) & 0xFF];
+                for(int b = 0; b < 8; b++) {
+                    row[8 * k + b] = bytes0[b] | (bytes1[b] << 1);
+                }
+            }
+            row[-1] = row[0];
+            row[Video::Width] = row[Video::Width - 1];
+        }
+        memcpy(&_indices[0], &_indices[PaddedStride], PaddedStride);
+        memcpy(&_indices[(PaddedHeight - 1) * PaddedStride], &_indices[(PaddedHeight - 2) * PaddedStride], PaddedStride);
+
+        smooth();
+
+        int factor = _scale / 2;
+        for(int j = 0; j < SmoothHeight; j++) {
+            Uint32 *row = output + j * factor * width;
+            expandIndices(&_smoothed[j * SmoothWidth], SmoothWidth, palette, row);
+            for(int s = 1; s < factor; s++) {
+                memcpy(row + s * width, row, rowBytes);
+            }
+        }
+    }
+
+    bool Scaler::enabled() const
+    {
+        return _filter != None;
+    }
+
+    int Scaler::outputWidth() const
+    {
+        return Video::Width * _scale;
+    }
+
+    int Scaler::outputHeight() const
+    {
+        return Video::Height * _scale;
+    }
+
+    Scaler::Kernel Scaler::kernel() const
+    {
+        return _kernel;
+    }
+
+    void Scaler::expandRow(Uint64 bits0, Uint64 bits1, const Uint32 *palette, Uint32 *output) const
+    {
+        switch(_kernel) {
+#ifdef CHIP8_SCALER_X86
+            case AVX2:
+                expandRowAVX2(bits0, bits1, palette, output, _scale);
+                break;
+            case SSE2:
+                expandRowSSE2(bits0, bits1, palette, output, _scale);
+                break;
+#endif
+            default:
+                expandRowScalar(bits0, bits1, palette, output, _scale);
+                break;
+        }
+    }
+
+    void Scaler::smooth()
+    {
+        switch(_kernel) {
+#ifdef CHIP8_SCALER_X86
+            case AVX2:
+            case SSE2:
+                // 64 byte rows fill SSE2 registers exactly, AVX2 buys nothing here.
+                smoothSSE2(&_indices[0], &_smoothed[0]);
+                break;
+#endif
+            default:
+                smoothScalar(&_indices[0], &_smoothed[0]);
+                break;
+        }
+    }
+
+    void Scaler::expandIndices(const unsigned char *indices, int count, const Uint32 *palette, Uint32 *output) const
+    {
+        switch(_kernel) {
+#ifdef CHIP8_SCALER_X86
+            case AVX2:
+                expandIndicesAVX2(indices, count, palette, output, _scale / 2);
+                break;
+#endif
+            default:
+                // SSE2 has no way to look up 32 bit values by index, so it uses
+                // the scalar path here.
+                expandIndicesScalar(indices, count, palette, output, _scale / 2);
+                break;
+        }
+    }
+
+    bool Scaler::parseFilter(const std::string &name, Filter &filter)
+    {
+        if(name == "none") {
+            filter = None;
+        } else if(name == "nearest") {
+            filter = Nearest;
+        } else if(name == "smooth") {
+            filter = Smooth;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool Scaler::parseKernel(const std::string &name, Kernel &kernel)
+    {
+        if(name == "auto") {
+            kernel = Auto;
+        } else if(name == "scalar") {
+            kernel = Scalar;
+        } else if(name == "sse2") {
+            kernel = SSE2;
+        } else if(name == "avx2") {
+            kernel = AVX2;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char * Scaler::kernelName(Kernel kernel)
+    {
+        switch(kernel) {
+            case Auto:
+                return "auto";
+            case Scalar:
+                return "scalar";
+            case SSE2:
+                return "sse2";
+            case AVX2:
+                return "avx2";
+        }
+        return "unknown";
+    }
+
+    bool Scaler::supported(Kernel kernel)
+    {
+        switch(kernel) {
+            case Auto:
+            case Scalar:
+                return true;
+#ifdef CHIP8_SCALER_X86
+            case SSE2:
+                return __builtin_cpu_supports("sse2");
+            case AVX2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,308 @@
+#include <Scheduler.hpp>
+
+#include <glog/logging.h>
+
+namespace Chip8
+{
+    const std::string Scheduler::_Tag = "Scheduler:";
+
+    Scheduler::Session::Session(unsigned int id, std::unique_ptr<Machine> machine)
+        : _id(id),
+          _machine(std::move(machine)),
+          _keys(0),
+          _status(Active),
+          _removed(false),
+          _appliedKeys(0),
+          _worker(0)
+    {
+    }
+
+    unsigned int Scheduler::Session::id() const
+    {
+        return _id;
+    }
+
+    Machine & Scheduler::Session::machine()
+    {
+        return *_machine;
+    }
+
+    bool Scheduler::Sleeper::operator<(const Sleeper &other) const
+    {
+        return deadline > other.deadline;
+    }
+
+    Scheduler::Scheduler(unsigned int workers, double hz)
+        : _period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz))),
+          _running(false),
+          _idleWorkers(0),
+          _nextId(1),
+          _nextWorker(0),
+          _parked(0),
+          _frames(0),
+          _late(0),
+          _steals(0)
+    {
+        for(unsigned int i = 0; i < (workers < 1 ? 1 : workers); i++) {
+            std::unique_ptr<Worker> worker(new Worker());
+            worker->idle = false;
+            worker->poked = false;
+            _workers.push_back(std::move(worker));
+        }
+    }
+
+    Scheduler::~Scheduler()
+    {
+        stop();
+    }
+
+    void Scheduler::setFrameCallback(const FrameCallback &callback)
+    {
+        _onFrame = callback;
+    }
+
+    void Scheduler::start()
+    {
+        if(_running.load()) {
+            return;
+        }
+        _running.store(true);
+        for(unsigned int i = 0; i < _workers.size(); i++) {
+            _workers[i]->thread = std::thread(&Scheduler::run, this, i);
+        }
+        LOG(INFO) << _Tag << "Started " << _workers.size() << " workers";
+    }
+
+    void Scheduler::stop()
+    {
+        if(!_running.load()) {
+            return;
+        }
+        _running.store(false);
+        for(unsigned int i = 0; i < _workers.size(); i++) {
+            std::lock_guard<std::mutex> lock(_workers[i]->mutex);
+            _workers[i]->wake.notify_all();
+        }
+        for(unsigned int i = 0; i < _workers.size(); i++) {
+            _workers[i]->thread.join();
+        }
+    }
+
+    bool Scheduler::isRunning() const
+    {
+        return _running.load();
+    }
+
+    std::shared_ptr<Scheduler::Session> Scheduler::add(std::unique_ptr<Machine> machine)
+    {
+        std::shared_ptr<Session> session;
+        unsigned int worker = 0;
+        {
+            std::lock_guard<std::mutex> lock(_sessionsMutex);
+            session.reset(new Session(_nextId++, std::move(machine)));
+            _sessions[session->_id] = session;
+            worker = _nextWorker++ % _workers.size();
+        }
+        session->_deadline = Clock::now();
+        session->_worker = worker;
+        makeReady(worker, session);
+        return session;
+    }
+
+    void Scheduler::setKeys(const std::shared_ptr<Session> &session, Uint16 keys)
+    {
+        session->_keys.store(keys);
+        // Whoever moves the session out of Parked queues it, so it is
+        // queued once even if its worker parks it at the same time.
+        int expected = Session::Parked;
+        if(session->_status.compare_exchange_strong(expected, Session::Active)) {
+            _parked.fetch_sub(1);
+            makeReady(session->_worker, session);
+        }
+    }
+
+    void Scheduler::remove(const std::shared_ptr<Session> &session)
+    {
+        session->_removed.store(true);
+        {
+            std::lock_guard<std::mutex> lock(_sessionsMutex);
+            _sessions.erase(session->_id);
+        }
+        // A queued session is dropped by the worker that next takes it.
+        int expected = Session::Parked;
+        if(session->_status.compare_exchange_strong(expected, Session::Removed)) {
+            _parked.fetch_sub(1);
+        }
+    }
+
+    Scheduler::Stats Scheduler::stats() const
+    {
+        Stats stats;
+        {
+            std::lock_guard<std::mutex> lock(_sessionsMutex);
+            stats.sessions = _sessions.size();
+        }
+        stats.parked = _parked.load();
+        stats.frames = _frames.load();
+        stats.late = _late.load();
+        stats.steals = _steals.load();
+        return stats;
+    }
+
+    void Scheduler::run(unsigned int index)
+    {
+        Worker &worker = *_workers[index];
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        while(_running.load()) {
+            Clock::time_point now = Clock::now();
+            while(!worker.sleeping.empty() && worker.sleeping.top().deadline <= now) {
+                worker.ready.push_back(worker.sleeping.top().session);
+                worker.sleeping.pop();
+            }
+
+            std::shared_ptr<Session> session;
+            bool spare = false;
+            if(!worker.ready.empty()) {
+                session = worker.ready.front();
+                worker.ready.pop_front();
+                spare = !worker.ready.empty();
+            } else {
+                lock.unlock();
+                session = steal(index);
+                lock.lock();
+            }
+            if(session) {
+                lock.unlock();
+                if(spare && _idleWorkers.load() > 0) {
+                    pokeIdle(index);
+                }
+                runFrame(index, session);
+                lock.lock();
+                continue;
+            }
+
+            // Sessions pushed or pokes sent while the lock was released for
+            // stealing are seen here, so none are slept through.
+            if(!worker.ready.empty() || worker.poked) {
+                worker.poked = false;
+                continue;
+            }
+            worker.idle = true;
+            _idleWorkers.fetch_add(1);
+            if(worker.sleeping.empty()) {
+                worker.wake.wait(lock);
+            } else {
+                worker.wake.wait_until(lock, worker.sleeping.top().deadline);
+            }
+            _idleWorkers.fetch_sub(1);
+            worker.idle = false;
+        }
+    }
+
+    std::shared_ptr<Scheduler::Session> Scheduler::steal(unsigned int thief)
+    {
+        Clock::time_point now = Clock::now();
+        for(unsigned int i = 1; i < _workers.size(); i++) {
+            Worker &victim = *_workers[(thief + i) % _workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            // The newest ready session, or one due in the heap of a worker
+            // busy with a long frame.
+            std::shared_ptr<Session> session;
+            if(!victim.ready.empty()) {
+                session = victim.ready.back();
+                victim.ready.pop_back();
+            } else if(!victim.sleeping.empty() && victim.sleeping.top().deadline <= now) {
+                session = victim.sleeping.top().session;
+                victim.sleeping.pop();
+            }
+            if(session) {
+                _steals.fetch_add(1, std::memory_order_relaxed);
+                return session;
+            }
+        }
+        return std::shared_ptr<Session>();
+    }
+
+    void Scheduler::pokeIdle(unsigned int busy)
+    {
+        for(unsigned int i = 1; i < _workers.size(); i++) {
+            Worker &worker = *_workers[(busy + i) % _workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if(worker.idle && !worker.poked) {
+                worker.poked = true;
+                worker.wake.notify_one();
+                return;
+            }
+        }
+    }
+
+    void Scheduler::runFrame(unsigned int index, const std::shared_ptr<Session> &session)
+    {
+        Session &s = *session;
+        if(s._removed.load()) {
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        if(s._parkedAt != Clock::time_point()) {
+            s._machine->idle((unsigned int) ((now - s._parkedAt) / _period));
+            s._parkedAt = Clock::time_point();
+            s._deadline = now;
+        }
+        if(now - s._deadline > _period) {
+            _late.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Uint16 keys = s._keys.load();
+        s._machine->setKeys(keys);
+        s._appliedKeys = keys;
+        s._machine->stepFrame();
+        _frames.fetch_add(1, std::memory_order_relaxed);
+        if(_onFrame) {
+            _onFrame(s);
+        }
+
+        // The session stays with the worker that ran it last.
+        s._worker = index;
+        if(s._machine->isWaitingForKey() && s._machine->timers().getSoundTimer() == 0) {
+            s._parkedAt = Clock::now();
+            _parked.fetch_add(1);
+            s._status.store(Session::Parked);
+            // setKeys or remove may have run before the session was parked,
+            // in which case they didn't see it parked and it must not sleep.
+            if(s._removed.load() || s._keys.load() != s._appliedKeys) {
+                int expected = Session::Parked;
+                if(s._status.compare_exchange_strong(expected, Session::Active)) {
+                    _parked.fetch_sub(1);
+                    if(!s._removed.load()) {
+                        makeReady(index, session);
+                    }
+                }
+            }
+            return;
+        }
+
+        // A session that fell more than a frame behind starts again from
+        // now rather than rushing through the frames it missed.
+        s._deadline += _period;
+        if(s._deadline < now - _period) {
+            s._deadline = now;
+        }
+        Worker &worker = *_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        Sleeper sleeper;
+        sleeper.deadline = s._deadline;
+        sleeper.session = session;
+        worker.sleeping.push(sleeper);
+    }
+
+    void Scheduler::makeReady(unsigned int index, const std::shared_ptr<Session> &session)
+    {
+        Worker &worker = *_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.ready.push_back(session);
+        if(worker.idle) {
+            worker.wake.notify_one();
+        }
+    }
+}
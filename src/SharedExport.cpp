@@ -0,0 +1,155 @@
+#include <SharedExport.hpp>
+#include <Video.hpp>
+
+#include <glog/logging.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Chip8
+{
+    const std::string SharedExport::_Tag = "SharedExport:";
+    const Uint32 SharedExport::Magic = 0x4D533843;
+    const Uint32 SharedExport::Version = 1;
+    const Uint32 SharedExport::HasRgba = 0x1;
+
+    namespace
+    {
+        // The offsets are the documented format, not just what the compiler
+        // happens to pick.
+        static_assert(offsetof(SharedExport::Layout, sequence) == 64, "Layout changed");
+        static_assert(offsetof(SharedExport::Layout, planes) == 128, "Layout changed");
+        static_assert(offsetof(SharedExport::Layout, rgba) == 640, "Layout changed");
+        static_assert(offsetof(SharedExport::Layout, input) == 8832, "Layout changed");
+        static_assert(sizeof(SharedExport::Layout) == 8896, "Layout changed");
+
+        const int MaxReadTries = 100000;
+    }
+
+    SharedExport::SharedExport()
+        : _layout(0),
+          _rgba(false)
+    {
+    }
+
+    SharedExport::~SharedExport()
+    {
+        close();
+    }
+
+    bool SharedExport::open(const std::string &name, bool rgba)
+    {
+        if(isOpen()) {
+            LOG(INFO) << _Tag << "Already exporting to " << _name;
+            return false;
+        }
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+        if(fd < 0) {
+            LOG(INFO) << _Tag << "Failed to open shared memory " << name << " - " << strerror(errno);
+            return false;
+        }
+        void *memory = MAP_FAILED;
+        if(ftruncate(fd, sizeof(Layout)) == 0) {
+            memory = mmap(0, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        int mapError = errno;
+        ::close(fd);
+        if(memory == MAP_FAILED) {
+            LOG(INFO) << _Tag << "Failed to map shared memory " << name << " - " << strerror(mapError);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // A reader that attached to a segment left by an earlier run sees
+        // the magic disappear until the new header is complete.
+        _layout = (Layout *) memory;
+        __atomic_store_n(&_layout->magic, 0, __ATOMIC_RELAXED);
+        Uint32 input = _layout->input;
+        memset(_layout, 0, sizeof(Layout));
+        _layout->input = input;
+        _layout->version = Version;
+        _layout->size = sizeof(Layout);
+        _layout->flags = rgba ? HasRgba : 0;
+        _layout->width = Video::Width;
+        _layout->height = Video::Height;
+        __atomic_store_n(&_layout->magic, Magic, __ATOMIC_RELEASE);
+
+        _name = name;
+        _rgba = rgba;
+        LOG(INFO) << _Tag << "Exporting frames to " << name;
+        return true;
+    }
+
+    void SharedExport::close()
+    {
+        if(!isOpen()) {
+            return;
+        }
+        munmap(_layout, sizeof(Layout));
+        shm_unlink(_name.c_str());
+        _layout = 0;
+        _name.clear();
+    }
+
+    bool SharedExport::isOpen() const
+    {
+        return _layout != 0;
+    }
+
+    void SharedExport::publish(Machine &machine, Uint64 frame)
+    {
+        if(!isOpen()) {
+            return;
+        }
+        Video &video = machine.video();
+        Uint64 screenHash = video.frameHash();
+        // Converted before the write starts, so the sequence is odd only for
+        // the copies.
+        const Uint32 *pixels = _rgba ? video.getPixels() : 0;
+
+        Uint32 sequence = _layout->sequence;
+        __atomic_store_n(&_layout->sequence, sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        _layout->frame = frame;
+        _layout->screenHash = screenHash;
+        _layout->planeMask = video.getPlaneMask();
+        _layout->sound = machine.timers().getSoundTimer() > 0 ? 1 : 0;
+        _layout->keys = machine.input().getKeys();
+        memcpy(_layout->planes[0], video.getPlane(0), sizeof(_layout->planes[0]));
+        memcpy(_layout->planes[1], video.getPlane(1), sizeof(_layout->planes[1]));
+        if(pixels != 0) {
+            memcpy(_layout->rgba, pixels, sizeof(_layout->rgba));
+        }
+
+        __atomic_store_n(&_layout->sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+    Uint16 SharedExport::readKeys() const
+    {
+        if(!isOpen()) {
+            return 0;
+        }
+        return (Uint16) __atomic_load_n(&_layout->input, __ATOMIC_RELAXED);
+    }
+
+    bool SharedExport::read(const Layout &shared, Layout &copy)
+    {
+        for(int i = 0; i < MaxReadTries; i++) {
+            Uint32 before = __atomic_load_n(&shared.sequence, __ATOMIC_ACQUIRE);
+            if(before & 1) {
+                continue;
+            }
+            memcpy(&copy, &shared, offsetof(Layout, input));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&shared.sequence, __ATOMIC_RELAXED) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -1,4 +1,6 @@
 #include <Timers.hpp>
+#include <Machine.hpp>
+#include <Metrics.hpp>
 
 namespace Chip8
 {
@@ -10,8 +12,19 @@ namespace Chip8
 
     Timers & Timers::instance()
     {
-        static Timers timers;
-        return timers;
+        return Machine::current().timers();
+    }
+
+    void Timers::saveState(State &state) const
+    {
+        state.dt = _dt;
+        state.st = _st;
+    }
+
+    void Timers::loadState(const State &state)
+    {
+        _dt = state.dt;
+        _st = state.st;
     }
     
     unsigned int Timers::getDelayTimer()
@@ -36,6 +49,7 @@ namespace Chip8
 
     void Timers::step()
     {
+        CHIP8_METRIC_ADD(timerTicks, 1);
         if(_dt > 0) {
             _dt--;
         }
@@ -44,5 +58,12 @@ namespace Chip8
         }
     }
 
+    void Timers::step(unsigned int frames)
+    {
+        CHIP8_METRIC_ADD(timerTicks, frames);
+        _dt = _dt > frames ? _dt - frames : 0;
+        _st = _st > frames ? _st - frames : 0;
+    }
+
 }
 
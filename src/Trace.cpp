@@ -0,0 +1,309 @@
+#include <Trace.hpp>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+namespace Chip8
+{
+    const std::string Trace::_Tag = "Trace:";
+    const std::string TraceWriter::_Tag = "TraceWriter:";
+    const std::string TraceReader::_Tag = "TraceReader:";
+
+    namespace
+    {
+        const Uint8 Magic[4] = {'C', '8', 'T', 'R'};
+        const Uint8 Version = 1;
+
+        // Each step is a 16 bit PC and a 64 bit hash.
+        const size_t StepSize = 2 + 8;
+        const size_t BufferedSteps = 4096;
+
+        // A day of frames. A frame count from a file is checked against this
+        // before anything is allocated for it.
+        const Uint32 MaxFrames = 60 * 60 * 60 * 24;
+
+        // Key masks are read this many frames at a time, so a count the
+        // file can't back fails on the first missing chunk.
+        const size_t KeyChunkFrames = 4096;
+
+        // Differences listed before the rest are only counted.
+        const int MaxListed = 32;
+
+        const Uint64 FnvOffset = 0xCBF29CE484222325ULL;
+        const Uint64 FnvPrime = 0x100000001B3ULL;
+
+        Uint64 mix(Uint64 hash, Uint64 value)
+        {
+            hash ^= value;
+            return hash * FnvPrime;
+        }
+
+        void put(std::vector<Uint8> &buffer, Uint64 value, int bytes)
+        {
+            for(int i = 0; i < bytes; i++) {
+                buffer.push_back((value >> (i * 8)) & 0xFF);
+            }
+        }
+
+        Uint64 get(const Uint8 *data, int bytes)
+        {
+            Uint64 value = 0;
+            for(int i = 0; i < bytes; i++) {
+                value |= (Uint64) data[i] << (i * 8);
+            }
+            return value;
+        }
+
+        bool readExactly(gzFile file, void *data, unsigned int size)
+        {
+            return gzread(file, data, size) == (int) size;
+        }
+
+        // Lists one differing value, returns 1 if it differs.
+        int compare(const char *name, Uint64 expected, Uint64 actual, int &listed, std::ostream &out)
+        {
+            if(expected == actual) {
+                return 0;
+            }
+            if(listed++ < MaxListed) {
+                char line[96];
+                snprintf(line, sizeof(line), "%s: expected 0x%llX actual 0x%llX", name,
+                         (unsigned long long) expected, (unsigned long long) actual);
+                out << line << std::endl;
+            }
+            return 1;
+        }
+    }
+
+    Uint64 Trace::hashState(const Machine::State &state)
+    {
+        Uint64 hash = FnvOffset;
+
+        // Memory dominates, so it is mixed 8 bytes at a time.
+        const unsigned char *memory = state.memory.memory;
+        for(size_t i = 0; i < sizeof(state.memory.memory); i += 8) {
+            Uint64 word;
+            memcpy(&word, memory + i, sizeof(word));
+            hash = mix(hash, word);
+        }
+        for(int i = 0; i < 0x10; i++) {
+            hash = mix(hash, state.memory.registers[i]);
+        }
+        hash = mix(hash, state.memory.addressRegister);
+
+        hash = mix(hash, (Uint32) state.cpu.pc);
+        hash = mix(hash, (Uint32) state.cpu.sp);
+        for(int i = 0; i < 16; i++) {
+            hash = mix(hash, state.cpu.stack[i]);
+        }
+        hash = mix(hash, state.cpu.random);
+
+        hash = mix(hash, state.timers.dt);
+        hash = mix(hash, state.timers.st);
+
+        for(int p = 0; p < 2; p++) {
+            for(int row = 0; row < 32; row++) {
+                hash = mix(hash, state.video.planes[p][row]);
+            }
+        }
+        hash = mix(hash, state.video.planeMask);
+
+        hash = mix(hash, state.input.keys);
+        hash = mix(hash, state.input.isWaitingForKeyPress);
+        hash = mix(hash, state.input.keyPressRegister);
+        return hash;
+    }
+
+    int Trace::diff(const Machine::State &expected, const Machine::State &actual, std::ostream &out)
+    {
+        int listed = 0;
+        int count = 0;
+        char name[32];
+
+        count += compare("pc", expected.cpu.pc, actual.cpu.pc, listed, out);
+        for(int i = 0; i < 0x10; i++) {
+            snprintf(name, sizeof(name), "V%X", i);
+            count += compare(name, expected.memory.registers[i], actual.memory.registers[i], listed, out);
+        }
+        count += compare("I", expected.memory.addressRegister, actual.memory.addressRegister, listed, out);
+        count += compare("sp", (Uint32) expected.cpu.sp, (Uint32) actual.cpu.sp, listed, out);
+        for(int i = 0; i < 16; i++) {
+            snprintf(name, sizeof(name), "stack[%d]", i);
+            count += compare(name, expected.cpu.stack[i], actual.cpu.stack[i], listed, out);
+        }
+        count += compare("random", expected.cpu.random, actual.cpu.random, listed, out);
+        count += compare("dt", expected.timers.dt, actual.timers.dt, listed, out);
+        count += compare("st", expected.timers.st, actual.timers.st, listed, out);
+        count += compare("keys", expected.input.keys, actual.input.keys, listed, out);
+        count += compare("waiting", expected.input.isWaitingForKeyPress, actual.input.isWaitingForKeyPress, listed, out);
+        count += compare("key register", expected.input.keyPressRegister, actual.input.keyPressRegister, listed, out);
+        count += compare("planes", expected.video.planeMask, actual.video.planeMask, listed, out);
+        for(int p = 0; p < 2; p++) {
+            for(int row = 0; row < 32; row++) {
+                snprintf(name, sizeof(name), "plane %d row %d", p, row);
+                count += compare(name, expected.video.planes[p][row], actual.video.planes[p][row], listed, out);
+            }
+        }
+        for(unsigned int address = 0; address < sizeof(expected.memory.memory); address++) {
+            snprintf(name, sizeof(name), "memory[0x%X]", address);
+            count += compare(name, expected.memory.memory[address], actual.memory.memory[address], listed, out);
+        }
+
+        if(listed > MaxListed) {
+            out << "... and " << (listed - MaxListed) << " more" << std::endl;
+        }
+        return count;
+    }
+
+    TraceWriter::TraceWriter()
+        : _file(0),
+          _failed(false)
+    {
+    }
+
+    TraceWriter::~TraceWriter()
+    {
+        close();
+    }
+
+    bool TraceWriter::open(const std::string &path, const TraceHeader &header)
+    {
+        close();
+        if(header.keys.size() > MaxFrames) {
+            LOG(INFO) << _Tag << "A trace holds at most " << MaxFrames << " frames";
+            return false;
+        }
+        _file = gzopen(path.c_str(), "wb");
+        if(_file == 0) {
+            LOG(INFO) << _Tag << "Failed to create " << path;
+            return false;
+        }
+        _failed = false;
+
+        _buffer.clear();
+        for(size_t i = 0; i < sizeof(Magic); i++) {
+            _buffer.push_back(Magic[i]);
+        }
+        _buffer.push_back(Version);
+        put(_buffer, header.romHash, 8);
+        put(_buffer, header.cycles, 4);
+        put(_buffer, header.keys.size(), 4);
+        for(size_t i = 0; i < header.keys.size(); i++) {
+            put(_buffer, header.keys[i], 2);
+        }
+        flush();
+        return !_failed;
+    }
+
+    void TraceWriter::step(Uint16 pc, Uint64 hash)
+    {
+        put(_buffer, pc, 2);
+        put(_buffer, hash, 8);
+        if(_buffer.size() >= BufferedSteps * StepSize) {
+            flush();
+        }
+    }
+
+    bool TraceWriter::close()
+    {
+        if(_file == 0) {
+            return !_failed;
+        }
+        flush();
+        if(gzclose((gzFile) _file) != Z_OK) {
+            _failed = true;
+        }
+        _file = 0;
+        return !_failed;
+    }
+
+    void TraceWriter::flush()
+    {
+        if(!_buffer.empty() && gzwrite((gzFile) _file, &_buffer[0], _buffer.size()) != (int) _buffer.size()) {
+            LOG(INFO) << _Tag << "Failed to write trace";
+            _failed = true;
+        }
+        _buffer.clear();
+    }
+
+    TraceReader::TraceReader()
+        : _file(0)
+    {
+    }
+
+    TraceReader::~TraceReader()
+    {
+        close();
+    }
+
+    bool TraceReader::open(const std::string &path)
+    {
+        close();
+        gzFile file = gzopen(path.c_str(), "rb");
+        if(file == 0) {
+            LOG(INFO) << _Tag << "Failed to open " << path;
+            return false;
+        }
+        _file = file;
+
+        Uint8 fixed[4 + 1 + 8 + 4 + 4];
+        if(!readExactly(file, fixed, sizeof(fixed)) || memcmp(fixed, Magic, sizeof(Magic)) != 0 || fixed[4] != Version) {
+            LOG(INFO) << _Tag << path << " is not a version " << (int) Version << " trace";
+            close();
+            return false;
+        }
+        _header.romHash = get(fixed + 5, 8);
+        _header.cycles = (Uint32) get(fixed + 13, 4);
+        Uint32 frames = (Uint32) get(fixed + 17, 4);
+
+        if(frames > MaxFrames) {
+            LOG(INFO) << _Tag << path << " claims " << frames << " frames, more than the " << MaxFrames << " allowed";
+            close();
+            return false;
+        }
+
+        _header.keys.clear();
+        std::vector<Uint8> keys(KeyChunkFrames * 2);
+        for(size_t first = 0; first < frames; first += KeyChunkFrames) {
+            size_t count = std::min(KeyChunkFrames, (size_t) frames - first);
+            if(!readExactly(file, &keys[0], (unsigned int) (count * 2))) {
+                LOG(INFO) << _Tag << path << " is truncated";
+                _header.keys.clear();
+                close();
+                return false;
+            }
+            for(size_t i = 0; i < count; i++) {
+                _header.keys.push_back((Uint16) get(&keys[i * 2], 2));
+            }
+        }
+        return true;
+    }
+
+    const TraceHeader & TraceReader::header() const
+    {
+        return _header;
+    }
+
+    bool TraceReader::next(Uint16 &pc, Uint64 &hash)
+    {
+        Uint8 step[StepSize];
+        if(_file == 0 || !readExactly((gzFile) _file, step, sizeof(step))) {
+            return false;
+        }
+        pc = (Uint16) get(step, 2);
+        hash = get(step + 2, 8);
+        return true;
+    }
+
+    void TraceReader::close()
+    {
+        if(_file != 0) {
+            gzclose((gzFile) _file);
+            _file = 0;
+        }
+    }
+}
@@ -1,118 +1,246 @@
 #include <Video.hpp>
+#include <Machine.hpp>
 #include <Memory.hpp>
 #include <BitUtils.hpp>
+#include <Metrics.hpp>
 
 #include <glog/logging.h>
+#include <string.h>
 
-namespace Chip8 
+namespace Chip8
 {
 
     const int Video::Width = 64;
     const int Video::Height = 32;
     const int Video::SpriteWidth = 8;
+    const int Video::Planes = 2;
 
     const std::string Video::_Tag = "Video:";
 
+    namespace
+    {
+        // A bit for each of the 32 rows.
+        const Uint32 AllRows = 0xFFFFFFFF;
+    }
+
     Video::Video()
-        : _format(0)
+        : _planeMask(0x1),
+          _dirty(true),
+          _frameHash(0),
+          _format(0)
     {
+        for(int p = 0; p < Planes; p++) {
+            for(int j = 0; j < Height; j++) {
+                _planes[p][j] = 0;
+                _rowHashes[p][j] = 0;
+            }
+            _dirtyRows[p] = 0;
+        }
+
+        // Black background, white for plane 0 so plain Chip8 ROMs look the
+        // same as before, and greys for the XO-CHIP plane combinations.
+        setPaletteColor(0, 0, 0, 0);
+        setPaletteColor(1, 255, 255, 255);
+        setPaletteColor(2, 170, 170, 170);
+        setPaletteColor(3, 85, 85, 85);
     }
 
     Video & Video::instance()
     {
-        static Video instance;
-        return instance;
+        return Machine::current().video();
+    }
+
+    void Video::saveState(State &state) const
+    {
+        memcpy(state.planes, _planes, sizeof(_planes));
+        state.planeMask = _planeMask;
+    }
+
+    void Video::loadState(const State &state)
+    {
+        memcpy(_planes, state.planes, sizeof(_planes));
+        _planeMask = state.planeMask;
+        _dirty = true;
+        for(int p = 0; p < Planes; p++) {
+            _dirtyRows[p] = AllRows;
+        }
     }
 
     Uint32 * Video::getPixels()
     {
+        if(_dirty) {
+            copyDataToPixels();
+        }
         return _pixels;
     }
-            
-    void Video::drawSprite(int x, int y, const unsigned char *sprite, int height)
+
+    Uint64 Video::frameHash()
     {
-        // Wrap when the coordinates are negative.
-        if(x < 0) {
-            x = (Width - 1) + x;
+        for(int p = 0; p < Planes; p++) {
+            Uint32 rows = _dirtyRows[p];
+            while(rows != 0) {
+                int j = __builtin_ctz(rows);
+                rows &= rows - 1;
+
+                // Blank rows hash to 0, so a blank screen needs no rows hashed.
+                Uint64 row = _planes[p][j];
+                Uint64 hash = row == 0 ? 0 : BitUtils::mix(row ^ BitUtils::mix(p * Height + j + 1));
+                _frameHash ^= _rowHashes[p][j] ^ hash;
+                _rowHashes[p][j] = hash;
+            }
+            _dirtyRows[p] = 0;
         }
-        if(y < 0) {
-            y = (Height - 1) + y;
+        return _frameHash;
+    }
+
+    void Video::drawSprite(int x, int y, const unsigned char *sprite, int height)
+    {
+        // Wrap the coordinates onto the screen.
+        x = ((x % Width) + Width) % Width;
+        y = ((y % Height) + Height) % Height;
+
+        VLOG(1) << _Tag << "Drawing sprite to location (" << x << ", " << y << ")";
+
+        // Every selected plane gets its own height bytes of sprite data, in
+        // plane order.
+        bool collision = false;
+        for(int p = 0; p < Planes; p++) {
+            if(BitUtils::bitQuery(_planeMask, p) == 0x1) {
+                collision |= xorSprite(_planes[p], x, y, sprite, height);
+                markRows(p, y, height);
+                sprite += height;
+            }
         }
 
-        LOG(INFO) << _Tag << "Drawing sprite to location (" << x << ", " << y << ")";
+        // If the draw causes any pixels to be set from 1 to 0, then
+        // register F is set to 1, otherwise it is cleared.
+        if(!Memory::instance().setRegister(0xF, collision ? 0x1 : 0x0)) {
+            LOG(INFO) << _Tag << "Failed to set collision flag in register " << 0xF;
+        }
+        _dirty = true;
+        CHIP8_METRIC_ADD(draws, 1);
+        CHIP8_METRIC_ADD(collisions, collision ? 1 : 0);
+    }
 
-        // Start at point x, y draw the sprite
+    bool Video::xorSprite(Uint64 *plane, int x, int y, const unsigned char *sprite, int height)
+    {
+        Uint64 collision = 0;
         for(int j = 0; j < height; j++) {
-            for(int i = 0; i < SpriteWidth; i++) {
-                // Wrap when coordinates are greater than Width or Height.
-                int screenPixelX = x + i;
-                if(x > (Width - 1)) {
-                    screenPixelX = screenPixelX % (Width - 1);
-                }
-                int screenPixelY = y + j;
-                if(y > (Height - 1)) {
-                    screenPixelY = screenPixelY % (Height - 1);
-                }
-                screenPixelY *= Width;
-                int screenPixelIndex = screenPixelX + screenPixelY;
-                int spritePixelIndex = i + (j * SpriteWidth);
-                unsigned char screenPixel = _data[screenPixelIndex];
-
-                // The sprite pixel index is the exact bit to grab from the sprite.
-                // However the sprite is stored in byte chunks, so need to divide by SpriteWidth
-                // to grab the correct byte, and then bitquery the correct bit to get the
-                // pixel.
-                unsigned char spritePixel = BitUtils::bitQuery(sprite[spritePixelIndex / SpriteWidth], SpriteWidth - 1 - i);
-
-                // Chip8 draws sprites by xoring the pixel and saving the result.
-                // 1 means the pixel is active, 0 means the pixel is inactive.
-                // If the draw causes any pixels to be set from 1 to 0, then
-                // register F needs to be set to 1.
-                unsigned char result = screenPixel ^ spritePixel;
-                _data[screenPixelIndex] = result;
-                
-                if(screenPixel == 0x1 && result == 0x0) {
-                    if(!Memory::instance().setRegister(0xF, 0x1)) {
-                        LOG(INFO) << _Tag << "Failed to set data " << 0x1 << " to register " << 0xF;
-                    }
+            // Place the sprite byte at the left edge of a row word and rotate
+            // it into position, which wraps pixels past the right edge around
+            // to the left edge.
+            Uint64 row = BitUtils::rotateRight((Uint64) sprite[j] << (Width - SpriteWidth), x);
+            Uint64 &screen = plane[(y + j) % Height];
+
+            // Chip8 draws sprites by xoring the pixels and saving the result.
+            collision |= screen & row;
+            screen ^= row;
+        }
+        return collision != 0;
+    }
+
+    void Video::clearScreen()
+    {
+        for(int p = 0; p < Planes; p++) {
+            if(BitUtils::bitQuery(_planeMask, p) == 0x1) {
+                for(int j = 0; j < Height; j++) {
+                    _planes[p][j] = 0;
                 }
+                _dirtyRows[p] = AllRows;
             }
         }
-
-        // Copy the data to the screen, after drawing.
-        copyDataToPixels();
+        _dirty = true;
     }
 
-    void Video::clearScreen()
+    void Video::markRows(int p, int y, int height)
     {
-        for(int i = 0; i < Width * Height; i++) {
-            _data[i] = 0;
-        } 
-        copyDataToPixels();
+        if(height >= Height) {
+            _dirtyRows[p] = AllRows;
+            return;
+        }
+        Uint32 rows = (1u << height) - 1;
+        _dirtyRows[p] |= y == 0 ? rows : (rows << y) | (rows >> (Height - y));
     }
-            
+
     void Video::setPixelFormat(SDL_PixelFormat *format)
     {
         _format = format;
+        updatePalette();
+    }
+
+    void Video::setPaletteColor(int index, Uint8 r, Uint8 g, Uint8 b)
+    {
+        if(index < 0 || index > 3) {
+            LOG(INFO) << _Tag << "Invalid palette index " << index;
+            return;
+        }
+        _colors[index][0] = r;
+        _colors[index][1] = g;
+        _colors[index][2] = b;
+        updatePalette();
+    }
+
+    void Video::getPaletteColor(int index, Uint8 &r, Uint8 &g, Uint8 &b) const
+    {
+        r = _colors[index & 0x3][0];
+        g = _colors[index & 0x3][1];
+        b = _colors[index & 0x3][2];
+    }
+
+    void Video::selectPlanes(unsigned char mask)
+    {
+        _planeMask = mask & 0x3;
+    }
+
+    int Video::selectedPlaneCount() const
+    {
+        return BitUtils::bitQuery(_planeMask, 0) + BitUtils::bitQuery(_planeMask, 1);
+    }
+
+    unsigned char Video::getPlaneMask() const
+    {
+        return _planeMask;
+    }
+
+    const Uint64 * Video::getPlane(int plane) const
+    {
+        return _planes[plane];
+    }
+
+    const Uint32 * Video::getPalette() const
+    {
+        return _palette;
+    }
+
+    void Video::updatePalette()
+    {
+        if(_format == 0) {
+            return;
+        }
+        for(int i = 0; i < 4; i++) {
+            _palette[i] = SDL_MapRGBA(_format, _colors[i][0], _colors[i][1], _colors[i][2], 255);
+        }
+        _dirty = true;
     }
-            
+
     void Video::copyDataToPixels()
     {
-        // Handle 1 byte at a time
-        for(int i = 0; i < Width * Height; i++) {
-                // White
-                if(_data[i] == 0x1) {
-                    _pixels[i] = SDL_MapRGBA(_format, 255, 255, 255, 255);
-                }
-                // Black
-                else if(_data[i] == 0x0) {
-                    _pixels[i] = SDL_MapRGBA(_format, 0, 0, 0, 255);
-                }
-                // Error
-                else {
-                    LOG(INFO) << _Tag << "Unknown pixel type";
+        if(_format == 0) {
+            return;
+        }
+
+        // Handle one row word of each plane at a time.
+        for(int j = 0; j < Height; j++) {
+            Uint64 plane0 = _planes[0][j];
+            Uint64 plane1 = _planes[1][j];
+            Uint32 *pixels = _pixels + j * Width;
+            for(int i = Width - 1; i >= 0; i--) {
+                pixels[i] = _palette[(plane0 & 0x1) | ((plane1 & 0x1) << 1)];
+                plane0 >>= 1;
+                plane1 >>= 1;
             }
         }
+        _dirty = false;
     }
 
 }
@@ -1,3 +1,4 @@
+#include <Machine.hpp>
 #include <Memory.hpp>
 #include <Cpu.hpp>
 #include <BitUtils.hpp>
@@ -6,48 +7,49 @@
 #include <FileUtils.hpp>
 #include <Timers.hpp>
 #include <Input.hpp>
+#include <Capture.hpp>
+#include <Audio.hpp>
+#include <FramePacer.hpp>
+#include <GdbStub.hpp>
+#include <Metrics.hpp>
+#include <Netplay.hpp>
+#include <Options.hpp>
+#include <RomWatcher.hpp>
+#include <Scaler.hpp>
+#include <SharedExport.hpp>
 
 #include <SDL.h>
 #include <glog/logging.h>
 
+#include <chrono>
 #include <iostream>
-
-void printUsage()
-{
-    std::cout << "Usage: chip8 [romfile]" << std::endl;
-}
+#include <memory>
+#include <vector>
 
 int main(int argc, char *argv[])
 {
     google::InitGoogleLogging(argv[0]);
 
     // Setup the filename
-    if(argc != 2) {
-    	printUsage();
+    Chip8::Options options;
+    if(!options.parse(argc, argv)) {
+    	Chip8::Options::printUsage();
     	return 1;
-    } else {
-        std::string romName = argv[1];
-        LOG(INFO) << "Reading rom " << romName;
-        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
-        LOG(INFO) << "Rom size = " << rom.size();
-        for(unsigned int i = 0; i < rom.size(); i++) {
-            if(!Chip8::Memory::instance().write(Chip8::Memory::StartAddress + i, rom.at(i))) {
-                LOG(INFO) << "Failed to load rom into " << (int) Chip8::Memory::StartAddress + i;
-                std::cout << "Failed to load rom into " << (int) Chip8::Memory::StartAddress + i << std::endl;
-                return 1;
-            }
-        }
-        LOG(INFO) << "Loaded rom";
-        for(unsigned int i = 0; i < rom.size(); i++) {
-            unsigned char data = 0;
-            Chip8::Memory::instance().read(Chip8::Memory::StartAddress + i, data);
-            LOG(INFO) << (int) data;
-        }
+    }
+
+    Chip8::Machine &machine = Chip8::Machine::current();
+    LOG(INFO) << "Reading rom " << options.romName;
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(options.romName);
+    // Boots with the fonts and rom loaded and the Cpu at the start of the rom.
+    if(!machine.reset(rom)) {
+        std::cout << "Failed to load rom " << options.romName << std::endl;
+        return 1;
     }
 
     // Setup SDL.
     // Chip8 has a render size of 64x32 
-    int upScale = 24;
+    int upScale = options.scale;
+    Chip8::Scaler scaler(options.scaler, upScale, options.scalerKernel);
     int error = SDL_Init(SDL_INIT_VIDEO);
     if(error < 0) {
         LOG(FATAL) << "Failed to init SDL - " << SDL_GetError(); 
@@ -57,22 +59,36 @@ int main(int argc, char *argv[])
     if(window == NULL) {
         LOG(FATAL) << "Failed to create window - " << SDL_GetError();
     }
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+
+    // When the CPU scales, the texture is already window sized and any
+    // renderer, including the software one, only has to copy it.
+    int textureWidth = Chip8::Video::Width;
+    int textureHeight = Chip8::Video::Height;
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if(scaler.enabled()) {
+        textureWidth = scaler.outputWidth();
+        textureHeight = scaler.outputHeight();
+        rendererFlags = 0;
+    }
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, rendererFlags);
     if(renderer == NULL) {
         LOG(FATAL) << "Failed to create renderer - " << SDL_GetError();
     }
-    SDL_RenderSetScale(renderer, upScale, upScale);
+    if(!scaler.enabled()) {
+        SDL_RenderSetScale(renderer, upScale, upScale);
+    }
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, 0); 
-    error = SDL_RenderSetLogicalSize(renderer, Chip8::Video::Width, Chip8::Video::Height);
+    error = SDL_RenderSetLogicalSize(renderer, textureWidth, textureHeight);
     if(error < 0) {
         LOG(FATAL) << "Failed to set render size - " << SDL_GetError(); 
     }
 
     // Create the texture that will be drawn to the screen every frame.
-    SDL_Texture *texture  = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, Chip8::Video::Width, Chip8::Video::Height);
+    SDL_Texture *texture  = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
     if(texture == NULL) {
         LOG(FATAL) << "Failed to create texture - " << SDL_GetError();
     }
+    std::vector<Uint32> scaledPixels(textureWidth * textureHeight);
     
     // Make sure to set the correct pixel format for the Video module
     SDL_PixelFormat *format = SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888);
@@ -82,72 +98,292 @@ int main(int argc, char *argv[])
 
     Chip8::Video::instance().setPixelFormat(format);
 
-    // Load fonts into memory
-    for(unsigned char  i = 0; i < 0xF + 1; i++) {
-        LOG(INFO) << "Getting font sprite " << (int) i;
-        const unsigned char *sprite = Chip8::Fonts::getSprite(i);
-        for(unsigned char j = 0; j < Chip8::Fonts::SpriteHeight; j++) {
-            unsigned int address = 0x0 + (i * Chip8::Fonts::SpriteHeight) + j;
-            LOG(INFO) << "Loading font sprite byte " << (int) j << " to memory address " << address;
-            if(!Chip8::Memory::instance().write(address, sprite[j])) {
-               LOG(INFO) << "Failed to load font sprite " << (int) i << " into memory address " << address;
-            }
-        } 
+    // The buzzer is optional, keep going without sound if there is no device.
+    if(!options.mute && !Chip8::Audio::instance().open()) {
+        LOG(INFO) << "Running without sound";
+    }
+
+    // Start recording if asked to.
+    Chip8::Capture capture;
+    if(!options.capturePath.empty() && !capture.open(options.capturePath, options.captureFormat)) {
+        LOG(FATAL) << "Failed to start capture to " << options.capturePath;
+    }
+
+    machine.setCyclesPerFrame(options.cycles);
+
+    // Netplay resimulates frames on both sides, which only agrees if both
+    // sides roll the same random numbers. Seed 0 is a fixed seed.
+    if(options.seed >= 0) {
+        machine.cpu().seed(options.seed);
+    } else if(options.netplayEnabled) {
+        machine.cpu().seed(0);
+    }
+
+    Chip8::Netplay netplay;
+    if(options.netplayEnabled && !netplay.open(options.netplay)) {
+        LOG(FATAL) << "Failed to start netplay";
+    }
+
+    Chip8::GdbStub gdb;
+    if(options.gdbPort > 0 && !gdb.open(options.gdbPort)) {
+        LOG(FATAL) << "Failed to open the debugger port";
+    }
+
+    // Run ahead presents the frame the current input leads to a few frames
+    // from now, then rolls the machine back, which hides the ROM's own input
+    // lag.
+    std::unique_ptr<Chip8::Machine::State> runAheadState;
+    if(options.runAhead > 0) {
+        runAheadState.reset(new Chip8::Machine::State());
+        LOG(INFO) << "Running " << options.runAhead << " frames ahead";
+    }
+
+    Chip8::MetricsExporter metrics;
+    if((!options.metricsPath.empty() || options.metricsPort > 0)
+       && !metrics.start(options.metricsPath, options.metricsPort, options.metricsInterval)) {
+        LOG(FATAL) << "Failed to start metrics export";
     }
 
-    // Jump to start of rom
-    Chip8::Cpu::instance().jump(Chip8::Memory::StartAddress);
+    // Another process can watch the screen and press keys through shared
+    // memory. The frame counter there counts every frame the machine runs.
+    Chip8::SharedExport shared;
+    if(!options.sharedName.empty() && !shared.open(options.sharedName, options.sharedRgba)) {
+        LOG(FATAL) << "Failed to export to shared memory " << options.sharedName;
+    }
+    Uint64 framesRun = 0;
+
+    // A rebuilt ROM goes into the running machine instead of restarting.
+    // The watcher pushes an event, so a loop idling in SDL wakes for it.
+    // F5 saves a snapshot the machine returns to on every reload, and F9
+    // returns to it at once.
+    Chip8::RomWatcher watcher;
+    if(options.watch && !watcher.open(options.romName, []() {
+            SDL_Event wake;
+            SDL_zero(wake);
+            wake.type = SDL_USEREVENT;
+            SDL_PushEvent(&wake);
+        })) {
+        LOG(FATAL) << "Failed to watch " << options.romName;
+    }
+    std::unique_ptr<Chip8::Machine::State> snapshot;
+    bool returnToSnapshot = false;
+
+    // Turbo runs frames unpaced and only presents some of them, by default
+    // as often as the display refreshes.
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration presentPeriod = std::chrono::microseconds(1000000 / 60);
+    Clock::time_point nextPresent = Clock::now();
+    Uint64 turboFrames = 0;
+    Clock::time_point turboStart = Clock::now();
+    if(options.turbo) {
+        SDL_DisplayMode mode;
+        if(SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) {
+            presentPeriod = std::chrono::microseconds(1000000 / mode.refresh_rate);
+        }
+        LOG(INFO) << "Turbo presenting " << (options.presentEvery > 0 ? "every " + std::to_string(options.presentEvery) + " frames"
+                                                                     : "at the display refresh rate");
+    }
+
+    // While the ROM waits for a key the loop sleeps in SDL, waking this
+    // often at most. The frame presented before sleeping is remembered so
+    // it isn't uploaded again unchanged. Time slept is kept in
+    // microseconds times 60, so a frame is 1000000 of them, and what falls
+    // short of a frame carries over to the next wake.
+    const int IdleTimeoutMs = 1000;
+    Uint64 presentedFrame = 0;
+    Uint64 idleRemainder = 0;
 
     SDL_Event event;
-    Uint32 lastFrame = SDL_GetTicks();
-    Uint32 sixtyFrame = 1000 / 60;
+    bool quit = false;
+    Chip8::FramePacer pacer(60.0);
     do {
-        Uint32 currentFrame = SDL_GetTicks();
-        Uint32 elapsed = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        if(elapsed < sixtyFrame) {
-            SDL_Delay(sixtyFrame - elapsed);
+        if(!options.turbo) {
+            pacer.wait();
+            CHIP8_METRIC_OBSERVE(frameTime, (Uint64) (pacer.lastFrameMs() * 1000.0));
+            CHIP8_METRIC_ADD(lateFrames, pacer.lastFrameLate() ? 1 : 0);
+        } else if(Clock::now() - turboStart >= std::chrono::seconds(10)) {
+            double seconds = std::chrono::duration<double>(Clock::now() - turboStart).count();
+            LOG(INFO) << "Turbo running at " << turboFrames / seconds << " frames/s";
+            turboFrames = 0;
+            turboStart = Clock::now();
+        }
+        if(pacer.frames() == 600) {
+            Chip8::FramePacer::Stats frameStats = pacer.stats();
+            LOG(INFO) << "Frame time mean " << frameStats.meanMs << "ms p99 " << frameStats.p99Ms
+                      << "ms max overrun " << frameStats.maxOverrunMs << "ms late " << frameStats.late;
+            CHIP8_METRIC_SET(maxFrameOverrun, (Uint64) (frameStats.maxOverrunMs * 1000.0));
+            pacer.resetStats();
+            if(netplay.isOpen()) {
+                LOG(INFO) << "Netplay frame " << netplay.frame() << " confirmed " << netplay.confirmedFrame()
+                          << " rollbacks " << netplay.rollbacks() << " max frames " << netplay.maxResimulatedFrames()
+                          << " max time " << netplay.maxRollbackMicroseconds() << "us";
+            }
+        }
+
+        // A ROM waiting on FX0A changes nothing but its timers until a key is
+        // pressed, so instead of presenting the same frame every 16ms the
+        // loop blocks until SDL has an event, then steps the timers for the
+        // frames it slept through. The buzzer needs a tick every frame, and
+        // netplay, the debugger and capture need every frame to run, so any
+        // of them keeps the loop awake. Keys from shared memory come without
+        // an SDL event, so exporting does too.
+        bool idled = false;
+        if(machine.isWaitingForKey() && Chip8::Timers::instance().getSoundTimer() == 0
+           && !netplay.isOpen() && !gdb.isOpen() && !capture.isOpen() && !shared.isOpen()) {
+            Clock::time_point idleStart = Clock::now();
+            SDL_WaitEventTimeout(NULL, IdleTimeoutMs);
+            idleRemainder += (Uint64) std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - idleStart).count() * 60;
+            unsigned int idleFrames = (unsigned int) (idleRemainder / 1000000);
+            idleRemainder %= 1000000;
+            machine.idle(idleFrames);
+            framesRun += idleFrames;
+            pacer.reset();
+            idled = true;
         }
 
-        // Handle event
-        SDL_PollEvent(&event);
-        switch(event.type) {
-            case SDL_KEYDOWN:
-                LOG(INFO) << "Key pressed " << event.key.keysym.scancode;
-                if(event.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
-                    LOG(INFO) << "Escape pressed exiting now";
-                    SDL_FreeFormat(format);
-                    SDL_DestroyTexture(texture);
-                    SDL_DestroyRenderer(renderer);
-                    SDL_DestroyWindow(window);
-                    SDL_Quit();
-                    return 0;
-                } else if(Chip8::InputManager::instance().IsWaitingForKeyPress) {
-                    unsigned char hex;
-                    Chip8::InputManager::instance().toHex(event.key.keysym.scancode, hex);
-                    LOG(INFO) << "InputManager waiting for key press key pressed = " << hex;
-                    if(Chip8::InputManager::instance().isValidKey(hex)) {
-                        LOG(INFO) << "Valid key detected, setting register " << Chip8::InputManager::instance().KeyPressRegister;
-                        Chip8::InputManager::instance().IsWaitingForKeyPress = false;
-                        Chip8::Memory::instance().setRegister(Chip8::InputManager::KeyPressRegister, hex);
+        // Handle every event since the last frame, each one once.
+        bool repaint = false;
+        while(SDL_PollEvent(&event)) {
+            switch(event.type) {
+                case SDL_QUIT:
+                    quit = true;
+                    break;
+                case SDL_WINDOWEVENT:
+                    repaint = true;
+                    break;
+                case SDL_KEYUP:
+                    CHIP8_METRIC_ADD(inputEvents, 1);
+                    break;
+                case SDL_KEYDOWN:
+                    CHIP8_METRIC_ADD(inputEvents, 1);
+                    VLOG(1) << "Key pressed " << event.key.keysym.scancode;
+                    if(event.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
+                        LOG(INFO) << "Escape pressed exiting now";
+                        Chip8::Audio::instance().close();
+                        netplay.close();
+                        metrics.stop();
+                        gdb.close();
+                        shared.close();
+                        watcher.close();
+                        SDL_FreeFormat(format);
+                        SDL_DestroyTexture(texture);
+                        SDL_DestroyRenderer(renderer);
+                        SDL_DestroyWindow(window);
+                        SDL_Quit();
+                        return 0;
+                    } else if(!options.watch || event.key.repeat) {
+                        // Holding F5 or F9 acts once, on the press.
+                    } else if(event.key.keysym.scancode == SDL_SCANCODE_F5) {
+                        if(!snapshot) {
+                            snapshot.reset(new Chip8::Machine::State());
+                        }
+                        machine.save(*snapshot);
+                        LOG(INFO) << "Saved a snapshot to return to on reload";
+                    } else if(event.key.keysym.scancode == SDL_SCANCODE_F9 && snapshot) {
+                        returnToSnapshot = true;
                     }
+                    break;
+            }
+        }
+
+        // Only the rom changes, everything else carries on from the snapshot
+        // or from where the machine was. A file still empty or too big keeps
+        // the old rom running until the next write.
+        if(watcher.changed()) {
+            std::vector<unsigned char> rebuilt = Chip8::FileUtils::readRom(options.romName);
+            if(rebuilt.empty() || rebuilt.size() > Chip8::Memory::MaxAddress - Chip8::Memory::StartAddress) {
+                LOG(INFO) << "Not reloading " << options.romName << ", it holds " << rebuilt.size() << " bytes";
+            } else {
+                rom.swap(rebuilt);
+                returnToSnapshot = snapshot != NULL;
+                if(!returnToSnapshot) {
+                    machine.reloadRom(rom);
                 }
-                break;
+            }
+        }
+        if(returnToSnapshot) {
+            machine.restore(*snapshot);
+            machine.reloadRom(rom);
+            returnToSnapshot = false;
+        }
+
+        // A stalled netplay frame waits for the other side, the last frame
+        // is presented again.
+        Uint16 keys = Chip8::InputManager::readKeyboard() | shared.readKeys();
+        bool running = gdb.poll(machine);
+        if(!running) {
+            // A debugger has the machine halted, the last frame is presented again.
+        } else if(netplay.isOpen()) {
+            if(netplay.advance(machine, keys)) {
+                framesRun++;
+            }
+        } else if(options.turbo) {
+            // Every frame still steps the timers once, so the ROM sees 60Hz
+            // of emulated time per 60 frames however fast they run. Nothing
+            // about a frame that isn't presented is rendered or uploaded.
+            machine.setKeys(keys);
+            int frames = 0;
+            do {
+                machine.stepFrame();
+                frames++;
+            } while(machine.lastTrap() == Chip8::Machine::NoTrap
+                    && (options.presentEvery > 0 ? frames < options.presentEvery : Clock::now() < nextPresent));
+            nextPresent = Clock::now() + presentPeriod;
+            turboFrames += frames;
+            framesRun += frames;
+            CHIP8_METRIC_ADD(framesSkipped, frames - 1);
+        } else {
+            machine.setKeys(keys);
+            machine.stepFrame();
+            framesRun++;
+        }
+        if(running) {
+            gdb.check(machine);
+        }
+        shared.publish(machine, framesRun);
+        // In turbo the buzzer follows presented frames, queuing every frame
+        // would only overrun the audio ring.
+        Chip8::Audio::instance().tick(Chip8::Timers::instance().getSoundTimer());
+
+        // The frames run ahead are thrown away, so none of them are presented.
+        if(runAheadState) {
+            machine.save(*runAheadState);
+            for(int i = 0; i < options.runAhead; i++) {
+                machine.stepFrame();
+            }
+            CHIP8_METRIC_ADD(framesSkipped, options.runAhead);
         }
 
-        if(!Chip8::InputManager::instance().IsWaitingForKeyPress) {
-            // Cpu step
-            Chip8::Cpu::instance().step();
-            Chip8::Timers::instance().step();
+        // Render screen, after sleeping only if the frame changed or the
+        // window needs repainting.
+        Chip8::Video &video = Chip8::Video::instance();
+        Uint64 frame = video.frameHash() ^ video.getPlaneMask();
+        if(!idled || frame != presentedFrame || repaint) {
+            SDL_RenderClear(renderer);
+            if(scaler.enabled()) {
+                scaler.scale(video.getPlane(0), video.getPlane(1), video.getPalette(), &scaledPixels[0]);
+                SDL_UpdateTexture(texture, NULL, &scaledPixels[0], textureWidth * sizeof(Uint32));
+            } else {
+                SDL_UpdateTexture(texture, NULL, video.getPixels(), Chip8::Video::Width * sizeof(Uint32));
+            }
+            SDL_RenderCopy(renderer, texture, NULL, NULL);
+            SDL_RenderPresent(renderer);
+            CHIP8_METRIC_ADD(framesPresented, 1);
+            capture.pushFrame(video);
+            presentedFrame = frame;
         }
 
-        // Render screen
-        SDL_RenderClear(renderer);
-        SDL_UpdateTexture(texture, NULL, Chip8::Video::instance().getPixels(), Chip8::Video::Width * sizeof(Uint32));
-        SDL_RenderCopy(renderer, texture, NULL, NULL);
-        SDL_RenderPresent(renderer);
-    } while(event.type != SDL_QUIT);
+        if(runAheadState) {
+            machine.restore(*runAheadState);
+        }
+    } while(!quit);
 
+    Chip8::Audio::instance().close();
+    netplay.close();
+    metrics.stop();
+    gdb.close();
+    shared.close();
+    watcher.close();
     SDL_FreeFormat(format);
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
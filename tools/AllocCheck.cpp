@@ -0,0 +1,152 @@
+// Checks that running a ROM allocates nothing once it has warmed up.
+//
+// chip8-alloccheck [--frames=N] [--warmup=N] [--cycles=N] [--seed=N] romfile...
+//
+// Every frame does what the main loop does short of SDL: it sets random
+// keys, steps the frame, steps the timers, converts the screen to pixels
+// and scales it with each filter. This program replaces the global operator
+// new to count allocations. It exits with 1 if any frame after the first
+// --warmup frames allocated.
+
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+#include <Scaler.hpp>
+#include <Video.hpp>
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::atomic<Uint64> allocations(0);
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result >= 0;
+    }
+
+    unsigned int nextRandom(unsigned int &random)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+}
+
+// The array and sized forms fall through to these two.
+void * operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *memory = malloc(size > 0 ? size : 1);
+    if(memory == 0) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::vector<std::string> romNames;
+    long frames = 3600;
+    long warmup = 60;
+    long cycles = 10;
+    long seed = 1;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            romNames.push_back(arg);
+        } else if(name == "--frames") {
+            valid = parseNumber(value, frames);
+        } else if(name == "--warmup") {
+            valid = parseNumber(value, warmup);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles) && cycles > 0;
+        } else if(name == "--seed") {
+            valid = parseNumber(value, seed);
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || romNames.empty()) {
+        std::cout << "Usage: chip8-alloccheck [--frames=N] [--warmup=N] [--cycles=N] [--seed=N] romfile..." << std::endl;
+        return 2;
+    }
+
+    const Chip8::Scaler::Filter filters[] = { Chip8::Scaler::None, Chip8::Scaler::Nearest, Chip8::Scaler::Smooth };
+    const int filterCount = sizeof(filters) / sizeof(filters[0]);
+    std::vector<std::unique_ptr<Chip8::Scaler> > scalers;
+    std::vector<std::vector<Uint32> > outputs;
+    for(int f = 0; f < filterCount; f++) {
+        scalers.push_back(std::unique_ptr<Chip8::Scaler>(new Chip8::Scaler(filters[f], 4, Chip8::Scaler::Auto)));
+        outputs.push_back(std::vector<Uint32>(scalers.back()->outputWidth() * scalers.back()->outputHeight()));
+    }
+
+    bool clean = true;
+    for(size_t r = 0; r < romNames.size(); r++) {
+        std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romNames[r]);
+        if(rom.empty()) {
+            std::cout << "Failed to read " << romNames[r] << std::endl;
+            return 1;
+        }
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        machine->reset(rom);
+        machine->setCyclesPerFrame((int) cycles);
+        machine->cpu().seed(0);
+
+        unsigned int random = (unsigned int) seed;
+        Uint64 counted = 0;
+        long firstFrame = -1;
+        for(long frame = 0; frame < warmup + frames; frame++) {
+            Uint64 before = allocations.load(std::memory_order_relaxed);
+
+            unsigned int roll = nextRandom(random);
+            machine->setKeys(roll % 4 == 0 ? (Uint16) (1 << ((roll >> 8) & 0xF)) : 0);
+            machine->stepFrame();
+            Chip8::Video &video = machine->video();
+            video.getPixels();
+            for(int f = 0; f < filterCount; f++) {
+                if(scalers[f]->enabled()) {
+                    scalers[f]->scale(video.getPlane(0), video.getPlane(1), video.getPalette(), &outputs[f][0]);
+                }
+            }
+
+            Uint64 allocated = allocations.load(std::memory_order_relaxed) - before;
+            if(frame >= warmup && allocated > 0) {
+                counted += allocated;
+                if(firstFrame < 0) {
+                    firstFrame = frame;
+                }
+            }
+        }
+
+        if(counted > 0) {
+            std::cout << romNames[r] << ": " << counted << " allocations after warm up, first in frame " << firstFrame << std::endl;
+            clean = false;
+        } else {
+            std::cout << romNames[r] << ": no allocations in " << frames << " frames" << std::endl;
+        }
+    }
+    return clean ? 0 : 1;
+}
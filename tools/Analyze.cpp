@@ -0,0 +1,53 @@
+// Disassembles a ROM and prints its basic blocks and code/data map.
+//
+// chip8-analyze [--disasm|--cfg|--map] romfile
+//
+// --disasm (the default) prints a listing, --cfg a Graphviz digraph of the
+// basic blocks and --map the address ranges of code, sprites and data.
+
+#include <Analyzer.hpp>
+#include <FileUtils.hpp>
+
+#include <glog/logging.h>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+
+    std::string mode = "--disasm";
+    std::string romName;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--disasm" || arg == "--cfg" || arg == "--map") {
+            mode = arg;
+        } else if(arg.compare(0, 2, "--") != 0 && romName.empty()) {
+            romName = arg;
+        } else {
+            romName.clear();
+            break;
+        }
+    }
+    if(romName.empty()) {
+        std::cout << "Usage: chip8-analyze [--disasm|--cfg|--map] romfile" << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
+    if(rom.empty()) {
+        std::cout << "Failed to read " << romName << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<const Chip8::Analyzer::Analysis> analysis = Chip8::Analyzer::analyze(rom);
+    if(mode == "--cfg") {
+        Chip8::Analyzer::writeCfg(*analysis, std::cout);
+    } else if(mode == "--map") {
+        Chip8::Analyzer::writeMap(*analysis, std::cout);
+    } else {
+        Chip8::Analyzer::writeDisassembly(*analysis, std::cout);
+    }
+    return 0;
+}
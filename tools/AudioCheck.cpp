@@ -0,0 +1,110 @@
+// Checks that the buzzer never underruns while the host is busy.
+//
+// chip8-audiocheck [--seconds=N] [--load=N]
+//
+// Opens Audio on SDL's dummy driver, unless SDL_AUDIODRIVER names another
+// (disk, with SDL_DISKAUDIOFILE, also captures the samples), then calls
+// Audio::tick at 60Hz as the main loop does, with the buzzer on for most
+// steps, while --load threads spin alongside. It exits with 1 if the audio
+// device couldn't be opened or any underrun was counted.
+
+#include <Audio.hpp>
+#include <BitUtils.hpp>
+#include <FramePacer.hpp>
+
+#include <SDL.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<bool> stopLoad(false);
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result >= 0;
+    }
+
+    // Keeps a core busy until stopLoad is set.
+    void spin()
+    {
+        Uint64 hash = 1;
+        while(!stopLoad.load(std::memory_order_relaxed)) {
+            for(int i = 0; i < 100000; i++) {
+                hash = Chip8::BitUtils::mix(hash);
+            }
+        }
+        volatile Uint64 sink = hash;
+        (void) sink;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    long seconds = 10;
+    long load = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(name == "--seconds") {
+            valid = parseNumber(value, seconds) && seconds > 0;
+        } else if(name == "--load") {
+            valid = parseNumber(value, load);
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid) {
+        std::cout << "Usage: chip8-audiocheck [--seconds=N] [--load=N]" << std::endl;
+        return 2;
+    }
+
+    // Only a default, so the disk driver can be chosen instead.
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+    Chip8::Audio &audio = Chip8::Audio::instance();
+    if(!audio.open()) {
+        std::cout << "Failed to open audio on the " << getenv("SDL_AUDIODRIVER") << " driver" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::thread> threads;
+    for(long i = 0; i < load; i++) {
+        threads.push_back(std::thread(spin));
+    }
+
+    // Underruns only count while buzzing, so the buzzer is on for 50 of
+    // every 60 steps, with the gaps exercising the switch back on.
+    Chip8::FramePacer pacer(60.0);
+    long steps = seconds * 60;
+    for(long step = 0; step < steps; step++) {
+        pacer.wait();
+        audio.tick(step % 60 < 50 ? 1 : 0);
+    }
+
+    stopLoad = true;
+    for(size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    Uint64 underruns = audio.underruns();
+    Uint64 overruns = audio.overruns();
+    audio.close();
+    SDL_Quit();
+
+    std::cout << steps << " timer steps with " << load << " busy threads, " << underruns << " underruns, "
+              << overruns << " overruns" << std::endl;
+    return underruns == 0 ? 0 : 1;
+}
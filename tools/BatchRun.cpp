@@ -0,0 +1,274 @@
+// Runs a corpus of ROMs for a long time with random input, checkpointing
+// every machine so a killed run resumes where it was.
+//
+// chip8-batch [--frames=N] [--cycles=N] [--copies=N] [--threads=N]
+//             [--input-seed=N] [--checkpoint=FILE] [--every=SECONDS] romfile...
+//
+// Each rom gets --copies machines, copy c of rom r seeded with r * copies + c
+// for both its CPU and its input, which holds a random key for a random
+// number of frames at a time as chip8-difftest's input does. Every machine
+// runs --frames frames and then a line per machine gives the rom, the copy
+// and its state hash.
+//
+// With --checkpoint every machine is saved to FILE every --every seconds, at
+// SIGINT or SIGTERM and at the end. If FILE holds a checkpoint of the same
+// roms and settings, the run resumes from it rather than from frame 0, and
+// --frames may be raised to run further. A resumed run ends with the same
+// hashes an uninterrupted one does. Any other FILE is left alone and the run
+// refuses to start.
+
+#include <BitUtils.hpp>
+#include <Checkpoint.hpp>
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+#include <MachineBatch.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <signal.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    volatile sig_atomic_t stopRequested = 0;
+
+    void requestStop(int)
+    {
+        stopRequested = 1;
+    }
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result >= 0;
+    }
+
+    /**
+    * @brief Holds a random key for a random number of frames at a time, one
+    *        frame at a time, so where it is up to can be checkpointed.
+    */
+    struct RandomInput
+    {
+        Uint32 random;
+        Uint16 held;
+        Uint32 left;
+
+        explicit RandomInput(Uint32 seed)
+            : random(seed != 0 ? seed : 1),
+              held(0),
+              left(0)
+        {
+        }
+
+        Uint16 next()
+        {
+            if(left == 0) {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                held = (random & 0x3) == 0 ? 0 : (Uint16) (1 << ((random >> 8) & 0xF));
+                left = 1 + ((random >> 16) % 30);
+            }
+            left--;
+            return held;
+        }
+
+        void save(Uint64 input[2]) const
+        {
+            input[0] = random;
+            input[1] = (Uint64) held << 32 | left;
+        }
+
+        void restore(const Uint64 input[2])
+        {
+            random = (Uint32) input[0];
+            held = (Uint16) (input[1] >> 32);
+            left = (Uint32) input[1];
+        }
+    };
+
+    Uint64 hashRom(const std::vector<unsigned char> &rom)
+    {
+        Uint64 hash = Chip8::BitUtils::mix(rom.size());
+        for(size_t i = 0; i < rom.size(); i++) {
+            hash = Chip8::BitUtils::mix(hash ^ rom[i]);
+        }
+        return hash;
+    }
+
+    bool save(Chip8::Checkpoint &checkpoint, const std::string &path, Uint64 run, Uint64 sequence,
+              Chip8::MachineBatch &batch, const std::vector<RandomInput> &inputs,
+              const std::vector<Uint64> &romHashes, Uint64 frame)
+    {
+        Chip8::Checkpoint::Job *jobs = checkpoint.begin(path, batch.size(), run, sequence);
+        if(jobs == 0) {
+            return false;
+        }
+        for(size_t i = 0; i < batch.size(); i++) {
+            batch.machine(i).save(jobs[i].machine);
+            jobs[i].frame = frame;
+            inputs[i].save(jobs[i].input);
+            jobs[i].romHash = romHashes[i];
+        }
+        bool committed = checkpoint.commit();
+        checkpoint.close();
+        return committed;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::vector<std::string> romNames;
+    std::string checkpointPath;
+    long frames = 36000;
+    long cycles = 10;
+    long copies = 1;
+    long threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    long inputSeed = 1;
+    long every = 60;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            romNames.push_back(arg);
+        } else if(name == "--frames") {
+            valid = parseNumber(value, frames);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles) && cycles > 0;
+        } else if(name == "--copies") {
+            valid = parseNumber(value, copies) && copies > 0;
+        } else if(name == "--threads") {
+            valid = parseNumber(value, threads) && threads > 0;
+        } else if(name == "--input-seed") {
+            valid = parseNumber(value, inputSeed);
+        } else if(name == "--checkpoint") {
+            checkpointPath = value;
+            valid = !value.empty();
+        } else if(name == "--every") {
+            valid = parseNumber(value, every) && every > 0;
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || romNames.empty()) {
+        std::cout << "Usage: chip8-batch [--frames=N] [--cycles=N] [--copies=N] [--threads=N]" << std::endl
+                  << "                   [--input-seed=N] [--checkpoint=FILE] [--every=SECONDS] romfile..." << std::endl;
+        return 2;
+    }
+
+    // Everything but --frames, --threads and --every decides what the
+    // machines do, so a checkpoint only resumes a run that agrees on it.
+    std::vector<std::vector<unsigned char> > roms;
+    Uint64 run = Chip8::BitUtils::mix((Uint64) cycles << 32 ^ (Uint64) copies);
+    run = Chip8::BitUtils::mix(run ^ (Uint64) inputSeed);
+    for(size_t r = 0; r < romNames.size(); r++) {
+        roms.push_back(Chip8::FileUtils::readRom(romNames[r]));
+        if(roms.back().empty()) {
+            std::cout << "Failed to read " << romNames[r] << std::endl;
+            return 1;
+        }
+        run = Chip8::BitUtils::mix(run ^ hashRom(roms.back()));
+    }
+
+    size_t count = roms.size() * (size_t) copies;
+    Chip8::MachineBatch batch(count, (unsigned int) threads, false);
+    std::vector<RandomInput> inputs;
+    std::vector<Uint64> romHashes;
+    for(size_t i = 0; i < count; i++) {
+        const std::vector<unsigned char> &rom = roms[i / (size_t) copies];
+        Chip8::Machine &machine = batch.machine(i);
+        if(!machine.reset(rom)) {
+            std::cout << romNames[i / (size_t) copies] << " doesn't fit in memory" << std::endl;
+            return 1;
+        }
+        machine.setCyclesPerFrame((int) cycles);
+        machine.cpu().seed((unsigned int) i);
+        inputs.push_back(RandomInput((Uint32) (inputSeed + (long) i)));
+        romHashes.push_back(hashRom(rom));
+    }
+
+    Uint64 frame = 0;
+    Uint64 sequence = 0;
+    Chip8::Checkpoint checkpoint;
+    if(!checkpointPath.empty()) {
+        const Chip8::Checkpoint::Job *jobs = checkpoint.load(checkpointPath, run);
+        bool matches = jobs != 0 && checkpoint.count() == count;
+        for(size_t i = 0; matches && i < count; i++) {
+            matches = jobs[i].romHash == romHashes[i];
+        }
+        if(matches) {
+            for(size_t i = 0; i < count; i++) {
+                batch.machine(i).restore(jobs[i].machine);
+                inputs[i].restore(jobs[i].input);
+                batch.refresh(i);
+            }
+            frame = jobs[0].frame;
+            sequence = checkpoint.sequence();
+            std::cout << "Resumed " << count << " machines at frame " << frame
+                      << " from checkpoint " << sequence << std::endl;
+        } else if(access(checkpointPath.c_str(), F_OK) == 0) {
+            // It may be the only copy of another run's progress.
+            std::cout << checkpointPath << " isn't a checkpoint of this run, remove it to start again" << std::endl;
+            return 1;
+        }
+        checkpoint.close();
+        signal(SIGINT, requestStop);
+        signal(SIGTERM, requestStop);
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point next = Clock::now() + std::chrono::seconds(every);
+    std::vector<Uint16> keys(count, 0);
+    while(frame < (Uint64) frames && !stopRequested) {
+        for(size_t i = 0; i < count; i++) {
+            keys[i] = inputs[i].next();
+        }
+        batch.step(&keys[0], 1);
+        frame++;
+
+        if(!checkpointPath.empty() && Clock::now() >= next) {
+            Clock::time_point start = Clock::now();
+            if(!save(checkpoint, checkpointPath, run, ++sequence, batch, inputs, romHashes, frame)) {
+                std::cout << "Failed to write checkpoint " << sequence << std::endl;
+                return 1;
+            }
+            std::cout << "Checkpoint " << sequence << " at frame " << frame << " took "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count()
+                      << " ms" << std::endl;
+            next = Clock::now() + std::chrono::seconds(every);
+        }
+    }
+
+    if(!checkpointPath.empty()) {
+        if(!save(checkpoint, checkpointPath, run, ++sequence, batch, inputs, romHashes, frame)) {
+            std::cout << "Failed to write checkpoint " << sequence << std::endl;
+            return 1;
+        }
+        std::cout << "Checkpoint " << sequence << " at frame " << frame << std::endl;
+    }
+    if(stopRequested) {
+        std::cout << "Stopped at frame " << frame << ", run again to resume" << std::endl;
+        return 0;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        std::cout << romNames[i / (size_t) copies] << " " << i % (size_t) copies << " "
+                  << std::hex << std::setw(16) << std::setfill('0') << batch.machine(i).stateHash()
+                  << std::dec << std::endl;
+    }
+    return 0;
+}
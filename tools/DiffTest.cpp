@@ -0,0 +1,315 @@
+// Checks that a candidate core runs a ROM exactly like the reference
+// interpreter, comparing the state hash after every instruction.
+//
+// chip8-difftest [--candidate=CORE] [--frames=N] [--cycles=N] [--input-seed=N] romfile
+//     Runs the reference and the candidate side by side.
+// chip8-difftest --record=TRACE [--frames=N] [--cycles=N] [--input-seed=N] romfile
+//     Runs the reference and writes a gzip golden trace.
+// chip8-difftest --golden=TRACE [--candidate=CORE] romfile
+//     Runs the candidate against a golden trace. The reference only runs
+//     again if they diverge, to show what differs.
+//
+// On divergence the frame, instruction, PC and state diff are printed and
+// the exit code is 1.
+
+#include <Analyzer.hpp>
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+#include <Trace.hpp>
+
+#include <glog/logging.h>
+
+#include <iostream>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+    * @brief A way of executing one instruction on the bound machine.
+    */
+    struct Core
+    {
+        const char *name;
+        void (*step)(Chip8::Machine &machine);
+    };
+
+    void interpreterStep(Chip8::Machine &machine)
+    {
+        machine.cpu().step();
+    }
+
+    // New cores are added here. The first entry is the reference.
+    const Core Cores[] = {
+        { "interpreter", interpreterStep }
+    };
+
+    const Core * findCore(const std::string &name)
+    {
+        for(size_t i = 0; i < sizeof(Cores) / sizeof(Cores[0]); i++) {
+            if(name == Cores[i].name) {
+                return &Cores[i];
+            }
+        }
+        return 0;
+    }
+
+    /**
+    * @brief Runs a ROM like Machine::stepFrame does, but one instruction at a
+    *        time, keeping the state after every instruction and timer step.
+    */
+    class Runner
+    {
+        public:
+            Runner(const Core &core, const std::vector<unsigned char> &rom, const Chip8::TraceHeader &header)
+                : _core(core),
+                  _header(header),
+                  _machine(new Chip8::Machine()),
+                  _state(new Chip8::Machine::State()),
+                  _frame(0),
+                  _instruction(0),
+                  _frameStarted(false),
+                  _steps(0)
+            {
+                _machine->reset(rom);
+                _machine->setCyclesPerFrame(header.cycles);
+                _machine->cpu().seed(0);
+                _machine->save(*_state);
+            }
+
+            // Runs the next instruction or timer step, false after the last frame.
+            bool next()
+            {
+                Chip8::Machine::Scope scope(*_machine);
+                while(_frame < _header.keys.size()) {
+                    if(!_frameStarted) {
+                        _machine->setKeys(_header.keys[_frame]);
+                        _frameStarted = true;
+                    }
+
+                    // A frame that starts waiting on FX0A runs only its timer
+                    // step, as Machine::stepFrame does.
+                    _pc = (Uint16) _state->cpu.pc;
+                    if(_instruction < _header.cycles && !_machine->input().IsWaitingForKeyPress) {
+                        _core.step(*_machine);
+                        _instruction++;
+                    } else {
+                        _machine->timers().step();
+                        endFrame();
+                    }
+                    _machine->save(*_state);
+                    _hash = Chip8::Trace::hashState(*_state);
+                    _steps++;
+                    return true;
+                }
+                return false;
+            }
+
+            // Describes where the last step ran.
+            std::string position() const
+            {
+                char text[96];
+                snprintf(text, sizeof(text), "step %llu (frame %u) at pc 0x%03X",
+                         (unsigned long long) _steps - 1, _frameStarted ? _frame : _frame - 1, _pc);
+                return text;
+            }
+
+            Uint16 pc() const { return _pc; }
+            Uint64 hash() const { return _hash; }
+            Uint64 steps() const { return _steps; }
+            Uint32 frames() const { return _frame; }
+            const Chip8::Machine::State & state() const { return *_state; }
+
+        private:
+            void endFrame()
+            {
+                _frame++;
+                _instruction = 0;
+                _frameStarted = false;
+            }
+
+            const Core &_core;
+            const Chip8::TraceHeader &_header;
+            std::unique_ptr<Chip8::Machine> _machine;
+            std::unique_ptr<Chip8::Machine::State> _state;
+            Uint32 _frame;
+            Uint32 _instruction;
+            bool _frameStarted;
+            Uint64 _steps;
+            Uint16 _pc;
+            Uint64 _hash;
+    };
+
+    // Holds each key mask, including no keys, for a random number of frames.
+    std::vector<Uint16> randomKeys(Uint32 frames, unsigned int seed)
+    {
+        std::vector<Uint16> keys(frames, 0);
+        unsigned int random = seed != 0 ? seed : 1;
+        Uint16 held = 0;
+        Uint32 left = 0;
+        for(Uint32 frame = 0; frame < frames; frame++) {
+            if(left == 0) {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                held = (random & 0x3) == 0 ? 0 : (Uint16) (1 << ((random >> 8) & 0xF));
+                left = 1 + ((random >> 16) % 30);
+            }
+            keys[frame] = held;
+            left--;
+        }
+        return keys;
+    }
+
+    void reportDivergence(const Runner &expected, const Runner &actual)
+    {
+        std::cout << "Diverged at " << actual.position() << std::endl;
+        Chip8::Trace::diff(expected.state(), actual.state(), std::cout);
+    }
+
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result >= 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::string romName;
+    std::string recordPath;
+    std::string goldenPath;
+    std::string candidateName = Cores[0].name;
+    long frames = 600;
+    long cycles = 10;
+    long inputSeed = 1;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            valid = romName.empty();
+            romName = arg;
+        } else if(name == "--record") {
+            recordPath = value;
+        } else if(name == "--golden") {
+            goldenPath = value;
+        } else if(name == "--candidate") {
+            candidateName = value;
+        } else if(name == "--frames") {
+            valid = parseNumber(value, frames);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles) && cycles > 0;
+        } else if(name == "--input-seed") {
+            valid = parseNumber(value, inputSeed);
+        } else {
+            valid = false;
+        }
+    }
+    const Core *candidate = findCore(candidateName);
+    if(!valid || romName.empty() || candidate == 0 || (!recordPath.empty() && !goldenPath.empty())) {
+        std::cout << "Usage: chip8-difftest [--candidate=CORE] [--frames=N] [--cycles=N] [--input-seed=N] romfile" << std::endl
+                  << "       chip8-difftest --record=TRACE [--frames=N] [--cycles=N] [--input-seed=N] romfile" << std::endl
+                  << "       chip8-difftest --golden=TRACE [--candidate=CORE] romfile" << std::endl
+                  << "Cores:";
+        for(size_t i = 0; i < sizeof(Cores) / sizeof(Cores[0]); i++) {
+            std::cout << " " << Cores[i].name;
+        }
+        std::cout << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
+    if(rom.empty()) {
+        std::cout << "Failed to read " << romName << std::endl;
+        return 2;
+    }
+
+    Chip8::TraceHeader header;
+    Chip8::TraceReader golden;
+    if(!goldenPath.empty()) {
+        if(!golden.open(goldenPath)) {
+            std::cout << "Failed to read trace " << goldenPath << std::endl;
+            return 2;
+        }
+        header = golden.header();
+        if(header.romHash != Chip8::Analyzer::hash(rom)) {
+            std::cout << goldenPath << " was recorded on a different rom" << std::endl;
+            return 2;
+        }
+    } else {
+        header.romHash = Chip8::Analyzer::hash(rom);
+        header.cycles = (Uint32) cycles;
+        header.keys = randomKeys((Uint32) frames, (unsigned int) inputSeed);
+    }
+
+    const Core &reference = Cores[0];
+    if(!recordPath.empty()) {
+        Chip8::TraceWriter writer;
+        if(!writer.open(recordPath, header)) {
+            std::cout << "Failed to create " << recordPath << std::endl;
+            return 2;
+        }
+        Runner runner(reference, rom, header);
+        while(runner.next()) {
+            writer.step(runner.pc(), runner.hash());
+        }
+        if(!writer.close()) {
+            std::cout << "Failed to write " << recordPath << std::endl;
+            return 2;
+        }
+        std::cout << "Recorded " << runner.steps() << " steps over " << runner.frames() << " frames" << std::endl;
+        return 0;
+    }
+
+    Runner actual(*candidate, rom, header);
+    if(!goldenPath.empty()) {
+        Uint16 pc = 0;
+        Uint64 hash = 0;
+        bool more = golden.next(pc, hash);
+        while(more && actual.next()) {
+            if(actual.pc() != pc || actual.hash() != hash) {
+                // The trace only has hashes, rerun the reference for the diff.
+                Runner expected(reference, rom, header);
+                while(expected.steps() < actual.steps() && expected.next()) {
+                }
+                reportDivergence(expected, actual);
+                return 1;
+            }
+            more = golden.next(pc, hash);
+        }
+        if(more || actual.next()) {
+            std::cout << "Step count differs from the trace after " << actual.steps() << " steps" << std::endl;
+            return 1;
+        }
+    } else {
+        Runner expected(reference, rom, header);
+        for(;;) {
+            bool more = expected.next();
+            if(more != actual.next()) {
+                std::cout << "Step count differs after " << expected.steps() << " steps" << std::endl;
+                return 1;
+            }
+            if(!more) {
+                break;
+            }
+            if(expected.pc() != actual.pc() || expected.hash() != actual.hash()) {
+                reportDivergence(expected, actual);
+                return 1;
+            }
+        }
+    }
+
+    std::cout << candidate->name << " matches " << (goldenPath.empty() ? reference.name : goldenPath)
+              << " for " << actual.steps() << " steps over " << actual.frames() << " frames" << std::endl;
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Explores a ROM's states with random input walks, skipping walks that reach
+// a state some earlier walk already visited.
+//
+// chip8-explore [--walks=N] [--depth=N] [--frames=N] [--cycles=N] [--seed=N]
+//               [--capacity=N] [--store=FILE] [--no-prune] romfile
+//
+// Every walk restores the booted machine and then, depth times, holds one
+// random key (or none) for --frames frames and looks the resulting
+// Machine::stateHash up in a DedupStore. A walk stops at the first state
+// already in the store, unless --no-prune is given. --store loads the store
+// from FILE if it exists and saves it back, so later runs skip everything
+// earlier runs saw.
+
+#include <DedupStore.hpp>
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result > 0;
+    }
+
+    unsigned int nextRandom(unsigned int &random)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::string romName;
+    std::string storePath;
+    long walks = 1000;
+    long depth = 100;
+    long frames = 6;
+    long cycles = 10;
+    long seed = 1;
+    long capacity = 1 << 20;
+    bool prune = true;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            valid = romName.empty();
+            romName = arg;
+        } else if(name == "--walks") {
+            valid = parseNumber(value, walks);
+        } else if(name == "--depth") {
+            valid = parseNumber(value, depth);
+        } else if(name == "--frames") {
+            valid = parseNumber(value, frames);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles);
+        } else if(name == "--seed") {
+            valid = parseNumber(value, seed);
+        } else if(name == "--capacity") {
+            valid = parseNumber(value, capacity);
+        } else if(name == "--store") {
+            storePath = value;
+            valid = !value.empty();
+        } else if(arg == "--no-prune") {
+            prune = false;
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || romName.empty()) {
+        std::cout << "Usage: chip8-explore [--walks=N] [--depth=N] [--frames=N] [--cycles=N] [--seed=N]" << std::endl
+                  << "                     [--capacity=N] [--store=FILE] [--no-prune] romfile" << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
+    if(rom.empty()) {
+        std::cout << "Failed to read " << romName << std::endl;
+        return 1;
+    }
+
+    Chip8::DedupStore store((size_t) capacity);
+    if(!storePath.empty() && access(storePath.c_str(), F_OK) == 0) {
+        if(!store.load(storePath)) {
+            std::cout << "Failed to load " << storePath << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded " << store.size() << " states from " << storePath << std::endl;
+    }
+
+    std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+    machine->reset(rom);
+    machine->setCyclesPerFrame((int) cycles);
+    machine->cpu().seed(0);
+    std::unique_ptr<Chip8::Machine::State> booted(new Chip8::Machine::State());
+    machine->save(*booted);
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration hashTime(0);
+    Clock::time_point start = Clock::now();
+    unsigned int random = (unsigned int) seed;
+    Uint64 steps = 0;
+    Uint64 found = 0;
+    Uint64 revisits = 0;
+    Uint64 pruned = 0;
+    for(long walk = 0; walk < walks; walk++) {
+        machine->restore(*booted);
+        for(long step = 0; step < depth; step++) {
+            // No key a fifth of the time, otherwise one of the 16.
+            unsigned int roll = nextRandom(random);
+            Uint16 keys = roll % 5 == 0 ? 0 : (Uint16) (1 << ((roll >> 8) & 0xF));
+            machine->setKeys(keys);
+            for(long frame = 0; frame < frames; frame++) {
+                machine->stepFrame();
+            }
+            steps++;
+
+            Clock::time_point hashStart = Clock::now();
+            bool fresh = store.insert(machine->stateHash());
+            hashTime += Clock::now() - hashStart;
+            if(fresh) {
+                found++;
+            } else {
+                revisits++;
+                if(prune) {
+                    pruned += depth - step - 1;
+                    break;
+                }
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "Walked " << steps << " steps in " << walks << " walks, " << seconds << "s" << std::endl
+              << "New states " << found << ", revisits " << revisits << " ("
+              << (steps > 0 ? 100.0 * revisits / steps : 0.0) << "%)" << std::endl
+              << "Store holds " << store.size() << " of " << store.capacity() << std::endl;
+    if(prune) {
+        std::cout << "Pruned " << pruned << " steps, " << pruned * frames << " frames not run" << std::endl;
+    }
+    std::cout << "Hashing took " << std::chrono::duration<double, std::micro>(hashTime).count() / (steps > 0 ? steps : 1)
+              << "us per state" << std::endl;
+
+    if(!storePath.empty() && !store.save(storePath)) {
+        std::cout << "Failed to save " << storePath << std::endl;
+        return 1;
+    }
+    return 0;
+}
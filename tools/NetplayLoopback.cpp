@@ -0,0 +1,267 @@
+// Plays a ROM between two netplay peers in one process over 127.0.0.1, with
+// scripted input and an optional simulated bad link, then checks both peers
+// ended up identical to a machine that ran the same inputs without netplay.
+//
+// chip8-netplay-loopback [--frames=N] [--hz=N] [--latency=MS] [--jitter=MS]
+//                        [--loss=PERCENT] [--delay=N] [--rollback=N]
+//                        [--cycles=N] [--port=N] romfile
+
+#include <FileUtils.hpp>
+#include <FramePacer.hpp>
+#include <Machine.hpp>
+#include <Netplay.hpp>
+#include <Trace.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Settings
+    {
+        Settings()
+            : frames(600),
+              hz(60),
+              cycles(10),
+              port(47800)
+        {
+        }
+
+        std::string romName;
+        int frames;
+        int hz;
+        int cycles;
+        int port;
+        Chip8::Netplay::Config netplay;
+    };
+
+    bool parseInt(const std::string &value, int &result)
+    {
+        char *end = 0;
+        long parsed = strtol(value.c_str(), &end, 10);
+        if(value.empty() || *end != '\0' || parsed < 0) {
+            return false;
+        }
+        result = (int) parsed;
+        return true;
+    }
+
+    bool parse(int argc, char *argv[], Settings &settings)
+    {
+        for(int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if(arg.compare(0, 2, "--") != 0) {
+                settings.romName = arg;
+                continue;
+            }
+            size_t equals = arg.find('=');
+            if(equals == std::string::npos) {
+                return false;
+            }
+            std::string name = arg.substr(2, equals - 2);
+            std::string value = arg.substr(equals + 1);
+            int *target = 0;
+            if(name == "frames") {
+                target = &settings.frames;
+            } else if(name == "hz") {
+                target = &settings.hz;
+            } else if(name == "cycles") {
+                target = &settings.cycles;
+            } else if(name == "port") {
+                target = &settings.port;
+            } else if(name == "latency") {
+                target = &settings.netplay.latencyMs;
+            } else if(name == "jitter") {
+                target = &settings.netplay.jitterMs;
+            } else if(name == "loss") {
+                target = &settings.netplay.lossPercent;
+            } else if(name == "delay") {
+                target = &settings.netplay.inputDelay;
+            } else if(name == "rollback") {
+                target = &settings.netplay.maxRollback;
+            }
+            if(target == 0 || !parseInt(value, *target)) {
+                return false;
+            }
+        }
+        return !settings.romName.empty() && settings.hz > 0;
+    }
+
+    void boot(Chip8::Machine &machine, const std::vector<unsigned char> &rom, int cycles)
+    {
+        machine.reset(rom);
+        machine.cpu().seed(0);
+        machine.setCyclesPerFrame(cycles);
+    }
+
+    // A player that holds one of its keys, or none, for a random number of
+    // frames.
+    class Player
+    {
+        public:
+            Player(unsigned int seed, unsigned char key0, unsigned char key1)
+                : _random(seed),
+                  _held(0),
+                  _keys(0)
+            {
+                _choices[0] = 0;
+                _choices[1] = 1 << key0;
+                _choices[2] = 1 << key1;
+            }
+
+            // The keys for the next frame.
+            Uint16 keys()
+            {
+                if(_held == 0) {
+                    _keys = _choices[random() % 3];
+                    _held = 5 + random() % 25;
+                }
+                return _keys;
+            }
+
+            // Records that keys() was played.
+            void played()
+            {
+                _held--;
+                _played.push_back(_keys);
+            }
+
+            // The keys played each frame, in order.
+            const std::vector<Uint16> & history() const
+            {
+                return _played;
+            }
+
+        private:
+            unsigned int random()
+            {
+                _random ^= _random << 13;
+                _random ^= _random >> 17;
+                _random ^= _random << 5;
+                return _random;
+            }
+
+            unsigned int _random;
+            int _held;
+            Uint16 _keys;
+            Uint16 _choices[3];
+            std::vector<Uint16> _played;
+    };
+
+    // States from different machines carry different page versions, so
+    // they are compared by what they hold rather than byte for byte.
+    bool same(Chip8::Machine &a, Chip8::Machine &b)
+    {
+        std::unique_ptr<Chip8::Machine::State> stateA(new Chip8::Machine::State());
+        std::unique_ptr<Chip8::Machine::State> stateB(new Chip8::Machine::State());
+        a.save(*stateA);
+        b.save(*stateB);
+        return Chip8::Trace::hashState(*stateA) == Chip8::Trace::hashState(*stateB);
+    }
+
+    void report(const char *name, const Chip8::Netplay &netplay)
+    {
+        std::cout << name << ": frame " << netplay.frame() << " rollbacks " << netplay.rollbacks()
+                  << " max frames " << netplay.maxResimulatedFrames()
+                  << " max time " << netplay.maxRollbackMicroseconds() << "us" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+
+    Settings settings;
+    if(!parse(argc, argv, settings)) {
+        std::cout << "Usage: chip8-netplay-loopback [--frames=N] [--hz=N] [--latency=MS] [--jitter=MS]" << std::endl
+                  << "                              [--loss=PERCENT] [--delay=N] [--rollback=N]" << std::endl
+                  << "                              [--cycles=N] [--port=N] romfile" << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(settings.romName);
+    std::unique_ptr<Chip8::Machine> machineA(new Chip8::Machine());
+    std::unique_ptr<Chip8::Machine> machineB(new Chip8::Machine());
+    boot(*machineA, rom, settings.cycles);
+    boot(*machineB, rom, settings.cycles);
+
+    Chip8::Netplay::Config configA = settings.netplay;
+    configA.localPort = settings.port;
+    configA.remoteHost = "127.0.0.1";
+    configA.remotePort = settings.port + 1;
+    configA.simulatorSeed = 1;
+    Chip8::Netplay::Config configB = configA;
+    configB.localPort = settings.port + 1;
+    configB.remotePort = settings.port;
+    configB.simulatorSeed = 2;
+
+    Chip8::Netplay netplayA;
+    Chip8::Netplay netplayB;
+    if(!netplayA.open(configA) || !netplayB.open(configB)) {
+        std::cout << "Failed to open ports " << settings.port << " and " << settings.port + 1 << std::endl;
+        return 2;
+    }
+
+    // PONG2 paddles, player one on 1/4 and player two on C/D.
+    Player playerA(0x1234, 0x1, 0x4);
+    Player playerB(0x5678, 0xC, 0xD);
+
+    Uint32 frames = settings.frames;
+    Chip8::FramePacer pacer(settings.hz);
+    while(netplayA.frame() < frames || netplayB.frame() < frames) {
+        pacer.wait();
+        // A peer that is done keeps polling, the other one may still need
+        // its input.
+        if(netplayA.frame() >= frames) {
+            netplayA.poll(*machineA);
+        } else if(netplayA.advance(*machineA, playerA.keys())) {
+            playerA.played();
+        }
+        if(netplayB.frame() >= frames) {
+            netplayB.poll(*machineB);
+        } else if(netplayB.advance(*machineB, playerB.keys())) {
+            playerB.played();
+        }
+    }
+
+    // Let the last inputs arrive and be rolled in.
+    std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(netplayA.confirmedFrame() < frames || netplayB.confirmedFrame() < frames) {
+        if(std::chrono::steady_clock::now() > timeout) {
+            std::cout << "Timed out waiting for the last inputs" << std::endl;
+            return 1;
+        }
+        pacer.wait();
+        netplayA.poll(*machineA);
+        netplayB.poll(*machineB);
+    }
+
+    report("A", netplayA);
+    report("B", netplayB);
+
+    // Replay the inputs both sides played on a third machine. Local input
+    // runs inputDelay frames after it is given.
+    std::unique_ptr<Chip8::Machine> reference(new Chip8::Machine());
+    boot(*reference, rom, settings.cycles);
+    Uint32 delay = netplayA.config().inputDelay;
+    for(Uint32 frame = 0; frame < frames; frame++) {
+        Uint16 keys = 0;
+        if(frame >= delay) {
+            keys = playerA.history()[frame - delay] | playerB.history()[frame - delay];
+        }
+        reference->setKeys(keys);
+        reference->stepFrame();
+    }
+
+    bool matchA = same(*machineA, *reference);
+    bool matchB = same(*machineB, *reference);
+    std::cout << "A " << (matchA ? "matches" : "DIFFERS from") << " the reference" << std::endl
+              << "B " << (matchB ? "matches" : "DIFFERS from") << " the reference" << std::endl;
+    return matchA && matchB ? 0 : 1;
+}
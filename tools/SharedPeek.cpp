@@ -0,0 +1,121 @@
+// Reads the frames chip8 --shm exports, as a trainer would, and can hold
+// keys through the segment.
+//
+// chip8-shm-peek [--frames=N] [--keys=MASK] [--screen] name
+//
+// Polls the segment called name and prints a line for every new frame:
+// its number, how many frames were skipped since the last one seen, the
+// screen hash and the keys it ran with. --screen also draws plane 0 as text.
+// --keys writes MASK (hex) to the input word first and clears it on exit.
+
+#include <SharedExport.hpp>
+
+#include <fcntl.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    bool parseNumber(const std::string &value, int base, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, base);
+        return !value.empty() && *end == '\0' && result >= 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string name;
+    long frames = 600;
+    long keys = -1;
+    bool screen = false;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string option = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            valid = name.empty();
+            name = arg;
+        } else if(option == "--frames") {
+            valid = parseNumber(value, 10, frames) && frames > 0;
+        } else if(option == "--keys") {
+            valid = parseNumber(value, 16, keys) && keys <= 0xFFFF;
+        } else if(option == "--screen") {
+            screen = true;
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || name.empty()) {
+        std::cout << "Usage: chip8-shm-peek [--frames=N] [--keys=MASK] [--screen] name" << std::endl;
+        return 2;
+    }
+
+    typedef Chip8::SharedExport::Layout Layout;
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0) {
+        std::cout << "Failed to open " << name << ", is chip8 running with --shm?" << std::endl;
+        return 1;
+    }
+    void *memory = mmap(0, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED) {
+        std::cout << "Failed to map " << name << std::endl;
+        return 1;
+    }
+    Layout &shared = *(Layout *) memory;
+    if(__atomic_load_n(&shared.magic, __ATOMIC_ACQUIRE) != Chip8::SharedExport::Magic
+       || shared.version != Chip8::SharedExport::Version || shared.size != sizeof(Layout)) {
+        std::cout << name << " isn't a version " << Chip8::SharedExport::Version << " chip8 export" << std::endl;
+        return 1;
+    }
+
+    if(keys >= 0) {
+        __atomic_store_n(&shared.input, (Uint32) keys, __ATOMIC_RELAXED);
+    }
+
+    // Layout is large, so the copy isn't on the stack.
+    Layout *copy = new Layout();
+    Uint64 last = 0;
+    Uint64 torn = 0;
+    for(long seen = 0; seen < frames; ) {
+        if(!Chip8::SharedExport::read(shared, *copy)) {
+            torn++;
+            continue;
+        }
+        if(copy->frame == last) {
+            usleep(1000);
+            continue;
+        }
+        std::cout << "frame " << copy->frame << " skipped " << (last == 0 ? 0 : copy->frame - last - 1)
+                  << " hash " << std::hex << copy->screenHash << " keys " << copy->keys << std::dec
+                  << (copy->sound ? " sound" : "") << std::endl;
+        if(screen) {
+            for(int y = 0; y < 32; y++) {
+                std::string row;
+                for(int x = 0; x < 64; x++) {
+                    row += (copy->planes[0][y] >> (63 - x)) & 1 ? '#' : '.';
+                }
+                std::cout << row << std::endl;
+            }
+        }
+        last = copy->frame;
+        seen++;
+    }
+
+    if(keys >= 0) {
+        __atomic_store_n(&shared.input, 0, __ATOMIC_RELAXED);
+    }
+    delete copy;
+    munmap(memory, sizeof(Layout));
+    if(torn > 0) {
+        std::cout << torn << " reads gave up on a frame being written" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Runs many copies of a ROM on a Scheduler, pressing keys on random sessions
+// now and then, and reports how well the scheduler keeps up.
+//
+// chip8-swarm [--sessions=N] [--workers=N] [--seconds=N] [--cycles=N]
+//             [--presses=N] romfile
+//
+// Every second --presses random sessions get a random key held for a few
+// frames. Each report line gives the frames run against the frames due for
+// the sessions not parked, how many are parked waiting for a key, late
+// frames, steals and the CPU time used.
+
+#include <FileUtils.hpp>
+#include <Machine.hpp>
+#include <Scheduler.hpp>
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    bool parseNumber(const std::string &value, long &result)
+    {
+        char *end = 0;
+        result = strtol(value.c_str(), &end, 10);
+        return !value.empty() && *end == '\0' && result > 0;
+    }
+
+    unsigned int nextRandom(unsigned int &random)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    double cpuSeconds()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_minloglevel = google::GLOG_WARNING;
+
+    std::string romName;
+    long sessions = 1000;
+    long workers = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    long seconds = 10;
+    long cycles = 10;
+    long presses = 100;
+    bool valid = true;
+    for(int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+        if(arg.compare(0, 2, "--") != 0) {
+            valid = romName.empty();
+            romName = arg;
+        } else if(name == "--sessions") {
+            valid = parseNumber(value, sessions);
+        } else if(name == "--workers") {
+            valid = parseNumber(value, workers);
+        } else if(name == "--seconds") {
+            valid = parseNumber(value, seconds);
+        } else if(name == "--cycles") {
+            valid = parseNumber(value, cycles);
+        } else if(name == "--presses") {
+            valid = parseNumber(value, presses);
+        } else {
+            valid = false;
+        }
+    }
+    if(!valid || romName.empty()) {
+        std::cout << "Usage: chip8-swarm [--sessions=N] [--workers=N] [--seconds=N] [--cycles=N]" << std::endl
+                  << "                   [--presses=N] romfile" << std::endl;
+        return 2;
+    }
+
+    std::vector<unsigned char> rom = Chip8::FileUtils::readRom(romName);
+    if(rom.empty()) {
+        std::cout << "Failed to read " << romName << std::endl;
+        return 1;
+    }
+
+    Chip8::Scheduler scheduler((unsigned int) workers, 60.0);
+    std::vector<std::shared_ptr<Chip8::Scheduler::Session> > all;
+    for(long i = 0; i < sessions; i++) {
+        std::unique_ptr<Chip8::Machine> machine(new Chip8::Machine());
+        machine->reset(rom);
+        machine->setCyclesPerFrame((int) cycles);
+        machine->cpu().seed((unsigned int) i);
+        all.push_back(scheduler.add(std::move(machine)));
+    }
+    scheduler.start();
+
+    // Keys are released a few reports later, so presses overlap.
+    typedef std::chrono::steady_clock Clock;
+    unsigned int random = 1;
+    std::vector<size_t> held;
+    Chip8::Scheduler::Stats last = scheduler.stats();
+    double lastCpu = cpuSeconds();
+    Clock::time_point next = Clock::now();
+    for(long second = 0; second < seconds; second++) {
+        for(size_t i = 0; i < held.size(); i++) {
+            scheduler.setKeys(all[held[i]], 0);
+        }
+        held.clear();
+        for(long i = 0; i < presses; i++) {
+            size_t session = nextRandom(random) % all.size();
+            scheduler.setKeys(all[session], (Uint16) (1 << (nextRandom(random) & 0xF)));
+            held.push_back(session);
+        }
+
+        next += std::chrono::seconds(1);
+        std::this_thread::sleep_until(next);
+        Chip8::Scheduler::Stats stats = scheduler.stats();
+        double cpu = cpuSeconds();
+        std::cout << "frames " << stats.frames - last.frames << " due " << (stats.sessions - stats.parked) * 60
+                  << " parked " << stats.parked << " late " << stats.late - last.late
+                  << " steals " << stats.steals - last.steals << " cpu " << (cpu - lastCpu) * 100 << "%" << std::endl;
+        last = stats;
+        lastCpu = cpu;
+    }
+    scheduler.stop();
+    return 0;
+}